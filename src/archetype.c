@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include "archetype.h"
+#include "datafile.h"
+#include "drc_sprite.h"
+#include "tokenizer.h"
+
+static void init_enemy_archetype(ENEMY_ARCHETYPE *archetype, ENEMY_TYPE type)
+{
+    init_enemy(&archetype->enemy);
+    archetype->enemy.type = type;
+
+    archetype->x = 0;
+    archetype->y = 0;
+    archetype->dx = 0;
+    archetype->dy = 0;
+    archetype->update = ENEMY_UPDATE_ANIMATION;
+}
+
+static bool read_ints(TOKENIZER *tokenizer, int *nums, int len, const char *name)
+{
+    TOKEN token;
+
+    for (int i = 0; i < len; i++) {
+        if (!next_token(tokenizer, &token) || !token_to_int(&token, &nums[i])) {
+            tokenizer_error(tokenizer, NULL, "Failed to load %s, it needs %d numbers.", name, len);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static ENEMY_UPDATE get_enemy_update(TOKEN *token)
+{
+    if (token_equals(token, "ANIMATION")) {
+        return ENEMY_UPDATE_ANIMATION;
+    } else if (token_equals(token, "MOVEMENT")) {
+        return ENEMY_UPDATE_MOVEMENT;
+    } else if (token_equals(token, "TRACER")) {
+        return ENEMY_UPDATE_TRACER;
+    } else if (token_equals(token, "CHASER")) {
+        return ENEMY_UPDATE_CHASER;
+    }
+
+    return NUM_ENEMY_UPDATES;
+}
+
+static void load_enemy_archetype(ENEMY_ARCHETYPE *archetype, TOKENIZER *tokenizer)
+{
+    TOKEN token;
+    char name[MAX_STRING_SIZE];
+
+    /* The animation is made once all of its frames are known */
+    ALLEGRO_BITMAP *frames[MAX_FRAMES];
+    int len = 0;
+    int speed = 0;
+    bool loop = false;
+
+    int offset[2] = {0, 0};
+    int body[4] = {0, 0, 0, 0};
+    int velocity[2] = {0, 0};
+
+    while (next_token(tokenizer, &token)) {
+
+        if (token_equals(&token, "IMAGE")) {
+            if (!next_token(tokenizer, &token)) {
+                break;
+            }
+            token_to_string(&token, name, MAX_STRING_SIZE);
+            ALLEGRO_BITMAP *frame = DRC_IMG(name);
+            if (frame == NULL) {
+                tokenizer_error(tokenizer, &token, "Failed to load image \"%s\".", name);
+            } else if (len >= MAX_FRAMES) {
+                tokenizer_error(tokenizer, &token, "Too many frames, only %d are allowed.", MAX_FRAMES);
+            } else {
+                frames[len] = frame;
+                len++;
+            }
+        } else if (token_equals(&token, "SPEED")) {
+            read_ints(tokenizer, &speed, 1, "SPEED");
+        } else if (token_equals(&token, "LOOP")) {
+            loop = true;
+        } else if (token_equals(&token, "OFFSET")) {
+            read_ints(tokenizer, offset, 2, "OFFSET");
+        } else if (token_equals(&token, "BODY")) {
+            read_ints(tokenizer, body, 4, "BODY");
+        } else if (token_equals(&token, "VELOCITY")) {
+            read_ints(tokenizer, velocity, 2, "VELOCITY");
+        } else if (token_equals(&token, "UPDATE")) {
+            if (next_token(tokenizer, &token)) {
+                ENEMY_UPDATE update = get_enemy_update(&token);
+                if (update == NUM_ENEMY_UPDATES) {
+                    tokenizer_error(tokenizer, &token, "Failed to understand update \"%.*s\".", token.len, token.start);
+                } else {
+                    archetype->update = update;
+                }
+            }
+        } else if (token_equals(&token, "END")) {
+
+            DRC_SPRITE *sprite = &archetype->enemy.sprite;
+            drc_init_sprite_with_animation(sprite, drc_get_animation(frames, len, speed, loop));
+            sprite->x_offset = offset[0];
+            sprite->y_offset = offset[1];
+
+            archetype->x = body[0];
+            archetype->y = body[1];
+            archetype->enemy.body.w = body[2];
+            archetype->enemy.body.h = body[3];
+
+            archetype->dx = velocity[0];
+            archetype->dy = velocity[1];
+
+            return;
+
+        } else {
+            tokenizer_error(tokenizer, &token, "WARNING: Skipping \"%.*s\" in archetype...", token.len, token.start);
+        }
+    }
+
+    tokenizer_error(tokenizer, NULL, "Failed to find END for archetype.");
+}
+
+bool load_enemy_archetypes(const char *filename, ENEMY_ARCHETYPE archetypes[NUM_ENEMY_TYPES])
+{
+    for (int i = 0; i < NUM_ENEMY_TYPES; i++) {
+        init_enemy_archetype(&archetypes[i], i);
+    }
+
+    TOKENIZER tokenizer;
+
+    if (!open_tokenizer(&tokenizer, filename)) {
+        fprintf(stderr, "Failed to open enemy archetypes \"%s\".\n", filename);
+        return false;
+    }
+
+    TOKEN token;
+    char name[MAX_STRING_SIZE];
+
+    while (next_token(&tokenizer, &token)) {
+
+        if (!token_equals(&token, "ARCHETYPE")) {
+            tokenizer_error(&tokenizer, &token, "WARNING: Looking for ARCHETYPE, skipping \"%.*s\"...", token.len, token.start);
+            continue;
+        }
+
+        if (!next_token(&tokenizer, &token)) {
+            tokenizer_error(&tokenizer, NULL, "Failed to find the type of enemy, reached the end of the file.");
+            break;
+        }
+
+        token_to_string(&token, name, MAX_STRING_SIZE);
+        ENEMY_TYPE type = get_enemy_type(name);
+
+        if (type == ENEMY_TYPE_NONE) {
+            /* Read it anyway, to get to the END */
+            ENEMY_ARCHETYPE unknown;
+            init_enemy_archetype(&unknown, ENEMY_TYPE_NONE);
+            load_enemy_archetype(&unknown, &tokenizer);
+            continue;
+        }
+
+        /* In case it's in the file more than once, the last one is used */
+        init_enemy_archetype(&archetypes[type], type);
+        load_enemy_archetype(&archetypes[type], &tokenizer);
+    }
+
+    close_tokenizer(&tokenizer);
+
+    return true;
+}
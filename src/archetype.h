@@ -0,0 +1,61 @@
+#pragma once
+
+#include "gamedata.h"
+
+/* The data file with every enemy archetype */
+#define ENEMY_ARCHETYPES_FILENAME "enemies.dat"
+
+/**
+ * How an enemy moves, each is a different update
+ * function in the game (see "gameplay.c").
+ */
+typedef enum
+{
+    ENEMY_UPDATE_ANIMATION = 0,
+    ENEMY_UPDATE_MOVEMENT,
+    ENEMY_UPDATE_TRACER,
+    ENEMY_UPDATE_CHASER,
+    NUM_ENEMY_UPDATES
+} ENEMY_UPDATE;
+
+/**
+ * Everything about one type of enemy that's the same for
+ * every enemy of that type, read from a data file such as:
+ *
+ *   ARCHETYPE LEFTRIGHT
+ *     IMAGE enemy-bat-1.png
+ *     IMAGE enemy-bat-2.png
+ *     SPEED 20
+ *     LOOP
+ *     OFFSET -10 -10      # Where the sprite is drawn, from the body
+ *     BODY 5 5 10 10      # Where the body is in its cell, and its size
+ *     VELOCITY -1 0       # Times the speed of the enemy in the room
+ *     UPDATE MOVEMENT
+ *   END
+ *
+ * An enemy in a room is made by copying "enemy" and
+ * then putting it where the room says it goes.
+ */
+typedef struct
+{
+    /* The sprite (with its animation) and the size of the body */
+    ENEMY enemy;
+
+    /* Where the body is in its cell */
+    int x;
+    int y;
+
+    /* Which way it starts moving */
+    int dx;
+    int dy;
+
+    ENEMY_UPDATE update;
+} ENEMY_ARCHETYPE;
+
+/**
+ * Read the archetypes for every type of enemy, and get their
+ * images and animations ready. A type that isn't in the file
+ * is an enemy without any frames that doesn't move.
+ * Returns false if the file can't be read.
+ */
+bool load_enemy_archetypes(const char *filename, ENEMY_ARCHETYPE archetypes[NUM_ENEMY_TYPES]);
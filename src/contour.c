@@ -0,0 +1,115 @@
+#include "contour.h"
+
+/* Which way is left, right, and behind, for each direction */
+static const DIRECTION left_of[LAST_DIRECTION] = {
+    [UP] = LEFT, [DOWN] = RIGHT, [LEFT] = DOWN, [RIGHT] = UP
+};
+
+static const DIRECTION right_of[LAST_DIRECTION] = {
+    [UP] = RIGHT, [DOWN] = LEFT, [LEFT] = UP, [RIGHT] = DOWN
+};
+
+static const DIRECTION behind[LAST_DIRECTION] = {
+    [UP] = DOWN, [DOWN] = UP, [LEFT] = RIGHT, [RIGHT] = LEFT
+};
+
+/* The edge of the room is a wall too */
+static bool is_open_spot(ROOM *room, int r, int c)
+{
+    if (r < 0 || r >= room->rows || c < 0 || c >= room->cols) {
+        return false;
+    }
+
+    int i = (r * room->cols) + c;
+
+    return room->collision_map[i] != COLLISION && room->block_map[i] == NO_BLOCK;
+}
+
+static bool is_open_step(ROOM *room, int r, int c, DIRECTION dir)
+{
+    return is_open_spot(room, r + directions[dir].v_offset, c + directions[dir].h_offset);
+}
+
+static DIRECTION find_contour_heading(ROOM *room, int r, int c, DIRECTION heading)
+{
+    if (!is_open_spot(room, r, c)) {
+        return NO_DIRECTION;
+    }
+
+    DIRECTION left = left_of[heading];
+    DIRECTION right = right_of[heading];
+    DIRECTION back = behind[heading];
+
+    /* The spot that was on the left before this one */
+    int back_left_r = r + directions[left].v_offset + directions[back].v_offset;
+    int back_left_c = c + directions[left].h_offset + directions[back].h_offset;
+
+    bool open_left = is_open_step(room, r, c, left);
+
+    /* The wall just ended, go around the corner */
+    if (open_left && !is_open_spot(room, back_left_r, back_left_c)) {
+        return left;
+    }
+
+    if (is_open_step(room, r, c, heading)) {
+        return heading;
+    }
+
+    /* Ran into a wall, turn so that it's on the left */
+    if (is_open_step(room, r, c, right)) {
+        return right;
+    }
+
+    if (open_left) {
+        return left;
+    }
+
+    /* A dead end */
+    if (is_open_step(room, r, c, back)) {
+        return back;
+    }
+
+    return NO_DIRECTION;
+}
+
+static void find_contour_headings(CONTOUR_GRAPH *graph, ROOM *room, int r, int c)
+{
+    for (int dir = FIRST_DIRECTION; dir < LAST_DIRECTION; dir++) {
+        graph->next[(r * room->cols) + c][dir] = find_contour_heading(room, r, c, dir);
+    }
+}
+
+void init_contour_graph(CONTOUR_GRAPH *graph, ROOM *room)
+{
+    graph->rows = room->rows;
+    graph->cols = room->cols;
+
+    for (int r = 0; r < room->rows; r++) {
+        for (int c = 0; c < room->cols; c++) {
+            find_contour_headings(graph, room, r, c);
+        }
+    }
+}
+
+void update_contour_graph(CONTOUR_GRAPH *graph, ROOM *room, int r, int c)
+{
+    assert(graph->rows == room->rows && graph->cols == room->cols);
+
+    /* Only the spots right around this one look at it */
+    for (int row = r - 1; row <= r + 1; row++) {
+        for (int col = c - 1; col <= c + 1; col++) {
+            if (row >= 0 && row < room->rows && col >= 0 && col < room->cols) {
+                find_contour_headings(graph, room, row, col);
+            }
+        }
+    }
+}
+
+DIRECTION get_contour_heading(CONTOUR_GRAPH *graph, int r, int c, DIRECTION heading)
+{
+    if (r < 0 || r >= graph->rows || c < 0 || c >= graph->cols || heading == NO_DIRECTION) {
+        return NO_DIRECTION;
+    }
+
+    return graph->next[(r * graph->cols) + c][heading];
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "gamedata.h"
+
+/**
+ * The surfaces of the walls and blocks in a room, for enemies
+ * that follow them around.
+ *
+ * Each open spot in the room has a way to go next for each way
+ * it could be going, so that the wall is always kept on the left.
+ * Going from spot to spot like that goes around the contour of
+ * whatever is being followed. Away from any walls, it just keeps
+ * going straight until it runs into one.
+ *
+ * It's all figured out when the room is loaded, and then only
+ * the spots next to a block are figured out again when the
+ * block is destroyed.
+ */
+typedef struct
+{
+    int rows;
+    int cols;
+
+    /* Which way to go next from each spot, or NO_DIRECTION */
+    int8_t next[MAX_ROOM_SIZE][LAST_DIRECTION];
+} CONTOUR_GRAPH;
+
+/* Figure out the contours of the whole room */
+void init_contour_graph(CONTOUR_GRAPH *graph, ROOM *room);
+
+/**
+ * A spot in the room was opened up (such as a block
+ * was destroyed), so update the contours around it.
+ */
+void update_contour_graph(CONTOUR_GRAPH *graph, ROOM *room, int r, int c);
+
+/**
+ * Which way to go from a spot, coming in going "heading".
+ * Returns NO_DIRECTION if the spot isn't open, or if there's
+ * nowhere to go from it.
+ */
+DIRECTION get_contour_heading(CONTOUR_GRAPH *graph, int r, int c, DIRECTION heading);
@@ -1,13 +1,24 @@
 #include <ctype.h>
 #include <stdio.h>
 #include "datafile.h"
+#include "drc_memory.h"
+#include "drc_path_cache.h"
 #include "drc_random.h"
 #include "drc_resources.h"
+#include "drc_trace.h"
+#include "drc_watch.h"
 #include "mask.h"
+#include "names.h"
+#include "roomfile.h"
+#include "tmxfile.h"
+#include "tokenizer.h"
 
 #define MAX_DATAFILE_PATHS 4
 #define MAX_DATAFILE_FILENAME_SIZE 256
 
+/* So the path cache can tell data files apart from resources */
+#define DATAFILE_PATH_GROUP (1)
+
 static char datafile_paths[MAX_DATAFILE_PATHS][MAX_DATAFILE_FILENAME_SIZE];
 static int num_datafile_paths = 0;
 
@@ -24,28 +35,50 @@ void add_datafile_path(const char *path)
     strncpy(datafile_paths[num_datafile_paths], path, MAX_DATAFILE_FILENAME_SIZE);
 
     num_datafile_paths++;
+
+    /* A file might be found somewhere else now */
+    drc_forget_path_cache(DATAFILE_PATH_GROUP);
 }
 
-FILE *open_data_file(const char *name)
+void clear_datafile_paths(void)
 {
-    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
-    FILE *file = NULL;
+    num_datafile_paths = 0;
+
+    drc_forget_path_cache(DATAFILE_PATH_GROUP);
+}
+
+static const char *get_datafile_path(int n)
+{
+    return n < num_datafile_paths ? datafile_paths[n] : NULL;
+}
+
+bool find_data_file(const char *name, char *fullpath, int size)
+{
+    /* Find the file from the list of possible paths, it's remembered after the first time */
+    if (!drc_find_file_in_paths(DATAFILE_PATH_GROUP, get_datafile_path, name, fullpath, size)) {
+        return false;
+    }
 
-    /* Find the file to open from the list of possible paths... */
-    for (int i = 0; i < num_datafile_paths; i++) {
+    /* In case it changes while the game is running */
+    drc_watch_file(fullpath);
 
-        fullpath[0] = '\0';
-        strncat(fullpath, datafile_paths[i], MAX_DATAFILE_FILENAME_SIZE - 1);
-        strncat(fullpath, name, MAX_DATAFILE_FILENAME_SIZE - 1);
+    return true;
+}
 
-        file = fopen(fullpath, "r");
+FILE *open_data_file_with_mode(const char *name, const char *mode)
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
 
-        if (file != NULL) {
-            break;
-        }
+    if (!find_data_file(name, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+        return NULL;
     }
 
-    return file;
+    return fopen(fullpath, mode);
+}
+
+FILE *open_data_file(const char *name)
+{
+    return open_data_file_with_mode(name, "r");
 }
 
 void close_data_file(FILE *file)
@@ -53,134 +86,184 @@ void close_data_file(FILE *file)
     fclose(file);
 }
 
-static void load_sprite_from_datafile(DRC_SPRITE *sprite, FILE *file)
+/**
+ * Every word that means something in a data file.
+ *
+ * They're found with a perfect hash: "KEYWORD_HASH" gives every
+ * keyword a different spot in "keyword_table", so finding one is
+ * a single comparison. If a keyword is added and it lands on a
+ * spot that's already taken, change the numbers in "KEYWORD_HASH"
+ * until every keyword has its own spot again.
+ */
+typedef enum
+{
+    KEYWORD_NONE = 0,
+    KEYWORD_IMPORT,
+    KEYWORD_TITLE,
+    KEYWORD_MUSIC,
+    KEYWORD_START,
+    KEYWORD_DIRECTION,
+    KEYWORD_FACING,
+    KEYWORD_SIZE,
+    KEYWORD_TILE,
+    KEYWORD_TEXTURE,
+    KEYWORD_FARGROUND,
+    KEYWORD_BACKGROUND,
+    KEYWORD_FOREGROUND,
+    KEYWORD_COLLISION,
+    KEYWORD_BLOCKS,
+    KEYWORD_ENEMY,
+    KEYWORD_EXIT,
+    KEYWORD_IMAGE,
+    KEYWORD_SPEED,
+    KEYWORD_LOOP,
+    KEYWORD_END
+} KEYWORD;
+
+#define KEYWORD_TABLE_SIZE (64)
+#define KEYWORD_HASH(start, len) ((((len) * 5) + (start)[0] + ((start)[(len) - 1] * 3)) & (KEYWORD_TABLE_SIZE - 1))
+
+typedef struct
+{
+    const char *name;
+    int len;
+    KEYWORD keyword;
+} KEYWORD_ENTRY;
+
+static const KEYWORD_ENTRY keyword_table[KEYWORD_TABLE_SIZE] = {
+    [0] = {"BACKGROUND", 10, KEYWORD_BACKGROUND},
+    [4] = {"FOREGROUND", 10, KEYWORD_FOREGROUND},
+    [6] = {"TEXTURE", 7, KEYWORD_TEXTURE},
+    [16] = {"LOOP", 4, KEYWORD_LOOP},
+    [21] = {"EXIT", 4, KEYWORD_EXIT},
+    [25] = {"BLOCKS", 6, KEYWORD_BLOCKS},
+    [26] = {"COLLISION", 9, KEYWORD_COLLISION},
+    [27] = {"DIRECTION", 9, KEYWORD_DIRECTION},
+    [32] = {"END", 3, KEYWORD_END},
+    [35] = {"IMPORT", 6, KEYWORD_IMPORT},
+    [40] = {"START", 5, KEYWORD_START},
+    [41] = {"ENEMY", 5, KEYWORD_ENEMY},
+    [47] = {"MUSIC", 5, KEYWORD_MUSIC},
+    [49] = {"IMAGE", 5, KEYWORD_IMAGE},
+    [54] = {"SIZE", 4, KEYWORD_SIZE},
+    [55] = {"TILE", 4, KEYWORD_TILE},
+    [56] = {"SPEED", 5, KEYWORD_SPEED},
+    [57] = {"FACING", 6, KEYWORD_FACING},
+    [60] = {"TITLE", 5, KEYWORD_TITLE},
+    [63] = {"FARGROUND", 9, KEYWORD_FARGROUND}
+};
+
+static KEYWORD find_keyword(TOKEN *token)
 {
-    assert(file != NULL);
+    const KEYWORD_ENTRY *entry = &keyword_table[KEYWORD_HASH(token->start, token->len)];
 
-    char string[MAX_STRING_SIZE];
+    if (entry->len == token->len && memcmp(entry->name, token->start, token->len) == 0) {
+        return entry->keyword;
+    }
 
-    while (fscanf(file, "%s", string) != EOF) {
+    return KEYWORD_NONE;
+}
 
-        /* Ignore comments (lines that begin with a hash) */
-        if (string[0] == '#') {
-            if (fgets(string, MAX_STRING_SIZE, file) == NULL) {
-                fprintf(stderr, "Failed to read comment.\n");
-            }
-            continue;
-        }
+static bool load_int_from_datafile(TOKENIZER *tokenizer, int *num, const char *name)
+{
+    TOKEN token;
 
-        if (strncmp(string, "IMAGE", MAX_STRING_SIZE - 1) == 0) {
-            if (fscanf(file, "%s", string) != 1) {
-                fprintf(stderr, "Failed to load IMAGE.\n");
-            }
-            drc_add_frame(sprite, DRC_IMG(string));
-            continue;
-        }
+    if (!next_token(tokenizer, &token)) {
+        tokenizer_error(tokenizer, NULL, "Failed to find %s, reached the end of the file.", name);
+        return false;
+    }
 
-        if (strncmp(string, "SPEED", MAX_STRING_SIZE - 1) == 0) {
-            if (fscanf(file, "%d", &sprite->speed) != 1) {
-                fprintf(stderr, "WARNING: Looking for sprite speed, skipping %s...\n", string);
-            }
-        }
+    if (!token_to_int(&token, num)) {
+        tokenizer_error(tokenizer, &token, "Failed to load %s, \"%.*s\" is not a valid number.", name, token.len, token.start);
+        return false;
+    }
 
-        if (strncmp(string, "LOOP", MAX_STRING_SIZE - 1) == 0) {
-            sprite->loop = true;
-        }
+    return true;
+}
 
-        if (strncmp(string, "END", MAX_STRING_SIZE - 1) == 0) {
-            break;
-        }
+static bool load_string_from_datafile(TOKENIZER *tokenizer, char *string, int size, const char *name)
+{
+    TOKEN token;
+
+    if (!next_token(tokenizer, &token)) {
+        tokenizer_error(tokenizer, NULL, "Failed to find %s, reached the end of the file.", name);
+        string[0] = '\0';
+        return false;
     }
+
+    token_to_string(&token, string, size);
+
+    return true;
 }
 
-static void load_texture_def_from_datafile(TEXTURE_DEF *texture_def, FILE *file)
+static void load_texture_def_from_datafile(TEXTURE_DEF *texture_def, TOKENIZER *tokenizer)
 {
-    assert(file != NULL);
-
-    char string[MAX_STRING_SIZE];
+    TOKEN token;
 
-    while (fscanf(file, "%s", string) != EOF) {
+    while (next_token(tokenizer, &token)) {
 
-        /* Ignore comments (lines that begin with a hash) */
-        if (string[0] == '#') {
-            if (fgets(string, MAX_STRING_SIZE, file) == NULL) {
-                fprintf(stderr, "Failed to read comment.\n");
-            }
-            continue;
-        }
+        KEYWORD keyword = find_keyword(&token);
 
-        if (strncmp(string, "IMAGE", MAX_STRING_SIZE - 1) == 0) {
-            if (fscanf(file, "%s", string) != 1) {
-                fprintf(stderr, "Failed to load IMAGE for texture_def.\n");
-                continue;
-            }
+        if (keyword == KEYWORD_IMAGE) {
             if (texture_def->len >= MAX_FRAMES) {
-                fprintf(stderr, "ERROR: Too many frames in texture_def.\n");
+                tokenizer_error(tokenizer, &token, "ERROR: Too many frames in texture_def.");
+                next_token(tokenizer, &token);
                 continue;
             }
-            strncpy(texture_def->frames[texture_def->len], string, MAX_STRING_SIZE);
-            texture_def->len++;
-            continue;
-        }
-
-        if (strncmp(string, "SPEED", MAX_STRING_SIZE - 1) == 0) {
-            if (fscanf(file, "%d", &texture_def->speed) != 1) {
-                fprintf(stderr, "WARNING: Looking for texture_def speed, skipping %s...\n", string);
+            char frame[MAX_FILENAME_LEN];
+            if (load_string_from_datafile(tokenizer, frame, MAX_FILENAME_LEN, "IMAGE for texture_def")) {
+                texture_def->frames[texture_def->len] = intern_name(frame);
+                texture_def->len++;
             }
-        }
-
-        //if (strncmp(string, "LOOP", MAX_STRING_SIZE - 1) == 0) {
-        //    texture_def->loop = true;
-        //}
-
-        if (strncmp(string, "END", MAX_STRING_SIZE - 1) == 0) {
-            break;
+        } else if (keyword == KEYWORD_SPEED) {
+            load_int_from_datafile(tokenizer, &texture_def->speed, "texture_def speed");
+        } else if (keyword == KEYWORD_LOOP) {
+            texture_def->loop = true;
+        } else if (keyword == KEYWORD_END) {
+            return;
         }
     }
+
+    tokenizer_error(tokenizer, NULL, "Failed to find END for texture_def.");
 }
 
-static bool load_next_number_from_datafile(FILE *file, int *num)
+static bool load_next_number_from_datafile(TOKENIZER *tokenizer, int *num)
 {
-    char string[MAX_STRING_SIZE];
+    TOKEN token;
 
-    while (fscanf(file, "%s", string) != EOF) {
-
-        /* Ignore comments (lines that begin with a hash) */
-        if (string[0] == '#') {
-            if (fgets(string, MAX_STRING_SIZE, file) == NULL) {
-                fprintf(stderr, "Failed to read comment.\n");
-            }
-            continue;
-        }
+    while (next_token(tokenizer, &token)) {
 
         /* Look for a number */
-        if (sscanf(string, "%d", num) == 1) {
+        if (token_to_int(&token, num)) {
             return true;
-        } else {
-            fprintf(stderr, "WARNING: Looking for number, skipping %s...\n", string);
         }
+
+        tokenizer_error(tokenizer, &token, "WARNING: Looking for number, skipping %.*s...", token.len, token.start);
     }
 
     return false;
 }
 
-static void load_map_from_datafile(int *map, int rows, int cols, FILE *file)
+static void load_map_from_datafile(ROOM_CELL *map, int rows, int cols, TOKENIZER *tokenizer)
 {
-    assert(file != NULL);
-
     int num = 0;
 
     for (int r = 0; r < rows; r++) {
         for (int c = 0; c < cols; c++) {
 
-            if (load_next_number_from_datafile(file, &num)) {
+            if (load_next_number_from_datafile(tokenizer, &num)) {
                 /* WARNING: TRICKY! */
                 /* The data file counts numbers starting at 1 */
                 /* The game engine counts numbers starting at 0 */
                 /* SUBTRACT 1! */
+                if (num - 1 < INT8_MIN || num - 1 > INT8_MAX) {
+                    tokenizer_error(tokenizer, NULL, "Number %d in map is too big, using 0 instead.", num);
+                    num = 0;
+                }
                 map[(r * cols) + c] = num - 1;
             } else {
-                fprintf(stderr, "Failed to find number for map.\n");
+                tokenizer_error(tokenizer, NULL, "Failed to find number for map.");
+                return;
             }
         }
     }
@@ -211,7 +294,7 @@ static void trim_string(char *string, int len)
     string[i] = '\0';
 }
 
-static void print_map(int *map, int rows, int cols, bool is_data_file_form)
+static void print_map(ROOM_CELL *map, int rows, int cols, bool is_data_file_form)
 {
     /**
      * The numbers in the maps are stored ONE LESS in
@@ -234,6 +317,7 @@ void print_room(ROOM *room, bool is_data_file_form)
     }
 
     printf("TITLE \"%s\"\n", room->title);
+    printf("MUSIC \"%s\"\n", room->music);
     printf("START %d %d\n", room->start_x, room->start_y);
     printf("SIZE %d %d\n", room->rows, room->cols);
     printf("TILES %d\n", room->num_tiles);
@@ -246,7 +330,7 @@ void print_room(ROOM *room, bool is_data_file_form)
     for (int i = 0; i < room->num_texture_defs; i++) {
         printf("TEXTURE %d\n", i);
         for (int j = 0; j < room->texture_defs[i].len; j++) {
-            printf("  %s\n", room->texture_defs[i].frames[j]);
+            printf("  %s\n", get_name(room->texture_defs[i].frames[j]));
         }
         printf("  SPEED %d\n", room->texture_defs[i].speed);
     }
@@ -294,7 +378,7 @@ void print_room(ROOM *room, bool is_data_file_form)
     }
 }
 
-static ENEMY_TYPE get_enemy_type(const char *type)
+ENEMY_TYPE get_enemy_type(const char *type)
 {
     if (strncmp(type, "LEFTRIGHT", MAX_STRING_SIZE) == 0) {
         return ENEMY_TYPE_LEFTRIGHT;
@@ -306,22 +390,274 @@ static ENEMY_TYPE get_enemy_type(const char *type)
         return ENEMY_TYPE_BLOCKER;
     } else if (strncmp(type, "TRACER", MAX_STRING_SIZE) == 0) {
         return ENEMY_TYPE_TRACER;
+    } else if (strncmp(type, "CHASER", MAX_STRING_SIZE) == 0) {
+        return ENEMY_TYPE_CHASER;
     }
 
     fprintf(stderr, "Failed to understand enemy type \"%s\".\n", type);
     return ENEMY_TYPE_NONE;
 }
 
-bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
+/**
+ * Files that only have tiles and textures in them (such as
+ * "tile-bricks.dat") are IMPORTed by almost every room. The
+ * tiles and textures from them are remembered the first time
+ * they're read, and just copied into the room after that.
+ * If the file changes, it's read again.
+ */
+#define MAX_IMPORT_CACHE (16)
+
+typedef struct
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+    time_t mtime;
+
+    TEXTURE_DEF *tile_defs;
+    int num_tiles;
+
+    TEXTURE_DEF *texture_defs;
+    int num_texture_defs;
+} IMPORT_CACHE_ENTRY;
+
+static IMPORT_CACHE_ENTRY import_cache[MAX_IMPORT_CACHE];
+static int num_import_cache_entries = 0;
+
+/* Only needed when rooms are read on more than one thread, see "preload.h" */
+static ALLEGRO_MUTEX *import_cache_mutex = NULL;
+
+/* How many times an imported file was read, and how many times that was avoided */
+static int num_import_parses = 0;
+static int num_import_cache_hits = 0;
+
+time_t get_file_mtime(const char *fullpath)
+{
+    ALLEGRO_FS_ENTRY *entry = al_create_fs_entry(fullpath);
+    time_t mtime = al_get_fs_entry_mtime(entry);
+    al_destroy_fs_entry(entry);
+
+    return mtime;
+}
+
+static IMPORT_CACHE_ENTRY *find_import_cache_entry(const char *fullpath)
+{
+    for (int i = 0; i < num_import_cache_entries; i++) {
+        if (strcmp(import_cache[i].fullpath, fullpath) == 0) {
+            return &import_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static TEXTURE_DEF *copy_texture_defs(const char *label, TEXTURE_DEF *texture_defs, int len)
+{
+    if (len == 0) {
+        return NULL;
+    }
+
+    TEXTURE_DEF *copy = drc_alloc_memory(label, len * sizeof(TEXTURE_DEF));
+    assert(copy != NULL);
+
+    memcpy(copy, texture_defs, len * sizeof(TEXTURE_DEF));
+
+    return copy;
+}
+
+static void free_import_cache_entry(IMPORT_CACHE_ENTRY *entry)
+{
+    if (entry->tile_defs != NULL) {
+        entry->tile_defs = drc_free_memory("IMPORT_TILE_DEFS", entry->tile_defs);
+    }
+
+    if (entry->texture_defs != NULL) {
+        entry->texture_defs = drc_free_memory("IMPORT_TEXTURE_DEFS", entry->texture_defs);
+    }
+}
+
+/**
+ * Remember the tiles and textures that were just added to
+ * the room by importing a file.
+ */
+static void remember_import(const char *fullpath, time_t mtime, ROOM *room, int first_tile, int first_texture_def)
+{
+    IMPORT_CACHE_ENTRY *entry = find_import_cache_entry(fullpath);
+
+    if (entry != NULL) {
+        /* The file changed, forget the old version */
+        free_import_cache_entry(entry);
+    } else if (num_import_cache_entries < MAX_IMPORT_CACHE) {
+        entry = &import_cache[num_import_cache_entries];
+        num_import_cache_entries++;
+    } else {
+        /* No more room, it will just be read every time */
+        return;
+    }
+
+    strncpy(entry->fullpath, fullpath, MAX_DATAFILE_FILENAME_SIZE - 1);
+    entry->fullpath[MAX_DATAFILE_FILENAME_SIZE - 1] = '\0';
+    entry->mtime = mtime;
+
+    entry->num_tiles = room->num_tiles - first_tile;
+    entry->tile_defs = copy_texture_defs("IMPORT_TILE_DEFS", &room->tile_defs[first_tile], entry->num_tiles);
+
+    entry->num_texture_defs = room->num_texture_defs - first_texture_def;
+    entry->texture_defs = copy_texture_defs("IMPORT_TEXTURE_DEFS", &room->texture_defs[first_texture_def], entry->num_texture_defs);
+}
+
+static void lock_import_cache(void)
+{
+    if (import_cache_mutex != NULL) {
+        al_lock_mutex(import_cache_mutex);
+    }
+}
+
+static void unlock_import_cache(void)
+{
+    if (import_cache_mutex != NULL) {
+        al_unlock_mutex(import_cache_mutex);
+    }
+}
+
+static bool read_room_from_datafile(const char *filename, ROOM *room, bool *only_defs);
+
+/* Remember that the room depends on the file, see "is_room_newer_than_imports" */
+static void add_room_import(ROOM *room, const char *filename)
+{
+    NAME_ID name = intern_name(filename);
+
+    for (int i = 0; i < room->num_imports; i++) {
+        if (room->imports[i] == name) {
+            return;
+        }
+    }
+
+    if (room->num_imports >= MAX_IMPORTS) {
+        fprintf(stderr, "WARNING: Too many imports, only %d are checked for changes.\n", MAX_IMPORTS);
+        return;
+    }
+
+    room->imports[room->num_imports] = name;
+    room->num_imports++;
+}
+
+static void import_datafile(const char *filename, ROOM *room)
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+
+    if (find_data_file(filename, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+
+        add_room_import(room, filename);
+
+        time_t mtime = get_file_mtime(fullpath);
+
+        lock_import_cache();
+
+        IMPORT_CACHE_ENTRY *entry = find_import_cache_entry(fullpath);
+
+        if (entry != NULL && entry->mtime == mtime &&
+                room->num_tiles + entry->num_tiles <= MAX_TILES &&
+                room->num_texture_defs + entry->num_texture_defs <= MAX_TEXTURES) {
+
+            /* Already read, just copy it */
+            if (entry->num_tiles > 0) {
+                memcpy(&room->tile_defs[room->num_tiles], entry->tile_defs, entry->num_tiles * sizeof(TEXTURE_DEF));
+            }
+            if (entry->num_texture_defs > 0) {
+                memcpy(&room->texture_defs[room->num_texture_defs], entry->texture_defs, entry->num_texture_defs * sizeof(TEXTURE_DEF));
+            }
+            room->num_tiles += entry->num_tiles;
+            room->num_texture_defs += entry->num_texture_defs;
+
+            num_import_cache_hits++;
+            unlock_import_cache();
+            return;
+        }
+
+        num_import_parses++;
+
+        /* Other threads can use the cache while this file is read */
+        unlock_import_cache();
+
+        int first_tile = room->num_tiles;
+        int first_texture_def = room->num_texture_defs;
+        bool only_defs = true;
+
+        if (read_room_from_datafile(filename, room, &only_defs) && only_defs) {
+            lock_import_cache();
+            remember_import(fullpath, mtime, room, first_tile, first_texture_def);
+            unlock_import_cache();
+        }
+
+        return;
+    }
+
+    /* Let the normal error message be shown */
+    read_room_from_datafile_with_filename(filename, room);
+}
+
+void share_import_cache_between_threads(void)
+{
+    if (import_cache_mutex == NULL) {
+        import_cache_mutex = al_create_mutex();
+        assert(import_cache_mutex != NULL);
+    }
+}
+
+void free_import_cache(void)
+{
+    for (int i = 0; i < num_import_cache_entries; i++) {
+        free_import_cache_entry(&import_cache[i]);
+    }
+
+    num_import_cache_entries = 0;
+
+    if (import_cache_mutex != NULL) {
+        al_destroy_mutex(import_cache_mutex);
+        import_cache_mutex = NULL;
+    }
+}
+
+void print_import_cache_stats(void)
+{
+    printf("Imported data files: read %d times, copied from memory %d times.\n", num_import_parses, num_import_cache_hits);
+}
+
+bool read_room_from_datafile_with_filename(const char *filename, ROOM *room)
 {
-    FILE *file = open_data_file(filename);
+    bool only_defs = true;
+
+    if (!read_room_from_datafile(filename, room, &only_defs)) {
+        return false;
+    }
+
+    /* The maps can come from a Tiled map instead, if there is one */
+    char tmx_filename[MAX_DATAFILE_FILENAME_SIZE];
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+
+    get_tmx_file_name(filename, tmx_filename, MAX_DATAFILE_FILENAME_SIZE);
+
+    if (find_data_file(tmx_filename, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+        return read_tmx_file(tmx_filename, room);
+    }
+
+    return true;
+}
+
+/**
+ * "only_defs" is set to false if the file has anything
+ * other than tiles and textures in it.
+ */
+static bool read_room_from_datafile(const char *filename, ROOM *room, bool *only_defs)
+{
+    TOKENIZER tokenizer;
 
     /* Don't do anything if we can't open the file */
-    if (file == NULL) {
+    if (!open_tokenizer(&tokenizer, filename)) {
         fprintf(stderr, "Failed to open filename \"%s\".\n", filename);
         return false;
     }
 
+    TOKEN token;
     char string[MAX_STRING_SIZE];
     int next_enemy = 0;
     int next_exit = 0;
@@ -335,158 +671,130 @@ bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
     }
 
     /* Start reading through the file! */
-    while (fscanf(file, "%s", string) != EOF) {
+    while (next_token(&tokenizer, &token)) {
 
-        //printf("Loading %s...\n", string);
+        KEYWORD keyword = find_keyword(&token);
 
-        /* Ignore comments (lines that begin with a hash) */
-        if (string[0] == '#') {
-            if (fgets(string, MAX_STRING_SIZE, file) == NULL) {
-                fprintf(stderr, "Failed to read comment.\n");
-            }
-            continue;
+        /* Only tiles and textures can be remembered when this file is imported */
+        if (keyword != KEYWORD_TILE && keyword != KEYWORD_TEXTURE) {
+            *only_defs = false;
         }
 
+        switch (keyword) {
+
         /* Import from another data file */
-        if (strncmp(string, "IMPORT", MAX_STRING_SIZE) == 0) {
-            if (fscanf(file, "%s", string) != 1) {
-                fprintf(stderr, "Failed to import.\n");
+        case KEYWORD_IMPORT:
+            if (load_string_from_datafile(&tokenizer, string, MAX_STRING_SIZE, "the file to import")) {
+                import_datafile(string, room);
             }
-            load_room_from_datafile_with_filename(string, room);
-            continue;
-        }
+            break;
 
         /* Title (name) of the room */
-        if (strncmp(string, "TITLE", MAX_STRING_SIZE) == 0) {
-            if (fgets(room->title, MAX_STRING_SIZE, file) != NULL) {
-                /* Get rid of the spaces at the beginning */
-                trim_string(room->title, strlen(room->title));
-            } else {
-                fprintf(stderr, "Failed to read title of room.\n");
-            }
-            continue;
-        }
+        case KEYWORD_TITLE:
+            read_rest_of_line(&tokenizer, room->title, MAX_STRING_SIZE);
+            /* Get rid of the spaces at the beginning */
+            trim_string(room->title, strlen(room->title));
+            break;
+
+        /* Music to play in the room */
+        case KEYWORD_MUSIC:
+            load_string_from_datafile(&tokenizer, room->music, MAX_STRING_SIZE, "music");
+            break;
 
         /* Hero starting position */
-        if (strncmp(string, "START", MAX_STRING_SIZE) == 0) {
+        case KEYWORD_START: {
             int r = 0;
             int c = 0;
-            if (fscanf(file, "%d %d", &r, &c) != 2) {
-                fprintf(stderr, "Failed to load starting row and col.\n");
+            if (!load_int_from_datafile(&tokenizer, &r, "starting row") || !load_int_from_datafile(&tokenizer, &c, "starting col")) {
+                break;
             }
             /* Convert the given values to X / Y position */
             room->start_x = c * TILE_SIZE;
             room->start_y = r * TILE_SIZE;
-            continue;
+            break;
         }
 
         /* Room direction */
-        if (strncmp(string, "DIRECTION", MAX_STRING_SIZE) == 0) {
-            if (fscanf(file, "%s", string) != 1) {
-                fprintf(stderr, "Failed to load direction.\n");
+        case KEYWORD_DIRECTION:
+            if (load_string_from_datafile(&tokenizer, string, MAX_STRING_SIZE, "direction")) {
+                room->direction = string_to_direction(string);
             }
-            room->direction = string_to_direction(string);
-            continue;
-        }
+            break;
 
         /* Room facing */
-        if (strncmp(string, "FACING", MAX_STRING_SIZE) == 0) {
-            if (fscanf(file, "%s", string) != 1) {
-                fprintf(stderr, "Failed to load facing.\n");
+        case KEYWORD_FACING:
+            if (load_string_from_datafile(&tokenizer, string, MAX_STRING_SIZE, "facing")) {
+                room->facing = string_to_direction(string);
             }
-            room->facing = string_to_direction(string);
             if (!(room->facing == RIGHT || room->facing == LEFT)) {
-                fprintf(stderr, "Failed to set facing direction, using RIGHT.\n");
+                tokenizer_error(&tokenizer, &token, "Failed to set facing direction, using RIGHT.");
                 room->facing = RIGHT;
             }
-            continue;
-        }
+            break;
 
         /* Size of the room, in tiles */
-        if (strncmp(string, "SIZE", MAX_STRING_SIZE) == 0) {
-            if (fscanf(file, "%d %d", &room->rows, &room->cols) != 2) {
-                fprintf(stderr, "Failed to load map size.\n");
+        case KEYWORD_SIZE:
+            if (load_int_from_datafile(&tokenizer, &room->rows, "map rows")) {
+                load_int_from_datafile(&tokenizer, &room->cols, "map cols");
             }
-            continue;
-        }
+            if (room->rows < 0 || room->rows > MAX_ROOM_ROWS || room->cols < 0 || room->cols > MAX_ROOM_COLS) {
+                tokenizer_error(&tokenizer, &token, "Failed to set map size, %d %d is too big.", room->rows, room->cols);
+                room->rows = MAX_ROOM_ROWS;
+                room->cols = MAX_ROOM_COLS;
+            }
+            break;
 
         /* A tile (sprite) */
-        if (strncmp(string, "TILE", MAX_STRING_SIZE) == 0) {
+        case KEYWORD_TILE:
             if (room->num_tiles < MAX_TILES) {
-                load_sprite_from_datafile(&room->tiles[room->num_tiles], file);
+                init_texture_def(&room->tile_defs[room->num_tiles], 0);
+                load_texture_def_from_datafile(&room->tile_defs[room->num_tiles], &tokenizer);
                 room->num_tiles++;
             } else {
-                fprintf(stderr, "Failed to load tile, max number reached\n");
+                tokenizer_error(&tokenizer, &token, "Failed to load tile, max number reached");
             }
-            continue;
-        }
+            break;
 
         /* A texture name (used to color blocks and bullets) */
-        if (strncmp(string, "TEXTURE", MAX_STRING_SIZE) == 0) {
+        case KEYWORD_TEXTURE:
             if (room->num_texture_defs < MAX_TEXTURES) {
-                load_texture_def_from_datafile(&room->texture_defs[room->num_texture_defs], file);
+                init_texture_def(&room->texture_defs[room->num_texture_defs], 1);
+                load_texture_def_from_datafile(&room->texture_defs[room->num_texture_defs], &tokenizer);
                 room->num_texture_defs++;
             } else {
-                fprintf(stderr, "Failed to load texture, max number reached\n");
+                tokenizer_error(&tokenizer, &token, "Failed to load texture, max number reached");
             }
-            continue;
-        }
-
-        /* An animated texture (used to color blocks and bullets) */
-        //if (strncmp(string, "TEXTURE_ANIM", MAX_STRING_SIZE) == 0) {
-        //    if (room->num_texture_anims < MAX_TEXTURES) {
-        //        load_sprite_from_datafile(&room->texture_anims[room->num_texture_anims], file);
-        //        room->num_texture_anims++;
-        //    } else {
-        //        fprintf(stderr, "Failed to load texture, max number reached\n");
-        //    }
-        //    continue;
-        //}
-
-        /* A texture name (used to color blocks and bullets) */
-        //if (strncmp(string, "TEXTURE", MAX_STRING_SIZE) == 0) {
-        //    if (room->num_textures < MAX_TEXTURES && fscanf(file, "%s", room->textures[room->num_textures]) == 1) {
-        //        room->num_textures++;
-        //    } else {
-        //        fprintf(stderr, "Failed to load texture, max number reached\n");
-        //    }
-        //    continue;
-        //}
+            break;
 
         /* Fargound map */
-        if (strncmp(string, "FARGROUND", MAX_STRING_SIZE) == 0) {
-            load_map_from_datafile(room->farground_map, room->rows, room->cols, file);
-            continue;
-        }
+        case KEYWORD_FARGROUND:
+            load_map_from_datafile(room->farground_map, room->rows, room->cols, &tokenizer);
+            break;
 
         /* Background map */
-        if (strncmp(string, "BACKGROUND", MAX_STRING_SIZE) == 0) {
-            load_map_from_datafile(room->background_map, room->rows, room->cols, file);
-            continue;
-        }
+        case KEYWORD_BACKGROUND:
+            load_map_from_datafile(room->background_map, room->rows, room->cols, &tokenizer);
+            break;
 
         /* Foreground map */
-        if (strncmp(string, "FOREGROUND", MAX_STRING_SIZE) == 0) {
-            load_map_from_datafile(room->foreground_map, room->rows, room->cols, file);
+        case KEYWORD_FOREGROUND:
+            load_map_from_datafile(room->foreground_map, room->rows, room->cols, &tokenizer);
             foreground_map_used = true;
-            continue;
-        }
+            break;
 
         /* Collision map */
-        if (strncmp(string, "COLLISION", MAX_STRING_SIZE) == 0) {
-            load_map_from_datafile(room->collision_map, room->rows, room->cols, file);
+        case KEYWORD_COLLISION:
+            load_map_from_datafile(room->collision_map, room->rows, room->cols, &tokenizer);
             collision_map_used = true;
-            continue;
-        }
+            break;
 
         /* Block map (original) */
-        if (strncmp(string, "BLOCKS", MAX_STRING_SIZE) == 0) {
-            load_map_from_datafile(room->block_map_orig, room->rows, room->cols, file);
-            continue;
-        }
+        case KEYWORD_BLOCKS:
+            load_map_from_datafile(room->block_map_orig, room->rows, room->cols, &tokenizer);
+            break;
 
         /* Enemy */
-        if (strncmp(string, "ENEMY", MAX_STRING_SIZE) == 0) {
+        case KEYWORD_ENEMY: {
 
             char type[MAX_STRING_SIZE];
             int row;
@@ -494,8 +802,17 @@ bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
             int speed;
             int dist;
 
-            if (fscanf(file, "%s %d %d %d %d", type, &row, &col, &speed, &dist) != 5) {
-                fprintf(stderr, "Failed to load enemy.\n");
+            if (!load_string_from_datafile(&tokenizer, type, MAX_STRING_SIZE, "enemy type") ||
+                    !load_int_from_datafile(&tokenizer, &row, "enemy row") ||
+                    !load_int_from_datafile(&tokenizer, &col, "enemy col") ||
+                    !load_int_from_datafile(&tokenizer, &speed, "enemy speed") ||
+                    !load_int_from_datafile(&tokenizer, &dist, "enemy dist")) {
+                break;
+            }
+
+            if (next_enemy >= MAX_ENEMIES) {
+                tokenizer_error(&tokenizer, &token, "Failed to load enemy, max number reached");
+                break;
             }
 
             ENEMY_DEFINITION *definition = &room->enemy_definitions[next_enemy];
@@ -509,17 +826,23 @@ bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
 
             next_enemy++;
 
-            continue;
+            break;
         }
 
         /* Exit */
-        if (strncmp(string, "EXIT", MAX_STRING_SIZE) == 0) {
+        case KEYWORD_EXIT: {
 
             char direction[MAX_STRING_SIZE];
             int tile_num;
 
-            if (fscanf(file, "%s %d", direction, &tile_num) != 2) {
-                fprintf(stderr, "Failed to load exit.\n");
+            if (!load_string_from_datafile(&tokenizer, direction, MAX_STRING_SIZE, "exit direction") ||
+                    !load_int_from_datafile(&tokenizer, &tile_num, "exit tile")) {
+                break;
+            }
+
+            if (next_exit >= MAX_EXITS) {
+                tokenizer_error(&tokenizer, &token, "Failed to load exit, max number reached");
+                break;
             }
 
             EXIT *exit = &room->exits[next_exit];
@@ -544,15 +867,69 @@ bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
 
             next_exit++;
 
-            continue;
+            break;
         }
 
         /* WHAT THE HECK SHOULD I DO WITH THIS UNRECOGNIZED WORD IN THE DATA FILE??? */
         /* Just ignore it ;) */
-        fprintf(stderr, "Failed to recognize %s\n", string);
+        default:
+            tokenizer_error(&tokenizer, &token, "Failed to recognize %.*s", token.len, token.start);
+            break;
+        }
+    }
+
+    close_tokenizer(&tokenizer);
+
+    /* If there's no collision map, just create one based on the foreground map */
+    if (foreground_map_used && !collision_map_used) {
+        for (int i = 0; i < room->rows * room->cols; i++) {
+            room->collision_map[i] = room->foreground_map[i] == -1 ? NO_COLLISION : COLLISION;
+        }
+    }
+
+    return true;
+}
+
+/* Just enough sprites for the tiles or blocks in a room */
+static DRC_SPRITE *create_room_sprites(const char *label, int len)
+{
+    if (len == 0) {
+        return NULL;
+    }
+
+    DRC_SPRITE *sprites = drc_arena_alloc_memory(drc_get_room_arena(), label, len * sizeof(DRC_SPRITE));
+    assert(sprites != NULL);
+
+    for (int i = 0; i < len; i++) {
+        drc_init_sprite(&sprites[i], false, 0);
     }
 
-    close_data_file(file);
+    return sprites;
+}
+
+void finish_loading_room(ROOM *room)
+{
+    /**
+     * In case the room was already finished once.
+     * Only the room being played is ever finished, so everything
+     * in the room arena belongs to the last room and can go.
+     */
+    free_room(room);
+    drc_reset_arena(drc_get_room_arena());
+
+    /* Create sprites for each tile, based on the list of tile definitions */
+    room->tiles = create_room_sprites("ROOM->tiles", room->num_tiles);
+
+    ALLEGRO_BITMAP *frames[MAX_FRAMES];
+
+    for (int i = 0; i < room->num_tiles; i++) {
+        TEXTURE_DEF *tile_def = &room->tile_defs[i];
+        for (int j = 0; j < tile_def->len; j++) {
+            frames[j] = DRC_IMG(get_name(tile_def->frames[j]));
+        }
+        drc_set_animation(&room->tiles[i], drc_get_animation(frames, tile_def->len, tile_def->speed, tile_def->loop));
+        drc_put_sprite_on_clock(&room->tiles[i]);
+    }
 
     /**
      * Blocks needs to be initialized into sprites and random blocks
@@ -560,55 +937,142 @@ bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
      */
 
     /* Create sprites to represent each block, based on the list of textures */
+    room->blocks = create_room_sprites("ROOM->blocks", room->num_texture_defs);
+
     for (int i = 0; i < room->num_texture_defs; i++) {
-        DRC_SPRITE *block = &room->blocks[i];
-        for (int j = 0; j < room->texture_defs[i].len; j++) {
-            drc_add_frame(block, MASKED_IMG(room->texture_defs[i].frames[j], "mask-block.png"));
-        }
-        block->speed = room->texture_defs[i].speed;
-        if (block->len > 0) {
-            block->loop = true;
+        TEXTURE_DEF *texture_def = &room->texture_defs[i];
+        for (int j = 0; j < texture_def->len; j++) {
+            frames[j] = MASKED_IMG(get_name(texture_def->frames[j]), "mask-block.png");
         }
+        drc_set_animation(&room->blocks[i], drc_get_animation(frames, texture_def->len, texture_def->speed, texture_def->len > 0));
+        drc_put_sprite_on_clock(&room->blocks[i]);
     }
 
-    //for (int i = 0; i < room->num_textures; i++) {
-    //    drc_add_frame(&room->blocks[i], MASKED_IMG(room->textures[i], "mask-block.png"));
-    //}
-
-    /* Add any animated textures */
-    //for (int i = 0; i < room->num_texture_anims; i++) {
-    //    drc_copy_sprite(&room->blocks[room->num_textures + i], &room->texture_anims[i]);
-    //}
-    //room->num_textures += room->num_texture_anims;
-    //printf("Num textures %d\n", room->num_textures);
-
     /* Init any random blocks (any number < 0) */
     for (int i = 0; i < room->rows * room->cols; i++) {
         if (room->block_map_orig[i] == RANDOM_BLOCK) {
             /* Set the block to a random texture */
-            room->block_map_orig[i] = drc_random_number(0, room->num_texture_defs - 1);
+            room->block_map_orig[i] = drc_random_number_from(DRC_RANDOM_STREAM_LEVEL, 0, room->num_texture_defs - 1);
         }
     }
 
-    /* If there's no collision map, just create one based on the foreground map */
-    if (foreground_map_used && !collision_map_used) {
-        for (int i = 0; i < room->rows * room->cols; i++) {
-            room->collision_map[i] = room->foreground_map[i] == -1 ? NO_COLLISION : COLLISION;
-        }
-    }
+    /* The door, for when the room is cleared */
+    drc_add_frame(&room->door_sprite, DRC_IMG("tile-door.png"));
 
     /* Uncomment if you want to see what was loaded in this room */
     //print_room(room, false);
+}
+
+time_t get_room_source_mtime(const char *filename)
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+    char tmx_filename[MAX_DATAFILE_FILENAME_SIZE];
+    time_t mtime = 0;
+
+    if (find_data_file(filename, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+        mtime = get_file_mtime(fullpath);
+    }
+
+    get_tmx_file_name(filename, tmx_filename, MAX_DATAFILE_FILENAME_SIZE);
+
+    if (find_data_file(tmx_filename, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+        time_t tmx_mtime = get_file_mtime(fullpath);
+        if (tmx_mtime > mtime) {
+            mtime = tmx_mtime;
+        }
+    }
+
+    return mtime;
+}
+
+/**
+ * The compiled room is only used if it's at least as new as
+ * the text data file (and Tiled map), so that changes to them
+ * aren't ignored. If there's no text data file, the compiled
+ * room is all there is. The files it imports are checked
+ * once it's read, with "is_room_newer_than_imports".
+ */
+static time_t get_room_file_mtime(const char *room_filename)
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+
+    if (!find_data_file(room_filename, fullpath, MAX_DATAFILE_FILENAME_SIZE)) {
+        return 0;
+    }
+
+    return get_file_mtime(fullpath);
+}
+
+static bool is_room_file_current(const char *filename, const char *room_filename)
+{
+    time_t mtime = get_room_file_mtime(room_filename);
+
+    return mtime > 0 && mtime >= get_room_source_mtime(filename);
+}
+
+bool is_room_newer_than_imports(ROOM *room, time_t mtime)
+{
+    char fullpath[MAX_DATAFILE_FILENAME_SIZE];
+
+    for (int i = 0; i < room->num_imports; i++) {
+        if (find_data_file(get_name(room->imports[i]), fullpath, MAX_DATAFILE_FILENAME_SIZE) &&
+                get_file_mtime(fullpath) > mtime) {
+            return false;
+        }
+    }
 
     return true;
 }
 
+bool read_room_with_filename(const char *filename, ROOM *room)
+{
+    char room_filename[MAX_DATAFILE_FILENAME_SIZE];
+    bool success = false;
+
+    /* Use the compiled room if there is one, it's much faster */
+    get_room_file_name(filename, room_filename, MAX_DATAFILE_FILENAME_SIZE);
+
+    if (is_room_file_current(filename, room_filename)) {
+        success = read_room_file(room_filename, room);
+        if (!success) {
+            /* Start over with the text data file */
+            fprintf(stderr, "Failed to read compiled room \"%s\", using \"%s\" instead.\n", room_filename, filename);
+            init_room(room);
+        } else if (!is_room_newer_than_imports(room, get_room_file_mtime(room_filename))) {
+            /* A file that it imports changed since it was compiled */
+            success = false;
+            init_room(room);
+        }
+    }
+
+    if (!success) {
+        success = read_room_from_datafile_with_filename(filename, room);
+    }
+
+    return success;
+}
+
+bool load_room_from_datafile_with_filename(const char *filename, ROOM *room)
+{
+    DRC_TRACE_BEGIN("load_room", filename);
+
+    bool success = read_room_with_filename(filename, room);
+
+    if (success) {
+        finish_loading_room(room);
+    }
+
+    DRC_TRACE_END();
+
+    return success;
+}
+
 bool load_room_list_from_datafile_with_filename(const char *filename, ROOM_LIST *room_list)
 {
-    FILE *file = open_data_file(filename);
+    TOKENIZER tokenizer;
 
     /* Don't do anything if we can't open the file */
-    if (file == NULL) {
+    if (!open_tokenizer(&tokenizer, filename)) {
         fprintf(stderr, "Failed to open filename \"%s\".\n", filename);
         return false;
     }
@@ -616,12 +1080,16 @@ bool load_room_list_from_datafile_with_filename(const char *filename, ROOM_LIST
     /* Reset the number of rooms */
     room_list->size = 0;
 
+    TOKEN token;
+
     /* Save the contents of the file to the list of room names */
-    while (room_list->size < MAX_ROOMS && fscanf(file, "%s", room_list->filenames[room_list->size]) != EOF) {
-        room_list->size++;
+    while (next_token(&tokenizer, &token)) {
+        char room_filename[MAX_FILENAME_LEN];
+        token_to_string(&token, room_filename, MAX_FILENAME_LEN);
+        add_room_to_room_list(room_list, room_filename);
     }
 
-    close_data_file(file);
+    close_tokenizer(&tokenizer);
 
     /*
     printf("Room list loaded:\n");
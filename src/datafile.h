@@ -1,5 +1,6 @@
 #pragma once
 
+#include <time.h>
 #include "gamedata.h"
 #include "roomlist.h"
 
@@ -18,6 +19,18 @@
  */
 void add_datafile_path(const char *path);
 
+/**
+ * Forget all of the datafile paths.
+ */
+void clear_datafile_paths(void);
+
+/**
+ * Find a data file, taking into account datafile paths.
+ * Returns true and puts the path to the file in
+ * "fullpath" if it was found.
+ */
+bool find_data_file(const char *name, char *fullpath, int size);
+
 /**
  * Open a data file, taking into account datafile paths.
  * Returns a pointer to the file on success,
@@ -28,12 +41,89 @@ void add_datafile_path(const char *path);
 FILE *open_data_file(const char *name);
 void close_data_file(FILE *file);
 
+/**
+ * Same as above, but with the mode to give to "fopen"
+ * (such as "rb" for binary files).
+ */
+FILE *open_data_file_with_mode(const char *name, const char *mode);
+
+/**
+ * When a file was last changed, or 0 if it doesn't exist.
+ * This is a full path, it does NOT use datafile paths.
+ */
+time_t get_file_mtime(const char *fullpath);
+
+/**
+ * The type of enemy with this name, as it's written in a
+ * data file (such as "LEFTRIGHT"), or ENEMY_TYPE_NONE.
+ */
+ENEMY_TYPE get_enemy_type(const char *type);
+
 /**
  * Load a room from the data in the given file.
  * Returns true if the room was successfully loaded.
+ *
+ * If there's a compiled version of the room (see "roomfile.h")
+ * that is up to date then that is loaded instead.
  */
 bool load_room_from_datafile_with_filename(const char *filename, ROOM *room);
 
+/**
+ * Read a room from a text data file (and any files that it
+ * imports, and its Tiled map, see "tmxfile.h") without loading
+ * any images. The room isn't ready to be used until it's
+ * finished with "finish_loading_room".
+ */
+bool read_room_from_datafile_with_filename(const char *filename, ROOM *room);
+
+/**
+ * When the text data file or Tiled map of a room was last
+ * changed, whichever is newer, or 0 if neither can be found.
+ * Files that the room imports aren't checked.
+ */
+time_t get_room_source_mtime(const char *filename);
+
+/**
+ * Returns false if any of the files that the room imports
+ * were changed after "mtime", such as when the room was compiled.
+ */
+bool is_room_newer_than_imports(ROOM *room, time_t mtime);
+
+/**
+ * Read a room without loading any images, from the compiled
+ * room if it's up to date (along with everything it imports)
+ * or else the text data file.
+ * This is the first half of "load_room_from_datafile_with_filename",
+ * and it's safe to call from more than one thread at a time
+ * (see "share_import_cache_between_threads").
+ */
+bool read_room_with_filename(const char *filename, ROOM *room);
+
+/**
+ * Tiles and textures from files that are IMPORTed are remembered,
+ * so each file is only read once (unless it changes).
+ * Free them with this when done loading rooms.
+ */
+void free_import_cache(void);
+
+/**
+ * Call this before reading rooms on more than one thread at a time.
+ * The import cache stays shared until it's freed.
+ */
+void share_import_cache_between_threads(void);
+
+/**
+ * Print how many times imported files were read, and
+ * how many times they were copied from memory instead.
+ */
+void print_import_cache_stats(void);
+
+/**
+ * Load the images for the tiles and blocks in a room that
+ * was just read, and pick the color of any random blocks.
+ */
+void finish_loading_room(ROOM *room);
+
 /**
  * A room list is a text file with a list of datafiles for rooms.
  */
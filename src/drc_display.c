@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "drc_display.h"
+#include "drc_run.h"
 
 static ALLEGRO_DISPLAY *drc_display = NULL;
 
@@ -167,6 +168,13 @@ bool drc_init_display(int width, int height, int scale, bool fullscreen)
     } else {
         al_set_new_display_flags(ALLEGRO_WINDOWED);
     }
+
+    /* Only wait for the monitor to refresh if the game loop is going to draw that way */
+    if (drc_get_run_policy() == DRC_RUN_POLICY_VSYNC) {
+        al_set_new_display_option(ALLEGRO_VSYNC, 1, ALLEGRO_SUGGEST);
+    } else {
+        al_set_new_display_option(ALLEGRO_VSYNC, 2, ALLEGRO_SUGGEST);
+    }
   
     /**
      * Find out how many times we can scale the window and still fit
@@ -1,21 +1,176 @@
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include "drc_memory.h"
 
+/* Arenas get memory from the system in chunks this big, or bigger */
+#define DRC_ARENA_CHUNK_SIZE (64 * 1024)
+
+/* Everything handed out is lined up for any type */
+#define DRC_MEMORY_ALIGN (alignof(max_align_t))
+
 /**
  * The number of times memory has been allocated.
+ * Rooms can be read on other threads, so it's atomic.
  */
-static int drc_num_alloc = 0;
+static atomic_int drc_num_alloc = 0;
 
 /**
  * The number of times memory has been freed.
  */
-static int drc_num_free = 0;
+static atomic_int drc_num_free = 0;
 
 /**
  * Whether or not to show the label.
  */
 static int drc_is_debug_memory = 0;
 
+typedef struct
+{
+    const char *label;
+
+    /* In bytes */
+    long live;
+    long peak;
+
+    int num_alloc;
+    int num_free;
+} DRC_MEMORY_LABEL;
+
+static DRC_MEMORY_LABEL drc_memory_labels[DRC_MAX_MEMORY_LABELS];
+static int drc_num_memory_labels = 0;
+
+/* Only held for a moment, so it just spins */
+static atomic_flag drc_memory_labels_lock = ATOMIC_FLAG_INIT;
+
+/**
+ * Put in front of memory from "drc_alloc_memory",
+ * so it's known how big it is when it's freed.
+ */
+typedef union
+{
+    struct {
+        size_t size;
+        int label;
+    } info;
+    max_align_t align;
+} DRC_MEMORY_HEADER;
+
+typedef struct DRC_ARENA_CHUNK
+{
+    struct DRC_ARENA_CHUNK *next;
+    size_t size;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+} DRC_ARENA_CHUNK;
+
+struct DRC_ARENA
+{
+    const char *name;
+
+    /* The smallest chunk to take from the system */
+    size_t chunk_size;
+
+    /* The newest chunk is first, it's the one being used */
+    DRC_ARENA_CHUNK *chunks;
+
+    /* In bytes, taken from the system */
+    size_t reserved;
+
+    /* In bytes, handed out since the last reset */
+    size_t used;
+    size_t peak;
+
+    /* What each label has from this arena, so it can be given back on reset */
+    long label_bytes[DRC_MAX_MEMORY_LABELS];
+    int label_allocs[DRC_MAX_MEMORY_LABELS];
+
+    atomic_flag lock;
+};
+
+static DRC_ARENA drc_global_arena = {.name = "GLOBAL", .chunk_size = DRC_ARENA_CHUNK_SIZE, .lock = ATOMIC_FLAG_INIT};
+static DRC_ARENA drc_room_arena = {.name = "ROOM", .chunk_size = DRC_ARENA_CHUNK_SIZE, .lock = ATOMIC_FLAG_INIT};
+static DRC_ARENA drc_frame_arena = {.name = "FRAME", .chunk_size = DRC_FRAME_MEMORY_SIZE, .lock = ATOMIC_FLAG_INIT};
+
+/* The most frame memory used that was already warned about */
+static size_t drc_frame_memory_warned = DRC_FRAME_MEMORY_SIZE;
+
+static void drc_lock(atomic_flag *lock)
+{
+    while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire)) {
+        /* Wait */
+    }
+}
+
+static void drc_unlock(atomic_flag *lock)
+{
+    atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+/* The labels have to be locked */
+static int drc_find_memory_label(const char *label)
+{
+    if (label == NULL) {
+        label = "";
+    }
+
+    /* Labels are almost always the same string, so check that first */
+    for (int i = 0; i < drc_num_memory_labels; i++) {
+        if (drc_memory_labels[i].label == label) {
+            return i;
+        }
+    }
+
+    for (int i = 0; i < drc_num_memory_labels; i++) {
+        if (strcmp(drc_memory_labels[i].label, label) == 0) {
+            return i;
+        }
+    }
+
+    /* The last one is for everything that doesn't fit */
+    if (drc_num_memory_labels == DRC_MAX_MEMORY_LABELS - 1) {
+        label = "OTHER";
+    }
+
+    if (drc_num_memory_labels < DRC_MAX_MEMORY_LABELS) {
+        drc_memory_labels[drc_num_memory_labels].label = label;
+        drc_num_memory_labels++;
+    }
+
+    return drc_num_memory_labels - 1;
+}
+
+static int drc_count_alloc(const char *label, size_t size)
+{
+    drc_lock(&drc_memory_labels_lock);
+
+    int n = drc_find_memory_label(label);
+    DRC_MEMORY_LABEL *stats = &drc_memory_labels[n];
+
+    stats->live += size;
+    stats->num_alloc++;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+
+    drc_unlock(&drc_memory_labels_lock);
+
+    return n;
+}
+
+static void drc_count_free(int n, size_t size, int num_free)
+{
+    drc_lock(&drc_memory_labels_lock);
+
+    drc_memory_labels[n].live -= size;
+    drc_memory_labels[n].num_free += num_free;
+
+    drc_unlock(&drc_memory_labels_lock);
+}
+
 void drc_show_memory_debug(void)
 {
     drc_is_debug_memory = 1;
@@ -23,52 +178,265 @@ void drc_show_memory_debug(void)
 
 void *drc_alloc_memory(const char *label, size_t size)
 {
-    if (size > 0) {
+    if (drc_is_debug_memory) {
+        printf("Allocating memory for: %s\n", label);
+    }
 
-        if (drc_is_debug_memory) {
-            printf("Allocating memory for: %s\n", label);
-        }
+    /* calloc initializes everything to 0 */
+    DRC_MEMORY_HEADER *header = calloc(1, sizeof(DRC_MEMORY_HEADER) + size);
 
-        drc_num_alloc++;
+    if (header == NULL) {
+        return NULL;
     }
 
-    /* calloc initializes everything to 0 */
-    return calloc(1, size);
+    header->info.size = size;
+    header->info.label = drc_count_alloc(label, size);
+
+    drc_num_alloc++;
+
+    return header + 1;
 }
 
 void *drc_calloc_memory(const char *label, size_t nmemb, size_t size)
 {
-    if (nmemb > 0 && size > 0) {
+    if (size > 0 && nmemb > ((size_t)-1 - sizeof(DRC_MEMORY_HEADER)) / size) {
+        return NULL;
+    }
 
-        if (drc_is_debug_memory) {
-            printf("CAllocating memory for: %s\n", label);
-        }
+    if (drc_is_debug_memory) {
+        printf("CAllocating memory for: %s\n", label);
+    }
 
-        drc_num_alloc++;
+    DRC_MEMORY_HEADER *header = calloc(1, sizeof(DRC_MEMORY_HEADER) + (nmemb * size));
+
+    if (header == NULL) {
+        return NULL;
     }
 
-    return calloc(nmemb, size);
+    header->info.size = nmemb * size;
+    header->info.label = drc_count_alloc(label, nmemb * size);
+
+    drc_num_alloc++;
+
+    return header + 1;
 }
 
 void *drc_free_memory(const char *label, void *ptr)
 {
-    if (ptr != NULL) {
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    if (drc_is_debug_memory) {
+        printf("Freeing memory for: %s\n", label);
+    }
+
+    /* It's counted under the label it was allocated with */
+    DRC_MEMORY_HEADER *header = (DRC_MEMORY_HEADER *)ptr - 1;
+    drc_count_free(header->info.label, header->info.size, 1);
+
+    drc_num_free++;
+
+    free(header);
+
+    return NULL;
+}
+
+DRC_ARENA *drc_get_global_arena(void)
+{
+    return &drc_global_arena;
+}
+
+DRC_ARENA *drc_get_room_arena(void)
+{
+    return &drc_room_arena;
+}
+
+static DRC_ARENA_CHUNK *drc_add_arena_chunk(DRC_ARENA *arena, size_t size)
+{
+    if (size < arena->chunk_size) {
+        size = arena->chunk_size;
+    }
+
+    DRC_ARENA_CHUNK *chunk = malloc(sizeof(DRC_ARENA_CHUNK) + size);
+
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = arena->chunks;
+
+    arena->chunks = chunk;
+    arena->reserved += size;
+
+    return chunk;
+}
+
+void *drc_arena_alloc_memory(DRC_ARENA *arena, const char *label, size_t size)
+{
+    assert(arena != NULL);
+
+    if (drc_is_debug_memory) {
+        printf("Allocating arena memory for: %s\n", label);
+    }
 
-        if (drc_is_debug_memory) {
-            printf("Freeing memory for: %s\n", label);
+    /* Keep the next piece lined up */
+    size_t aligned_size = (size + DRC_MEMORY_ALIGN - 1) & ~(DRC_MEMORY_ALIGN - 1);
+
+    drc_lock(&arena->lock);
+
+    DRC_ARENA_CHUNK *chunk = arena->chunks;
+
+    if (chunk == NULL || chunk->size - chunk->used < aligned_size) {
+        chunk = drc_add_arena_chunk(arena, aligned_size);
+        if (chunk == NULL) {
+            drc_unlock(&arena->lock);
+            return NULL;
         }
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += aligned_size;
 
-        drc_num_free++;
+    arena->used += aligned_size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
     }
 
-    free(ptr);
-    
-    return NULL;
+    int n = drc_count_alloc(label, size);
+    arena->label_bytes[n] += size;
+    arena->label_allocs[n]++;
+
+    drc_unlock(&arena->lock);
+
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+char *drc_arena_copy_string(DRC_ARENA *arena, const char *label, const char *string)
+{
+    size_t len = strlen(string) + 1;
+
+    char *copy = drc_arena_alloc_memory(arena, label, len);
+    assert(copy != NULL);
+    memcpy(copy, string, len);
+
+    return copy;
+}
+
+void drc_reset_arena(DRC_ARENA *arena)
+{
+    assert(arena != NULL);
+
+    drc_lock(&arena->lock);
+
+    /* Keep the first chunk, it will almost certainly be needed again */
+    DRC_ARENA_CHUNK *chunk = arena->chunks;
+
+    while (chunk != NULL && chunk->next != NULL) {
+        DRC_ARENA_CHUNK *next = chunk->next;
+        arena->reserved -= chunk->size;
+        free(chunk);
+        chunk = next;
+    }
+
+    if (chunk != NULL) {
+        chunk->used = 0;
+    }
+
+    arena->chunks = chunk;
+    arena->used = 0;
+
+    for (int i = 0; i < DRC_MAX_MEMORY_LABELS; i++) {
+        if (arena->label_allocs[i] > 0) {
+            drc_count_free(i, arena->label_bytes[i], arena->label_allocs[i]);
+            arena->label_bytes[i] = 0;
+            arena->label_allocs[i] = 0;
+        }
+    }
+
+    drc_unlock(&arena->lock);
+}
+
+void *drc_alloc_frame_memory(const char *label, size_t size)
+{
+    return drc_arena_alloc_memory(&drc_frame_arena, label, size);
+}
+
+void drc_reset_frame_memory(void)
+{
+    /* Nothing to do most of the time */
+    if (drc_frame_arena.used == 0) {
+        return;
+    }
+
+    if (drc_frame_arena.used > drc_frame_memory_warned) {
+        fprintf(stderr, "Frame memory is over budget, %zu of %d bytes were used in one update.\n",
+            drc_frame_arena.used, DRC_FRAME_MEMORY_SIZE);
+        drc_frame_memory_warned = drc_frame_arena.used;
+    }
+
+    drc_reset_arena(&drc_frame_arena);
+}
+
+static void drc_free_arena(DRC_ARENA *arena)
+{
+    drc_reset_arena(arena);
+
+    if (arena->chunks != NULL) {
+        arena->reserved -= arena->chunks->size;
+        free(arena->chunks);
+        arena->chunks = NULL;
+    }
+}
+
+void drc_free_arenas(void)
+{
+    drc_free_arena(&drc_global_arena);
+    drc_free_arena(&drc_room_arena);
+    drc_free_arena(&drc_frame_arena);
+}
+
+static void drc_print_arena_stats(DRC_ARENA *arena)
+{
+    printf("  %-8s arena: %zu bytes used, %zu at most, %zu taken from the system\n",
+        arena->name, arena->used, arena->peak, arena->reserved);
+}
+
+void drc_print_memory_stats(void)
+{
+    drc_lock(&drc_memory_labels_lock);
+
+    printf("Memory:\n");
+    printf("  %-32s %10s %10s %8s %8s\n", "LABEL", "BYTES", "PEAK", "ALLOCS", "FREES");
+
+    for (int i = 0; i < drc_num_memory_labels; i++) {
+        DRC_MEMORY_LABEL *stats = &drc_memory_labels[i];
+        printf("  %-32s %10ld %10ld %8d %8d\n", stats->label, stats->live, stats->peak, stats->num_alloc, stats->num_free);
+    }
+
+    drc_unlock(&drc_memory_labels_lock);
+
+    drc_print_arena_stats(&drc_global_arena);
+    drc_print_arena_stats(&drc_room_arena);
+    drc_print_arena_stats(&drc_frame_arena);
 }
 
 void drc_check_memory(void)
 {
     if (drc_num_alloc != drc_num_free) {
-        fprintf(stderr, "Memory warning! alloc: %d free: %d\n", drc_num_alloc, drc_num_free);
+        fprintf(stderr, "Memory warning! alloc: %d free: %d\n", (int)drc_num_alloc, (int)drc_num_free);
+    }
+
+    /* Arenas count too, in case they weren't freed */
+    for (int i = 0; i < drc_num_memory_labels; i++) {
+        DRC_MEMORY_LABEL *stats = &drc_memory_labels[i];
+        if (stats->num_alloc != stats->num_free) {
+            fprintf(stderr, "Memory warning! %s: %ld bytes in %d allocations were never freed\n",
+                stats->label, stats->live, stats->num_alloc - stats->num_free);
+        }
     }
 }
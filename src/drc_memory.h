@@ -2,6 +2,16 @@
 
 #include <malloc.h>
 
+/**
+ * Every allocation has a label, such as "DRC_RESOURCE->name",
+ * and the memory used by each label is tracked: how many bytes
+ * are being used right now, the most that were ever used at once,
+ * and how many times memory was allocated and freed.
+ */
+
+/* Labels after this many are all counted together as "OTHER" */
+#define DRC_MAX_MEMORY_LABELS (128)
+
 /**
  * Print info about allocations to stdout.
  */
@@ -23,8 +33,69 @@ void *drc_calloc_memory(const char *label, size_t nmemb, size_t size);
  */
 void *drc_free_memory(const char *label, void *ptr);
 
+/**
+ * An arena hands out memory from big chunks, one piece after
+ * the other, and it's all freed at once when the arena is reset.
+ * It's much faster than "malloc" for lots of little things
+ * (such as names and paths) that are all freed at the same time.
+ * Memory from an arena is never freed with "drc_free_memory".
+ *
+ * Arenas can be used from more than one thread at a time.
+ */
+typedef struct DRC_ARENA DRC_ARENA;
+
+/* For things that are kept until the game is done */
+DRC_ARENA *drc_get_global_arena(void);
+
+/**
+ * For the room being played, it's reset
+ * when the next room is finished loading.
+ */
+DRC_ARENA *drc_get_room_arena(void);
+
+/**
+ * Get memory from an arena, set to 0.
+ * It's counted under the label, the same as "drc_alloc_memory".
+ */
+void *drc_arena_alloc_memory(DRC_ARENA *arena, const char *label, size_t size);
+
+/* Copy a string into an arena */
+char *drc_arena_copy_string(DRC_ARENA *arena, const char *label, const char *string);
+
+/**
+ * Free everything in the arena all at once. Anything
+ * that points to memory from the arena is no longer valid.
+ */
+void drc_reset_arena(DRC_ARENA *arena);
+
+/**
+ * Frame memory is for things that are only needed for a moment,
+ * such as a list that's made and used in the same function. It's
+ * all freed at the start of every update, by "drc_run", so it
+ * can't be kept any longer than that, and it should only be used
+ * from the game loop. It comes from an arena, see above.
+ *
+ * It's meant to fit in DRC_FRAME_MEMORY_SIZE bytes. If it doesn't,
+ * it still works but a warning is printed, each time it's more than
+ * ever before.
+ */
+#define DRC_FRAME_MEMORY_SIZE (256 * 1024)
+
+void *drc_alloc_frame_memory(const char *label, size_t size);
+
+void drc_reset_frame_memory(void);
+
+/* Free the memory of every arena, before "drc_check_memory" */
+void drc_free_arenas(void);
+
+/**
+ * Print the memory used by each label, and by each arena.
+ */
+void drc_print_memory_stats(void);
+
 /**
  * Check to see if the number of allocations
- * matches the number of frees.
+ * matches the number of frees, and which
+ * labels still have memory that wasn't freed.
  */
 void drc_check_memory(void);
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <string.h>
+#include "drc_music.h"
+#include "drc_resources.h"
+#include "drc_sound.h"
+
+typedef struct
+{
+    ALLEGRO_AUDIO_STREAM *stream;
+    char name[MAX_FILENAME_LEN];
+
+    /* Fading from one gain to another, starting at "fade_start" */
+    float from_gain;
+    float to_gain;
+    double fade_start;
+    double fade_secs;
+
+    /* Memory used by the buffers, and if it was all decoded at once */
+    long buffer_bytes;
+    long decoded_bytes;
+} DRC_SONG;
+
+/* The song that's playing, and the one fading out */
+static DRC_SONG drc_song;
+static DRC_SONG drc_old_song;
+
+static bool drc_is_music_init = false;
+static int drc_music_buffer_samples = DRC_DEFAULT_MUSIC_BUFFER_SAMPLES;
+
+/* Stats */
+static int drc_num_songs_played = 0;
+static long drc_most_music_buffer_bytes = 0;
+static long drc_most_music_decoded_bytes = 0;
+
+bool drc_init_music(int buffer_samples)
+{
+    if (!al_is_audio_installed() || al_get_default_mixer() == NULL) {
+        return false;
+    }
+
+    drc_music_buffer_samples = buffer_samples > 0 ? buffer_samples : DRC_DEFAULT_MUSIC_BUFFER_SAMPLES;
+    drc_is_music_init = true;
+
+    return true;
+}
+
+static void drc_stop_song(DRC_SONG *song)
+{
+    if (song->stream != NULL) {
+        al_destroy_audio_stream(song->stream);
+    }
+
+    memset(song, 0, sizeof(DRC_SONG));
+}
+
+void drc_free_music(void)
+{
+    drc_stop_song(&drc_song);
+    drc_stop_song(&drc_old_song);
+
+    drc_is_music_init = false;
+}
+
+static float drc_get_song_gain(DRC_SONG *song, double now)
+{
+    if (song->fade_secs <= 0 || now - song->fade_start >= song->fade_secs) {
+        return song->to_gain;
+    }
+
+    float done = (float)((now - song->fade_start) / song->fade_secs);
+
+    return song->from_gain + ((song->to_gain - song->from_gain) * done);
+}
+
+static void drc_fade_song(DRC_SONG *song, float to_gain, double fade_secs, double now)
+{
+    song->from_gain = drc_get_song_gain(song, now);
+    song->to_gain = to_gain;
+    song->fade_start = now;
+    song->fade_secs = fade_secs;
+}
+
+static void drc_count_music_memory(void)
+{
+    long buffer_bytes = drc_song.buffer_bytes + drc_old_song.buffer_bytes;
+    long decoded_bytes = drc_song.decoded_bytes + drc_old_song.decoded_bytes;
+
+    if (buffer_bytes > drc_most_music_buffer_bytes) {
+        drc_most_music_buffer_bytes = buffer_bytes;
+    }
+
+    if (decoded_bytes > drc_most_music_decoded_bytes) {
+        drc_most_music_decoded_bytes = decoded_bytes;
+    }
+}
+
+static bool drc_start_song(DRC_SONG *song, const char *name)
+{
+    char fullpath[MAX_FILEPATH_LEN];
+
+    if (!drc_find_resource_file(name, fullpath, MAX_FILEPATH_LEN)) {
+        fprintf(stderr, "Failed to find music \"%s\".\n", name);
+        return false;
+    }
+
+    ALLEGRO_AUDIO_STREAM *stream = al_load_audio_stream(fullpath, DRC_DEFAULT_MUSIC_BUFFER_COUNT, drc_music_buffer_samples);
+
+    if (stream == NULL) {
+        fprintf(stderr, "Failed to load music \"%s\".\n", fullpath);
+        return false;
+    }
+
+    al_set_audio_stream_playmode(stream, ALLEGRO_PLAYMODE_LOOP);
+    al_set_audio_stream_gain(stream, 0);
+
+    if (!al_attach_audio_stream_to_mixer(stream, al_get_default_mixer())) {
+        fprintf(stderr, "Failed to play music \"%s\".\n", fullpath);
+        al_destroy_audio_stream(stream);
+        return false;
+    }
+
+    memset(song, 0, sizeof(DRC_SONG));
+    song->stream = stream;
+    strncpy(song->name, name, MAX_FILENAME_LEN - 1);
+
+    long sample_bytes = (long)al_get_channel_count(al_get_audio_stream_channels(stream)) *
+        (long)al_get_audio_depth_size(al_get_audio_stream_depth(stream));
+
+    song->buffer_bytes = (long)DRC_DEFAULT_MUSIC_BUFFER_COUNT * drc_music_buffer_samples * sample_bytes;
+    song->decoded_bytes = (long)(al_get_audio_stream_length_secs(stream) * al_get_audio_stream_frequency(stream)) * sample_bytes;
+
+    drc_num_songs_played++;
+    drc_count_music_memory();
+
+    return true;
+}
+
+void drc_play_music(const char *name, double fade_secs)
+{
+    if (!drc_is_music_init) {
+        return;
+    }
+
+    if (name != NULL && drc_song.stream != NULL && strcmp(drc_song.name, name) == 0) {
+        return;
+    }
+
+    double now = al_get_time();
+
+    /* Only two songs at a time, the one that was already fading out is done */
+    drc_stop_song(&drc_old_song);
+
+    if (drc_song.stream != NULL) {
+        drc_old_song = drc_song;
+        drc_fade_song(&drc_old_song, 0, fade_secs, now);
+        memset(&drc_song, 0, sizeof(DRC_SONG));
+    }
+
+    if (name != NULL && drc_start_song(&drc_song, name)) {
+        drc_fade_song(&drc_song, 1, fade_secs, now);
+    }
+
+    drc_update_music();
+}
+
+void drc_update_music(void)
+{
+    if (drc_song.stream == NULL && drc_old_song.stream == NULL) {
+        return;
+    }
+
+    double now = al_get_time();
+    float volume = drc_is_audio_toggled_on() ? 1 : 0;
+
+    if (drc_old_song.stream != NULL) {
+        if (now - drc_old_song.fade_start >= drc_old_song.fade_secs) {
+            drc_stop_song(&drc_old_song);
+        } else {
+            al_set_audio_stream_gain(drc_old_song.stream, drc_get_song_gain(&drc_old_song, now) * volume);
+        }
+    }
+
+    if (drc_song.stream != NULL) {
+        al_set_audio_stream_gain(drc_song.stream, drc_get_song_gain(&drc_song, now) * volume);
+    }
+}
+
+void drc_print_music_stats(void)
+{
+    printf("Music: played %d songs, streaming used at most %ld KB at once, decoding them would have used %ld KB.\n",
+        drc_num_songs_played, drc_most_music_buffer_bytes / 1024, drc_most_music_decoded_bytes / 1024);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_audio.h>
+
+/**
+ * Background music.
+ *
+ * A song is several minutes long, and decoded all at once (like
+ * a sound from "drc_get_sound") it would take tens of MB. Instead
+ * it's streamed from the file: only a few small buffers are kept
+ * in memory, and they're filled again as they're played.
+ *
+ * Changing the song fades the old one out while the new one fades
+ * in, so for a moment two songs are streamed at once.
+ */
+
+/**
+ * How many buffers each song has, and how many samples
+ * are in each one. Smaller buffers use less memory, but
+ * they have to be filled more often or the music skips.
+ */
+#define DRC_DEFAULT_MUSIC_BUFFER_COUNT (4)
+#define DRC_DEFAULT_MUSIC_BUFFER_SAMPLES (2048)
+
+/**
+ * Set up the music, using the default mixer. Use 0 for
+ * "buffer_samples" to use DRC_DEFAULT_MUSIC_BUFFER_SAMPLES.
+ */
+bool drc_init_music(int buffer_samples);
+
+void drc_free_music(void);
+
+/**
+ * Start playing a song, looping forever, found in the resource
+ * paths (see "drc_resources.h"). Whatever was playing before
+ * fades out over "fade_secs" seconds while the song fades in.
+ * If the song is already playing, it just keeps playing.
+ * Use NULL to fade out the music.
+ */
+void drc_play_music(const char *name, double fade_secs);
+
+/* Fade the music, and toggle it with the audio (see "drc_toggle_audio") */
+void drc_update_music(void);
+
+/**
+ * Print how much memory the music used, compared to how much
+ * it would have taken to decode each song all at once.
+ */
+void drc_print_music_stats(void);
@@ -0,0 +1,248 @@
+#include <allegro5/allegro.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
+#include "drc_path_cache.h"
+#include "drc_watch.h"
+
+/**
+ * A hash table, with each name in the first free spot
+ * after where its hash says it goes. It doubles in
+ * size whenever it gets more than half full.
+ */
+#define DRC_PATH_CACHE_START_SIZE (256)
+
+typedef struct
+{
+    int group;
+
+    /* NULL if the spot is empty */
+    char *name;
+
+    /* NULL if the file wasn't found */
+    char *fullpath;
+
+    /* How many search paths didn't have the file */
+    int num_failed;
+} DRC_PATH_CACHE_ENTRY;
+
+static DRC_PATH_CACHE_ENTRY *drc_path_cache = NULL;
+static int drc_path_cache_size = 0;
+static int drc_num_path_cache_entries = 0;
+
+static ALLEGRO_MUTEX *drc_path_cache_mutex = NULL;
+
+/* Stats */
+static int drc_num_path_searches = 0;
+static int drc_num_path_cache_hits = 0;
+static int drc_num_failed_opens_avoided = 0;
+
+static uint32_t drc_hash_path(int group, const char *name)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u ^ (uint32_t)group;
+
+    for (const char *c = name; *c != '\0'; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static DRC_PATH_CACHE_ENTRY *drc_find_path_cache_spot(DRC_PATH_CACHE_ENTRY *table, int size, int group, const char *name)
+{
+    int i = drc_hash_path(group, name) & (size - 1);
+
+    while (table[i].name != NULL && (table[i].group != group || strcmp(table[i].name, name) != 0)) {
+        i = (i + 1) & (size - 1);
+    }
+
+    return &table[i];
+}
+
+static void drc_grow_path_cache(void)
+{
+    int size = drc_path_cache_size > 0 ? drc_path_cache_size * 2 : DRC_PATH_CACHE_START_SIZE;
+
+    DRC_PATH_CACHE_ENTRY *table = drc_calloc_memory("DRC_PATH_CACHE", size, sizeof(DRC_PATH_CACHE_ENTRY));
+    assert(table != NULL);
+
+    /* Move everything to its spot in the bigger table */
+    for (int i = 0; i < drc_path_cache_size; i++) {
+        if (drc_path_cache[i].name != NULL) {
+            *drc_find_path_cache_spot(table, size, drc_path_cache[i].group, drc_path_cache[i].name) = drc_path_cache[i];
+        }
+    }
+
+    if (drc_path_cache != NULL) {
+        drc_free_memory("DRC_PATH_CACHE", drc_path_cache);
+    }
+
+    drc_path_cache = table;
+    drc_path_cache_size = size;
+}
+
+static void drc_lock_path_cache(void)
+{
+    if (drc_path_cache_mutex != NULL) {
+        al_lock_mutex(drc_path_cache_mutex);
+    }
+}
+
+static void drc_unlock_path_cache(void)
+{
+    if (drc_path_cache_mutex != NULL) {
+        al_unlock_mutex(drc_path_cache_mutex);
+    }
+}
+
+static bool drc_copy_cached_path(DRC_PATH_CACHE_ENTRY *entry, char *fullpath, int size)
+{
+    if (entry->fullpath == NULL) {
+        fullpath[0] = '\0';
+        return false;
+    }
+
+    fullpath[0] = '\0';
+    strncat(fullpath, entry->fullpath, size - 1);
+
+    return true;
+}
+
+bool drc_find_file_in_paths(int group, DRC_GET_SEARCH_PATH get_path, const char *name, char *fullpath, int size)
+{
+    drc_lock_path_cache();
+
+    drc_num_path_searches++;
+
+    if (drc_path_cache_size > 0) {
+
+        DRC_PATH_CACHE_ENTRY *entry = drc_find_path_cache_spot(drc_path_cache, drc_path_cache_size, group, name);
+
+        if (entry->name != NULL) {
+            drc_num_path_cache_hits++;
+            drc_num_failed_opens_avoided += entry->num_failed;
+            bool found = drc_copy_cached_path(entry, fullpath, size);
+            drc_unlock_path_cache();
+            return found;
+        }
+    }
+
+    /* Not searched for yet, try each search path */
+    const char *path = NULL;
+    int num_failed = 0;
+    bool found = false;
+
+    for (int i = 0; (path = get_path(i)) != NULL; i++) {
+
+        fullpath[0] = '\0';
+        strncat(fullpath, path, size - 1);
+        strncat(fullpath, name, size - 1 - strlen(fullpath));
+
+        if (al_filename_exists(fullpath)) {
+            found = true;
+            break;
+        }
+
+        num_failed++;
+    }
+
+    if (!found) {
+        fullpath[0] = '\0';
+
+        /* While files are watched, a missing file could be made any time, so look for it again next time */
+        if (drc_is_watching()) {
+            drc_unlock_path_cache();
+            return false;
+        }
+    }
+
+    /* Remember it */
+    if ((drc_num_path_cache_entries + 1) * 2 > drc_path_cache_size) {
+        drc_grow_path_cache();
+    }
+
+    DRC_PATH_CACHE_ENTRY *entry = drc_find_path_cache_spot(drc_path_cache, drc_path_cache_size, group, name);
+
+    /* Paths are only forgotten when the search paths change, so they can stay in the global arena */
+    entry->group = group;
+    entry->name = drc_arena_copy_string(drc_get_global_arena(), "DRC_PATH_CACHE->name", name);
+    entry->fullpath = found ? drc_arena_copy_string(drc_get_global_arena(), "DRC_PATH_CACHE->fullpath", fullpath) : NULL;
+    entry->num_failed = num_failed;
+
+    drc_num_path_cache_entries++;
+
+    drc_unlock_path_cache();
+
+    return found;
+}
+
+void drc_forget_path_cache(int group)
+{
+    drc_lock_path_cache();
+
+    int size = drc_path_cache_size;
+    DRC_PATH_CACHE_ENTRY *old_table = drc_path_cache;
+
+    drc_path_cache = NULL;
+    drc_path_cache_size = 0;
+    drc_num_path_cache_entries = 0;
+
+    /* Put back everything from the other groups */
+    for (int i = 0; i < size; i++) {
+
+        DRC_PATH_CACHE_ENTRY *entry = &old_table[i];
+
+        if (entry->name == NULL) {
+            continue;
+        }
+
+        if (entry->group == group) {
+            continue;
+        }
+
+        if ((drc_num_path_cache_entries + 1) * 2 > drc_path_cache_size) {
+            drc_grow_path_cache();
+        }
+
+        *drc_find_path_cache_spot(drc_path_cache, drc_path_cache_size, entry->group, entry->name) = *entry;
+        drc_num_path_cache_entries++;
+    }
+
+    if (old_table != NULL) {
+        drc_free_memory("DRC_PATH_CACHE", old_table);
+    }
+
+    drc_unlock_path_cache();
+}
+
+void drc_free_path_cache(void)
+{
+    if (drc_path_cache != NULL) {
+        drc_path_cache = drc_free_memory("DRC_PATH_CACHE", drc_path_cache);
+    }
+
+    drc_path_cache_size = 0;
+    drc_num_path_cache_entries = 0;
+
+    if (drc_path_cache_mutex != NULL) {
+        al_destroy_mutex(drc_path_cache_mutex);
+        drc_path_cache_mutex = NULL;
+    }
+}
+
+void drc_share_path_cache_between_threads(void)
+{
+    if (drc_path_cache_mutex == NULL) {
+        drc_path_cache_mutex = al_create_mutex();
+        assert(drc_path_cache_mutex != NULL);
+    }
+}
+
+void drc_print_path_cache_stats(void)
+{
+    printf("Files: searched for %d times, %d remembered, %d failed opens avoided.\n",
+        drc_num_path_searches, drc_num_path_cache_hits, drc_num_failed_opens_avoided);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * Remembers where files were found.
+ *
+ * Resources and data files are found by trying each directory
+ * in a list ("search paths") until one has the file. Instead of
+ * doing that every time a file is opened, the place a file was
+ * found (or that it wasn't found at all) is remembered, so after
+ * the first time, opening a file is just opening the file.
+ *
+ * While files are being watched for changes (see "drc_watch.h"),
+ * a file that wasn't found isn't remembered, in case it's made
+ * while the game is running.
+ *
+ * Each list of search paths has its own "group" number, so the
+ * same name can be found in different places for different lists.
+ */
+
+/* The group that "drc_resources" uses, pick a different one for your own list */
+#define DRC_RESOURCE_PATH_GROUP (0)
+
+/**
+ * Gives the search path number "n" (starting at 0)
+ * or NULL if there aren't that many.
+ */
+typedef const char *(*DRC_GET_SEARCH_PATH)(int n);
+
+/**
+ * Find a file in the first search path that has it.
+ * Returns true and puts the path to the file in "fullpath"
+ * if it was found.
+ */
+bool drc_find_file_in_paths(int group, DRC_GET_SEARCH_PATH get_path, const char *name, char *fullpath, int size);
+
+/**
+ * Forget where files in a group were found,
+ * such as when the search paths change.
+ */
+void drc_forget_path_cache(int group);
+
+void drc_free_path_cache(void);
+
+/**
+ * Call this before finding files on more than one thread at a time.
+ * The path cache stays shared until it's freed.
+ */
+void drc_share_path_cache_between_threads(void);
+
+/**
+ * Print how many files were found, and how many times
+ * trying to open a file that isn't there was avoided.
+ */
+void drc_print_path_cache_stats(void);
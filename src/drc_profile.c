@@ -0,0 +1,196 @@
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include "drc_profile.h"
+#include "drc_text.h"
+
+static const char *drc_profile_phase_names[DRC_PROFILE_NUM_PHASES] = {
+    "FRAME",
+    "CTRL",
+    "UPDATE",
+    "DRAW",
+    "FLIP",
+    "LOAD",
+    "ROOM"
+};
+
+/* When each phase was started, and how deep inside of itself it is */
+static double drc_profile_start_time[DRC_PROFILE_NUM_PHASES];
+static int drc_profile_depth[DRC_PROFILE_NUM_PHASES];
+
+/* The time spent in each phase so far during the current frame */
+static double drc_profile_current[DRC_PROFILE_NUM_PHASES];
+static bool drc_profile_used[DRC_PROFILE_NUM_PHASES];
+static double drc_profile_frame_start = -1;
+
+/* In the ring buffer, for a phase that didn't happen during a frame */
+#define DRC_PROFILE_UNUSED (-1.0f)
+
+/* Ring buffer of the most recent frames, in milliseconds */
+static float drc_profile_frames[DRC_PROFILE_FRAMES][DRC_PROFILE_NUM_PHASES];
+static int drc_profile_next = 0;
+static int drc_profile_len = 0;
+
+/* Every frame ever timed, in milliseconds, for the histogram */
+static unsigned long drc_profile_histogram[DRC_PROFILE_NUM_PHASES][DRC_PROFILE_NUM_BUCKETS];
+
+static bool drc_profile_show_overlay = false;
+
+void drc_profile_start(DRC_PROFILE_PHASE phase)
+{
+    assert(phase >= 0 && phase < DRC_PROFILE_NUM_PHASES);
+
+    if (drc_profile_depth[phase] == 0) {
+        drc_profile_start_time[phase] = al_get_time();
+    }
+
+    drc_profile_depth[phase]++;
+}
+
+void drc_profile_stop(DRC_PROFILE_PHASE phase)
+{
+    assert(phase >= 0 && phase < DRC_PROFILE_NUM_PHASES);
+    assert(drc_profile_depth[phase] > 0);
+
+    drc_profile_depth[phase]--;
+
+    if (drc_profile_depth[phase] == 0) {
+        drc_profile_current[phase] += al_get_time() - drc_profile_start_time[phase];
+        drc_profile_used[phase] = true;
+    }
+}
+
+void drc_profile_add(DRC_PROFILE_PHASE phase, double seconds)
+{
+    assert(phase >= 0 && phase < DRC_PROFILE_NUM_PHASES);
+
+    drc_profile_current[phase] += seconds;
+    drc_profile_used[phase] = true;
+}
+
+static void drc_add_to_histogram(DRC_PROFILE_PHASE phase, float ms)
+{
+    int bucket = (int)(ms / DRC_PROFILE_BUCKET_MS);
+
+    if (bucket >= DRC_PROFILE_NUM_BUCKETS) {
+        bucket = DRC_PROFILE_NUM_BUCKETS - 1;
+    }
+
+    drc_profile_histogram[phase][bucket]++;
+}
+
+void drc_profile_next_frame(void)
+{
+    double now = al_get_time();
+
+    /* The very first frame has nothing to compare to */
+    if (drc_profile_frame_start >= 0) {
+        drc_profile_current[DRC_PROFILE_FRAME] = now - drc_profile_frame_start;
+        drc_profile_used[DRC_PROFILE_FRAME] = true;
+    }
+    drc_profile_frame_start = now;
+
+    /* Save this frame in the ring buffer, overwriting the oldest one */
+    for (int i = 0; i < DRC_PROFILE_NUM_PHASES; i++) {
+
+        float ms = (float)(drc_profile_current[i] * 1000.0);
+
+        /* Only count phases that actually happened */
+        if (drc_profile_used[i]) {
+            drc_profile_frames[drc_profile_next][i] = ms;
+            drc_add_to_histogram(i, ms);
+        } else {
+            drc_profile_frames[drc_profile_next][i] = DRC_PROFILE_UNUSED;
+        }
+
+        drc_profile_current[i] = 0;
+        drc_profile_used[i] = false;
+    }
+
+    drc_profile_next = (drc_profile_next + 1) % DRC_PROFILE_FRAMES;
+    if (drc_profile_len < DRC_PROFILE_FRAMES) {
+        drc_profile_len++;
+    }
+}
+
+void drc_toggle_profile_overlay(void)
+{
+    drc_profile_show_overlay = drc_profile_show_overlay ? false : true;
+}
+
+static int drc_compare_floats(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+void drc_draw_profile_overlay(void)
+{
+    if (!drc_profile_show_overlay || drc_profile_len == 0) {
+        return;
+    }
+
+    float sorted[DRC_PROFILE_FRAMES];
+    char line[64];
+
+    drc_draw_dynamic_text(4, 4, "        p50   p99   max");
+
+    for (int i = 0; i < DRC_PROFILE_NUM_PHASES; i++) {
+
+        /* Only the frames where the phase happened, or an idle phase would always be 0 */
+        int len = 0;
+
+        for (int j = 0; j < drc_profile_len; j++) {
+            if (drc_profile_frames[j][i] != DRC_PROFILE_UNUSED) {
+                sorted[len] = drc_profile_frames[j][i];
+                len++;
+            }
+        }
+
+        if (len == 0) {
+            snprintf(line, sizeof(line), "%-6s     -     -     -", drc_profile_phase_names[i]);
+            drc_draw_dynamic_text(4, 14 + (i * 10), line);
+            continue;
+        }
+
+        qsort(sorted, len, sizeof(float), drc_compare_floats);
+
+        float p50 = sorted[(len * 50) / 100];
+        float p99 = sorted[(len * 99) / 100];
+        float max = sorted[len - 1];
+
+        snprintf(line, sizeof(line), "%-6s %5.2f %5.2f %5.2f", drc_profile_phase_names[i], p50, p99, max);
+        drc_draw_dynamic_text(4, 14 + (i * 10), line);
+    }
+}
+
+bool drc_write_profile_histogram(const char *filename)
+{
+    FILE *file = fopen(filename, "w");
+
+    if (file == NULL) {
+        fprintf(stderr, "PROFILE: Failed to open \"%s\".\n", filename);
+        return false;
+    }
+
+    fprintf(file, "# Number of frames that took this long, in milliseconds\n");
+    fprintf(file, "# The last bucket holds everything slower\n");
+    fprintf(file, "ms");
+    for (int i = 0; i < DRC_PROFILE_NUM_PHASES; i++) {
+        fprintf(file, " %s", drc_profile_phase_names[i]);
+    }
+    fprintf(file, "\n");
+
+    for (int b = 0; b < DRC_PROFILE_NUM_BUCKETS; b++) {
+        fprintf(file, "%.2f", b * DRC_PROFILE_BUCKET_MS);
+        for (int i = 0; i < DRC_PROFILE_NUM_PHASES; i++) {
+            fprintf(file, " %lu", drc_profile_histogram[i][b]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+
+    return true;
+}
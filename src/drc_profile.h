@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * The number of most recent frames that are kept
+ * to calculate the numbers shown on the overlay.
+ */
+#define DRC_PROFILE_FRAMES (256)
+
+/**
+ * The histogram groups times into buckets this many
+ * milliseconds wide, up to this many buckets. Anything
+ * longer goes in the last bucket.
+ */
+#define DRC_PROFILE_BUCKET_MS (0.25)
+#define DRC_PROFILE_NUM_BUCKETS (200)
+
+/**
+ * The parts of a frame that are timed.
+ *
+ * FRAME is the time from the start of one frame to the
+ * start of the next. LOAD (loading resources from disk)
+ * and ROOM (changing rooms) happen inside the others.
+ */
+typedef enum
+{
+    DRC_PROFILE_FRAME = 0,
+    DRC_PROFILE_CONTROL,
+    DRC_PROFILE_UPDATE,
+    DRC_PROFILE_DRAW,
+    DRC_PROFILE_FLIP,
+    DRC_PROFILE_LOAD,
+    DRC_PROFILE_ROOM,
+    DRC_PROFILE_NUM_PHASES
+} DRC_PROFILE_PHASE;
+
+/**
+ * Time a part of the frame.
+ *
+ * The time between "start" and "stop" is added to the
+ * current frame. Starting a phase that is already started
+ * is OK, only the outermost pair is timed.
+ */
+void drc_profile_start(DRC_PROFILE_PHASE phase);
+void drc_profile_stop(DRC_PROFILE_PHASE phase);
+
+/**
+ * Add time (in seconds) to a phase of the current frame,
+ * for when it was measured some other way.
+ */
+void drc_profile_add(DRC_PROFILE_PHASE phase, double seconds);
+
+/**
+ * Finish timing the current frame and start the next one.
+ * Use this once per frame.
+ */
+void drc_profile_next_frame(void);
+
+/**
+ * Show or hide the timing overlay.
+ */
+void drc_toggle_profile_overlay(void);
+
+/**
+ * Draw the median, 99th percentile and slowest time of
+ * each phase over the recent frames, in milliseconds.
+ * Only frames where the phase happened are counted.
+ * Does nothing if the overlay is hidden.
+ */
+void drc_draw_profile_overlay(void);
+
+/**
+ * Save a histogram of every frame that was timed to a text file.
+ * Returns true on success.
+ */
+bool drc_write_profile_histogram(const char *filename);
@@ -1,14 +1,114 @@
-#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
 #include <time.h>
+#include "drc_random.h"
 
-static int drc_init_random_numbers = 0;
+#define DRC_PCG32_MULTIPLIER (6364136223846793005ULL)
 
-int drc_random_number(int low, int high)
+static DRC_RANDOM drc_random_streams[DRC_NUM_RANDOM_STREAMS];
+static uint64_t drc_random_seed = 0;
+static bool drc_is_random_seeded = false;
+
+void drc_seed_random_generator(DRC_RANDOM *random, uint64_t seed, uint64_t sequence)
+{
+    /* The same as "pcg32_srandom_r", so the numbers match the reference */
+    random->state = 0;
+    random->inc = (sequence << 1) | 1;
+    drc_next_random(random);
+    random->state += seed;
+    drc_next_random(random);
+}
+
+uint32_t drc_next_random(DRC_RANDOM *random)
+{
+    uint64_t old_state = random->state;
+    random->state = (old_state * DRC_PCG32_MULTIPLIER) + random->inc;
+
+    /* Mix up the old state, and rotate it by its top bits */
+    uint32_t xorshifted = (uint32_t)(((old_state >> 18) ^ old_state) >> 27);
+    uint32_t rot = (uint32_t)(old_state >> 59);
+
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+int drc_next_random_number(DRC_RANDOM *random, int low, int high)
+{
+    assert(low <= high);
+
+    uint32_t range = (uint32_t)high - (uint32_t)low + 1;
+
+    /* Every number is in range */
+    if (range == 0) {
+        return (int)drc_next_random(random);
+    }
+
+    /**
+     * Scale the number up to the range, instead of using "%", and
+     * throw away the few numbers that would make some come up more
+     * often than others (see "Fast Random Integer Generation in an
+     * Interval", Lemire). It almost never needs a second try.
+     */
+    uint64_t m = (uint64_t)drc_next_random(random) * range;
+
+    if ((uint32_t)m < range) {
+        uint32_t threshold = -range % range;
+        while ((uint32_t)m < threshold) {
+            m = (uint64_t)drc_next_random(random) * range;
+        }
+    }
+
+    return (int)((uint32_t)low + (uint32_t)(m >> 32));
+}
+
+void drc_fill_random(DRC_RANDOM *random, uint32_t *values, int len)
+{
+    /* A copy, so the state can stay in a register */
+    DRC_RANDOM r = *random;
+
+    for (int i = 0; i < len; i++) {
+        values[i] = drc_next_random(&r);
+    }
+
+    *random = r;
+}
+
+void drc_seed_random(uint64_t seed)
+{
+    for (int i = 0; i < DRC_NUM_RANDOM_STREAMS; i++) {
+        drc_seed_random_generator(&drc_random_streams[i], seed, (uint64_t)i);
+    }
+
+    drc_random_seed = seed;
+    drc_is_random_seeded = true;
+}
+
+uint64_t drc_get_random_seed(void)
+{
+    return drc_random_seed;
+}
+
+static DRC_RANDOM *drc_get_random_stream(DRC_RANDOM_STREAM stream)
 {
-    if (!drc_init_random_numbers) {
-        srand((unsigned)time(NULL));
-        drc_init_random_numbers = 1;
+    assert(stream >= 0 && stream < DRC_NUM_RANDOM_STREAMS);
+
+    if (!drc_is_random_seeded) {
+        drc_seed_random((uint64_t)time(NULL));
     }
-    
-    return (rand() % (high - low + 1)) + low;
+
+    return &drc_random_streams[stream];
+}
+
+int drc_random_number_from(DRC_RANDOM_STREAM stream, int low, int high)
+{
+    return drc_next_random_number(drc_get_random_stream(stream), low, high);
+}
+
+void drc_fill_random_from(DRC_RANDOM_STREAM stream, uint32_t *values, int len)
+{
+    drc_fill_random(drc_get_random_stream(stream), values, len);
+}
+
+int drc_random_number(int low, int high)
+{
+    return drc_random_number_from(DRC_RANDOM_STREAM_GAMEPLAY, low, high);
 }
@@ -1,8 +1,77 @@
 #pragma once
 
+#include <stdint.h>
+
+/**
+ * Random numbers, using PCG32 (see "pcg-random.org").
+ * It's small (16 bytes), fast and the numbers are good enough
+ * for a game, and they're the same everywhere for the same seed.
+ *
+ * There's a separate stream of numbers for each part of the game,
+ * so using more random numbers in one place (such as a new powerup)
+ * doesn't change the numbers somewhere else (such as the level).
+ * Add a stream here when something new needs random numbers.
+ */
+
+typedef enum
+{
+    DRC_RANDOM_STREAM_GAMEPLAY = 0,
+    DRC_RANDOM_STREAM_LEVEL,
+    DRC_NUM_RANDOM_STREAMS
+} DRC_RANDOM_STREAM;
+
+/**
+ * One random number generator, for anything that needs
+ * its own (such as a thread). Seed it before using it.
+ */
+typedef struct
+{
+    uint64_t state;
+
+    /* Which sequence of numbers, always odd */
+    uint64_t inc;
+} DRC_RANDOM;
+
+/**
+ * Start a generator. Generators with the same seed but a different
+ * sequence give completely different numbers.
+ */
+void drc_seed_random_generator(DRC_RANDOM *random, uint64_t seed, uint64_t sequence);
+
+/* The next number from a generator, from 0 to UINT32_MAX */
+uint32_t drc_next_random(DRC_RANDOM *random);
+
+/**
+ * A number between low and high, inclusively, from a generator.
+ * Every number is equally likely.
+ */
+int drc_next_random_number(DRC_RANDOM *random, int low, int high);
+
+/* Fill "values" with the next "len" numbers from a generator */
+void drc_fill_random(DRC_RANDOM *random, uint32_t *values, int len);
+
+/**
+ * Seed every stream, so the game can be played the same way again.
+ * If this isn't called, the streams are seeded from the time.
+ */
+void drc_seed_random(uint64_t seed);
+
+/* The seed the streams were last seeded with */
+uint64_t drc_get_random_seed(void);
+
+/**
+ * Generate a random number between low and high, inclusively,
+ * from a stream.
+ */
+int drc_random_number_from(DRC_RANDOM_STREAM stream, int low, int high);
+
+/* Fill "values" with the next "len" numbers from a stream */
+void drc_fill_random_from(DRC_RANDOM_STREAM stream, uint32_t *values, int len);
+
 /**
  * Generate a random number between low and high, inclusively.
  * The lower bound is "low".
  * The upper bound is "high".
+ * It's from the gameplay stream.
  */
 int drc_random_number(int low, int high);
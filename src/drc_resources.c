@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <string.h>
 #include "drc_memory.h"
+#include "drc_path_cache.h"
+#include "drc_profile.h"
 #include "drc_resources.h"
+#include "drc_trace.h"
+#include "drc_watch.h"
 
 typedef enum
 {
@@ -27,6 +31,10 @@ typedef struct DRC_RESOURCE
     /* Pointer to the data */
     void *data;
 
+    /* How to draw it again, if it's an image made from other images */
+    DRC_REDRAW_IMAGE redraw;
+    char *made_from[2];
+
 } DRC_RESOURCE;
 
 /* The collection of resources, stored as a binary tree */
@@ -39,6 +47,12 @@ static DRC_RESOURCE *drc_resource_tree = NULL;
  */
 static DRC_RESOURCE *drc_temp_resource_tree = NULL;
 
+/**
+ * Resources, their names and the resource paths are all kept in
+ * the global arena (see "drc_memory.h"), so they don't need to be
+ * freed one at a time. They aren't freed until the game is done.
+ */
+
 typedef struct DRC_RESOURCE_PATH
 {
     /* The path (AKA directory, AKA folder) name that contains resources */
@@ -76,25 +90,12 @@ static void drc_print_resource_tree(DRC_RESOURCE *resource, int level)
 }
 */
 
-static DRC_RESOURCE_PATH *drc_free_resource_path_list(DRC_RESOURCE_PATH *list)
-{
-    if (list == NULL) {
-        return NULL;
-    }
-
-    /* Delete the next path in the list */
-    list->next = drc_free_resource_path_list(list->next);
-
-    /* Finish deleting this path */
-    list->path = drc_free_memory("DRC_RESOURCE_PATH_LIST->path", list->path);
-    list = drc_free_memory("DRC_RESOURCE_PATH_LIST", list);
-
-    return NULL;
-}
-
 void drc_free_resource_paths(void)
 {
-    drc_resource_path_list = drc_free_resource_path_list(drc_resource_path_list);
+    /* The paths are in the global arena, they're freed along with it */
+    drc_resource_path_list = NULL;
+
+    drc_forget_path_cache(DRC_RESOURCE_PATH_GROUP);
 }
 
 /**
@@ -106,13 +107,10 @@ static DRC_RESOURCE *drc_create_resource(const char *name, DRC_RESOURCE_TYPE typ
     assert(data != NULL);
     assert(type == DRC_RESOURCE_TYPE_IMAGE || type == DRC_RESOURCE_TYPE_SOUND);
 
-    DRC_RESOURCE *resource = drc_alloc_memory("DRC_RESOURCE", sizeof(DRC_RESOURCE));
+    DRC_RESOURCE *resource = drc_arena_alloc_memory(drc_get_global_arena(), "DRC_RESOURCE", sizeof(DRC_RESOURCE));
     assert(resource != NULL);
 
-    int new_strlen = strlen(name) + 1; // Length of the string, plus one more for the terminating '\0'
-    resource->name = drc_alloc_memory("DRC_RESOURCE->name", new_strlen * sizeof(char));
-    assert(resource->name != NULL);
-    strcpy(resource->name, name);
+    resource->name = drc_arena_copy_string(drc_get_global_arena(), "DRC_RESOURCE->name", name);
 
     resource->type = type;
     resource->data = data;
@@ -121,9 +119,20 @@ static DRC_RESOURCE *drc_create_resource(const char *name, DRC_RESOURCE_TYPE typ
     resource->left = NULL;
     resource->right = NULL;
 
+    resource->redraw = NULL;
+    resource->made_from[0] = NULL;
+    resource->made_from[1] = NULL;
+
     return resource;
 }
 
+static void drc_set_resource_made_from(DRC_RESOURCE *resource, DRC_REDRAW_IMAGE redraw, const char *a, const char *b)
+{
+    resource->redraw = redraw;
+    resource->made_from[0] = drc_arena_copy_string(drc_get_global_arena(), "DRC_RESOURCE->made_from", a);
+    resource->made_from[1] = drc_arena_copy_string(drc_get_global_arena(), "DRC_RESOURCE->made_from", b);
+}
+
 static DRC_RESOURCE *drc_add_resource_to_tree(DRC_RESOURCE *tree, DRC_RESOURCE *resource)
 {
     assert(resource != NULL);
@@ -168,15 +177,10 @@ static DRC_RESOURCE *drc_free_resource_tree(DRC_RESOURCE *resource)
 
     if (resource->locked) {
 
-        /* Make a copy of a locked resource and save it in another collection */
-        DRC_RESOURCE *resource_copy = drc_create_resource(resource->name, resource->type, resource->data);
-        resource_copy->locked = true;
+        /* Save a locked resource in another collection, just as it is */
+        drc_temp_resource_tree = drc_add_resource_to_tree(drc_temp_resource_tree, resource);
 
-        drc_temp_resource_tree = drc_add_resource_to_tree(drc_temp_resource_tree, resource_copy);
-
-        /* Now that we have a copy, we can get rid of the original */
-        resource->data = NULL;
-        resource->locked = false;
+        return NULL;
     }
 
     /* Free the resource data */
@@ -185,10 +189,9 @@ static DRC_RESOURCE *drc_free_resource_tree(DRC_RESOURCE *resource)
     } else if (resource->type == DRC_RESOURCE_TYPE_SOUND) {
         al_destroy_sample((ALLEGRO_SAMPLE *)resource->data);
     }
-    resource->name = drc_free_memory("DRC_RESOURCE->name", resource->name);
-    resource = drc_free_memory("DRC_RESOURCE", resource);
 
-    return resource;
+    /* The resource itself is in the global arena */
+    return NULL;
 }
 
 void drc_free_resources(void)
@@ -267,13 +270,10 @@ static DRC_RESOURCE_PATH *drc_add_resource_path_to_list(DRC_RESOURCE_PATH *list,
     if (list == NULL) {
 
         /* We're at the end of the list! Add the path here */
-        list = drc_alloc_memory("DRC_RESOURCE_PATH", sizeof(DRC_RESOURCE_PATH));
+        list = drc_arena_alloc_memory(drc_get_global_arena(), "DRC_RESOURCE_PATH", sizeof(DRC_RESOURCE_PATH));
         assert(list != NULL);
 
-        int new_strlen = strlen(path) + 1; // Length of the string, plus one more for the terminating '\0'
-        list->path = drc_alloc_memory("DRC_RESOURCE_PATH->path", new_strlen * sizeof(char));
-        assert(list->path != NULL);
-        strcpy(list->path, path);
+        list->path = drc_arena_copy_string(drc_get_global_arena(), "DRC_RESOURCE_PATH->path", path);
 
         list->next = NULL;
 
@@ -294,6 +294,9 @@ static DRC_RESOURCE_PATH *drc_add_resource_path_to_list(DRC_RESOURCE_PATH *list,
 void drc_add_resource_path(const char *path)
 {
     drc_resource_path_list = drc_add_resource_path_to_list(drc_resource_path_list, path);
+
+    /* A resource might be found somewhere else now */
+    drc_forget_path_cache(DRC_RESOURCE_PATH_GROUP);
 }
 
 /**
@@ -301,8 +304,17 @@ void drc_add_resource_path(const char *path)
  */
 static ALLEGRO_BITMAP *drc_load_bitmap_with_magic_pink(const char *filename)
 {
-    /* Try loading an image from the filename you've been given */
-    ALLEGRO_BITMAP *bitmap = al_load_bitmap(filename);
+    ALLEGRO_BITMAP *bitmap = NULL;
+
+    /* A section of a tilemap has a ":" after the last "/", don't bother trying to load it as-is */
+    const char *basename = strrchr(filename, '/');
+    if (strchr(basename != NULL ? basename : filename, ':') == NULL) {
+
+        /* Try loading an image from the filename you've been given */
+        DRC_TRACE_BEGIN("decode_image", filename);
+        bitmap = al_load_bitmap(filename);
+        DRC_TRACE_END();
+    }
 
     if (bitmap == NULL) {
 
@@ -356,7 +368,9 @@ static ALLEGRO_BITMAP *drc_load_bitmap_with_magic_pink(const char *filename)
         //printf("\"%s\", %d, %d, %d, %d\n", actual_filename, w, h, r, c);
 
         /* Load the image from a section of the tilemap */
+        DRC_TRACE_BEGIN("decode_image", actual_filename);
         ALLEGRO_BITMAP *tilemap = al_load_bitmap(actual_filename);
+        DRC_TRACE_END();
         if (tilemap == NULL) {
             return NULL;
         }
@@ -395,42 +409,69 @@ static void *drc_get_resource(const char *name, DRC_RESOURCE_TYPE type)
     /**
      * Uh oh. The resource WASN'T found...
      *
-     * Next, try finding a file with the given filename in
-     * the list of resource paths.
+     * Next, find the file in the list of resource paths
+     * (it's remembered where it was after the first time).
      *
-     * If found, return it!
+     * If found, load it and return it!
      */
-    DRC_RESOURCE_PATH *list = drc_resource_path_list;
-    while (list != NULL) {
+    char fullpath[MAX_FILEPATH_LEN];
+
+    if (drc_find_resource_file(name, fullpath, MAX_FILEPATH_LEN)) {
+
+        /* In case it changes while the game is running */
+        if (type == DRC_RESOURCE_TYPE_IMAGE) {
+            drc_watch_file(fullpath);
+        }
 
-        char fullpath[MAX_FILEPATH_LEN];
-        fullpath[0] = '\0';
-        strncat(fullpath, list->path, MAX_FILEPATH_LEN - 1);
-        strncat(fullpath, name, MAX_FILEPATH_LEN - 1);
+        /* Put back the section of the tilemap, if there is one */
+        strncat(fullpath, name + strcspn(name, ":"), MAX_FILEPATH_LEN - 1 - strlen(fullpath));
 
         void *data = NULL;
 
         /* Load the resource, based on the filetype */
+        drc_profile_start(DRC_PROFILE_LOAD);
         if (type == DRC_RESOURCE_TYPE_IMAGE) {
             data = drc_load_bitmap_with_magic_pink(fullpath);
         } else if (type == DRC_RESOURCE_TYPE_SOUND) {
+            DRC_TRACE_BEGIN("decode_sound", fullpath);
             data = al_load_sample(fullpath);
+            DRC_TRACE_END();
         }
+        drc_profile_stop(DRC_PROFILE_LOAD);
 
         /* The resource has been created! Return it */
         if (data != NULL) {
             drc_add_resource(drc_create_resource(name, type, data));
             return data;
         }
-
-        /* ...the resource hasn't been found yet, try the next path */
-        list = list->next;
     }
 
     /*fprintf(stderr, "RESOURCES: Failed to load resource: \"%s\".\n", name);*/
     return NULL;
 }
 
+static const char *drc_get_resource_path(int n)
+{
+    DRC_RESOURCE_PATH *list = drc_resource_path_list;
+
+    for (int i = 0; i < n && list != NULL; i++) {
+        list = list->next;
+    }
+
+    return list != NULL ? list->path : NULL;
+}
+
+bool drc_find_resource_file(const char *name, char *fullpath, int size)
+{
+    /* A section of a tilemap ("tiles.png:20x20:0,1") is in the tilemap file */
+    char filename[MAX_FILEPATH_LEN];
+    int len = strcspn(name, ":");
+
+    snprintf(filename, MAX_FILEPATH_LEN, "%.*s", len, name);
+
+    return drc_find_file_in_paths(DRC_RESOURCE_PATH_GROUP, drc_get_resource_path, filename, fullpath, size);
+}
+
 ALLEGRO_BITMAP *drc_get_image(const char *name)
 {
     return (ALLEGRO_BITMAP *)drc_get_resource(name, DRC_RESOURCE_TYPE_IMAGE);
@@ -459,3 +500,114 @@ void drc_insert_image_resource(const char *name, ALLEGRO_BITMAP *image)
 
     drc_add_resource(drc_create_resource(name, DRC_RESOURCE_TYPE_IMAGE, image));
 }
+
+void drc_insert_derived_image_resource(const char *name, ALLEGRO_BITMAP *image, DRC_REDRAW_IMAGE redraw, const char *a, const char *b)
+{
+    assert(image);
+    assert(redraw);
+
+    /* Check if the image has already been added */
+    if (drc_find_resource(drc_resource_tree, name) != NULL) {
+        return;
+    }
+
+    DRC_RESOURCE *resource = drc_create_resource(name, DRC_RESOURCE_TYPE_IMAGE, image);
+    drc_set_resource_made_from(resource, redraw, a, b);
+
+    drc_add_resource(resource);
+}
+
+/* Is the resource (or a section of it) from this file? */
+static bool drc_is_resource_from_file(const char *name, const char *fullpath)
+{
+    char resource_fullpath[MAX_FILEPATH_LEN];
+
+    return drc_find_resource_file(name, resource_fullpath, MAX_FILEPATH_LEN) && strcmp(resource_fullpath, fullpath) == 0;
+}
+
+/**
+ * Draw the new image over the old one, so everything that
+ * uses the old image (such as sprites) gets the new one.
+ */
+static bool drc_copy_image_in_place(ALLEGRO_BITMAP *image, ALLEGRO_BITMAP *new_image)
+{
+    if (al_get_bitmap_width(image) != al_get_bitmap_width(new_image) ||
+            al_get_bitmap_height(image) != al_get_bitmap_height(new_image)) {
+        return false;
+    }
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_BLENDER);
+
+    /* Replace every pixel, including the transparent ones */
+    al_set_target_bitmap(image);
+    al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+    al_draw_bitmap(new_image, 0, 0, 0);
+
+    al_restore_state(&state);
+
+    return true;
+}
+
+static int drc_reload_image_tree(DRC_RESOURCE *tree, const char *fullpath)
+{
+    if (tree == NULL) {
+        return 0;
+    }
+
+    int num = drc_reload_image_tree(tree->left, fullpath) + drc_reload_image_tree(tree->right, fullpath);
+
+    if (tree->type != DRC_RESOURCE_TYPE_IMAGE || tree->redraw != NULL || !drc_is_resource_from_file(tree->name, fullpath)) {
+        return num;
+    }
+
+    /* Put back the section of the tilemap, if there is one */
+    char filename[MAX_FILEPATH_LEN];
+    snprintf(filename, MAX_FILEPATH_LEN, "%s%s", fullpath, tree->name + strcspn(tree->name, ":"));
+
+    ALLEGRO_BITMAP *image = drc_load_bitmap_with_magic_pink(filename);
+
+    if (image == NULL) {
+        fprintf(stderr, "RESOURCES: Failed to reload \"%s\".\n", tree->name);
+        return num;
+    }
+
+    if (drc_copy_image_in_place(tree->data, image)) {
+        num++;
+    } else {
+        fprintf(stderr, "RESOURCES: Failed to reload \"%s\", it changed size.\n", tree->name);
+    }
+
+    al_destroy_bitmap(image);
+
+    return num;
+}
+
+static int drc_redraw_image_tree(DRC_RESOURCE *tree, const char *fullpath)
+{
+    if (tree == NULL) {
+        return 0;
+    }
+
+    int num = drc_redraw_image_tree(tree->left, fullpath) + drc_redraw_image_tree(tree->right, fullpath);
+
+    if (tree->redraw != NULL && (drc_is_resource_from_file(tree->made_from[0], fullpath) ||
+            drc_is_resource_from_file(tree->made_from[1], fullpath))) {
+        tree->redraw(tree->data, tree->made_from[0], tree->made_from[1]);
+        num++;
+    }
+
+    return num;
+}
+
+int drc_reload_images_from_file(const char *fullpath)
+{
+    /* The images from the file first, then the images made from them */
+    int num = drc_reload_image_tree(drc_resource_tree, fullpath);
+
+    if (num > 0) {
+        num += drc_redraw_image_tree(drc_resource_tree, fullpath);
+    }
+
+    return num;
+}
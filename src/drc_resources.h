@@ -51,6 +51,15 @@ void drc_free_resource_paths(void);
 ALLEGRO_BITMAP *drc_get_image(const char *name);
 ALLEGRO_SAMPLE *drc_get_sound(const char *name);
 
+/**
+ * Search the resource paths for the filename without loading it.
+ * Returns true and puts the path to the file in "fullpath" if
+ * it was found. For a section of a tilemap, this finds the
+ * tilemap. This only looks at the resource paths, so it's
+ * safe to use from another thread.
+ */
+bool drc_find_resource_file(const char *name, char *fullpath, int size);
+
 /* For convenience */
 #define DRC_IMG(name) (drc_get_image(name))
 #define DRC_SND(name) (drc_get_sound(name))
@@ -64,3 +73,25 @@ ALLEGRO_BITMAP *drc_get_locked_image(const char *name);
  * It can be retrieved by calling "get_image" with the given name.
  */
 void drc_insert_image_resource(const char *name, ALLEGRO_BITMAP *image);
+
+/**
+ * Draws an image again from the two images it was made from,
+ * such as "get_masked_image" (see "mask.h").
+ */
+typedef void (*DRC_REDRAW_IMAGE)(ALLEGRO_BITMAP *image, const char *a, const char *b);
+
+/**
+ * Same as above, for an image that was made from two other images.
+ * If either of them is reloaded, the image is drawn again with "redraw".
+ */
+void drc_insert_derived_image_resource(const char *name, ALLEGRO_BITMAP *image, DRC_REDRAW_IMAGE redraw, const char *a, const char *b);
+
+/**
+ * Load every image from a file again, such as after it was changed
+ * (see "drc_watch.h"), and draw again the images made from them.
+ *
+ * The new pixels are drawn over the old images, so anything using
+ * them doesn't need to get them again. An image that changed size
+ * can't be reloaded. Returns the number of images that were reloaded.
+ */
+int drc_reload_images_from_file(const char *fullpath);
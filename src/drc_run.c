@@ -1,9 +1,34 @@
 #include <stdio.h>
 #include "drc_display.h"
+#include "drc_memory.h"
+#include "drc_music.h"
+#include "drc_profile.h"
 #include "drc_run.h"
+#include "drc_sound.h"
+#include "drc_trace.h"
 
 static int drc_run_fps = DRC_DEFAULT_FPS;
 
+static DRC_RUN_POLICY drc_run_policy = DRC_RUN_POLICY_FIXED;
+
+static int drc_run_max_catch_up = DRC_DEFAULT_MAX_CATCH_UP;
+
+/* How far between two updates the most recent frame was drawn */
+static float drc_run_interpolation = 0;
+
+/* How many updates have been run, in every call to "drc_run" */
+static int64_t drc_run_tick_count = 0;
+
+/**
+ * How long has been spent running, counting the time in a
+ * "drc_run" started inside of another one only once. The
+ * outer run takes it back out of its own phases.
+ */
+static double drc_run_secs = 0;
+
+/* If the monitor doesn't say how fast it is, guess */
+#define DRC_DEFAULT_REFRESH_RATE (60)
+
 void drc_set_fps(int fps)
 {
     assert(fps > 0);
@@ -15,6 +40,33 @@ int drc_get_fps(void)
     return drc_run_fps;
 }
 
+void drc_set_run_policy(DRC_RUN_POLICY policy)
+{
+    assert(policy == DRC_RUN_POLICY_FIXED || policy == DRC_RUN_POLICY_VSYNC || policy == DRC_RUN_POLICY_UNCAPPED);
+    drc_run_policy = policy;
+}
+
+DRC_RUN_POLICY drc_get_run_policy(void)
+{
+    return drc_run_policy;
+}
+
+void drc_set_max_catch_up(int max_updates)
+{
+    assert(max_updates > 0);
+    drc_run_max_catch_up = max_updates;
+}
+
+float drc_get_interpolation(void)
+{
+    return drc_run_interpolation;
+}
+
+int64_t drc_get_tick_count(void)
+{
+    return drc_run_tick_count;
+}
+
 void drc_run(void (*control)(void *data, ALLEGRO_EVENT *event),
         bool (*update)(void *data), void (*draw)(void *data), void *data)
 {
@@ -24,40 +76,170 @@ void drc_run(void (*control)(void *data, ALLEGRO_EVENT *event),
     al_register_event_source(events, al_get_timer_event_source(timer));
     al_register_event_source(events, al_get_keyboard_event_source());
     al_register_event_source(events, al_get_display_event_source(drc_get_display()));
-  
+
     ALLEGRO_EVENT event;
     bool keep_running = true;
-    bool redraw = true;
+
+    double run_start = al_get_time();
+    double run_secs_before = drc_run_secs;
+
+    /**
+     * Every update moves the game forward by exactly this much time.
+     * Real time is saved up in the "accumulator" and spent one
+     * update at a time, so the game logic runs the same no matter
+     * how fast or slow the screen is drawn.
+     */
+    double tick = 1.0 / drc_run_fps;
+    double accumulator = 0;
+    double prev_time = al_get_time();
+
+    /**
+     * With the FIXED policy, the timer says when to update instead.
+     * Counting its ticks keeps everything on the same clock, so
+     * there's always exactly one update for each tick.
+     */
+    int num_timer_ticks = 0;
+
+    /* To notice when VSYNC was asked for, but the screen isn't waiting for it */
+    int refresh_rate = al_get_display_refresh_rate(drc_get_display());
+    double refresh = 1.0 / (refresh_rate > 0 ? refresh_rate : DRC_DEFAULT_REFRESH_RATE);
+    double prev_flip = al_get_time();
 
     al_start_timer(timer);
-  
+
     while (keep_running) {
-  
-        al_wait_for_event(events, &event);
-
-        if (control != NULL) {
-            control(data, &event); /* CONTROL */
-        }
-    
-        if (event.type == ALLEGRO_EVENT_TIMER) {
-            if (update != NULL) {
-                keep_running = update(data); /* UPDATE */
-                redraw = true;
-            } else {
-                keep_running = false;
+
+        DRC_TRACE_BEGIN("frame", NULL);
+
+        /* The FIXED policy waits for the timer, the others are paced after drawing */
+        if (drc_run_policy == DRC_RUN_POLICY_FIXED) {
+            al_wait_for_event(events, NULL);
+        }
+
+        /**
+         * Handle every event that is waiting, not just one.
+         * (Control can start another "drc_run" inside of this one,
+         * so it's timed here instead of with "drc_profile_start".)
+         */
+        while (al_get_next_event(events, &event)) {
+
+            if (event.type == ALLEGRO_EVENT_TIMER && event.timer.source == timer) {
+                num_timer_ticks++;
+                continue;
+            }
+
+            if (control != NULL) {
+                double control_start = al_get_time();
+                double nested_before = drc_run_secs;
+                DRC_TRACE_BEGIN("control", NULL);
+                control(data, &event); /* CONTROL */
+                DRC_TRACE_END();
+                drc_profile_add(DRC_PROFILE_CONTROL, al_get_time() - control_start - (drc_run_secs - nested_before));
             }
         }
-    
-        if (redraw && al_is_event_queue_empty(events)) {
-            if (draw != NULL) {
-                drc_clear_display();
-                draw(data); /* DRAW */
-                al_flip_display();
-                redraw = false;
+
+        if (update == NULL) {
+            keep_running = false;
+            DRC_TRACE_END();
+            break;
+        }
+
+        /* Save up the time that has passed since the last time through */
+        double now = al_get_time();
+
+        if (drc_run_policy == DRC_RUN_POLICY_FIXED) {
+            accumulator += tick * num_timer_ticks;
+            num_timer_ticks = 0;
+        } else {
+            accumulator += now - prev_time;
+        }
+
+        prev_time = now;
+
+        int num_updates = 0;
+
+        double update_start = now;
+        double nested_before = drc_run_secs;
+
+        while (keep_running && accumulator >= tick && num_updates < drc_run_max_catch_up) {
+            DRC_TRACE_BEGIN("update", NULL);
+            drc_reset_frame_memory();
+            keep_running = update(data); /* UPDATE */
+            drc_update_sound();
+            drc_update_music();
+            DRC_TRACE_END();
+            drc_run_tick_count++;
+            accumulator -= tick;
+            num_updates++;
+        }
+
+        /* Nothing updated, so there's no time to count */
+        if (num_updates > 0) {
+            drc_profile_add(DRC_PROFILE_UPDATE, al_get_time() - update_start - (drc_run_secs - nested_before));
+        }
+
+        /**
+         * If the game is still too far behind, give up on catching up.
+         * Throw away the extra time but keep the leftover part of a tick.
+         */
+        if (accumulator >= tick) {
+            accumulator -= tick * (int)(accumulator / tick);
+        }
+
+        if (drc_run_policy == DRC_RUN_POLICY_FIXED) {
+            /* It's drawn right after it updates, so draw everything where it is now */
+            drc_run_interpolation = 1;
+        } else {
+            drc_run_interpolation = (float)(accumulator / tick);
+        }
+
+        /* With the FIXED policy, there's nothing new to draw until something updates */
+        if (drc_run_policy == DRC_RUN_POLICY_FIXED && num_updates == 0) {
+            DRC_TRACE_END();
+            continue;
+        }
+
+        if (keep_running && draw != NULL) {
+            drc_profile_start(DRC_PROFILE_DRAW);
+            DRC_TRACE_BEGIN("draw", NULL);
+            drc_clear_display();
+            draw(data); /* DRAW */
+            drc_draw_profile_overlay();
+            DRC_TRACE_END();
+            drc_profile_stop(DRC_PROFILE_DRAW);
+
+            drc_profile_start(DRC_PROFILE_FLIP);
+            DRC_TRACE_BEGIN("flip", NULL);
+            al_flip_display();
+            DRC_TRACE_END();
+            drc_profile_stop(DRC_PROFILE_FLIP);
+        }
+
+        /**
+         * Don't spin as fast as the computer will go. If VSYNC is
+         * on, flipping already waited for the monitor, but if it
+         * came back too soon then the driver ignored it, so wait
+         * out the rest of the refresh here instead. UNCAPPED still
+         * gives the rest of the computer a turn.
+         */
+        if (drc_run_policy == DRC_RUN_POLICY_VSYNC) {
+            double frame_secs = al_get_time() - prev_flip;
+            if (frame_secs < refresh * 0.9) {
+                al_rest(refresh - frame_secs);
             }
+            prev_flip = al_get_time();
+        } else if (drc_run_policy == DRC_RUN_POLICY_UNCAPPED) {
+            al_rest(0);
         }
+
+        drc_profile_next_frame();
+
+        DRC_TRACE_END();
     }
-  
+
     al_destroy_event_queue(events);
     al_destroy_timer(timer);
+
+    /* However long this took, including any runs inside of it */
+    drc_run_secs = run_secs_before + (al_get_time() - run_start);
 }
@@ -1,10 +1,37 @@
 #pragma once
 
 #include <allegro5/allegro.h>
+#include <stdint.h>
 
 /* The number of times the game will update per second */
 #define DRC_DEFAULT_FPS (100)
 
+/**
+ * The most updates that will be run before drawing a frame.
+ * If the game falls further behind than this (a slow computer,
+ * a long load, the window being dragged...) then the extra time
+ * is thrown away instead of trying to catch up all at once.
+ */
+#define DRC_DEFAULT_MAX_CATCH_UP (10)
+
+/**
+ * How often the screen is drawn.
+ *
+ * The game logic ALWAYS updates at exactly "FPS" times per second,
+ * no matter which policy is used. The policy only changes how
+ * often the screen is drawn in between those updates.
+ *
+ *   FIXED    - Draw once per update, paced by a timer
+ *   VSYNC    - Draw once per refresh of the monitor
+ *   UNCAPPED - Draw as often as possible
+ */
+typedef enum
+{
+    DRC_RUN_POLICY_FIXED = 0,
+    DRC_RUN_POLICY_VSYNC,
+    DRC_RUN_POLICY_UNCAPPED
+} DRC_RUN_POLICY;
+
 /**
  * Control the FPS.
  *
@@ -16,6 +43,37 @@
 void drc_set_fps(int fps);
 int drc_get_fps(void);
 
+/**
+ * Control how often the screen is drawn.
+ *
+ * Note: The VSYNC policy needs to be set before the
+ * display is created.
+ */
+void drc_set_run_policy(DRC_RUN_POLICY policy);
+DRC_RUN_POLICY drc_get_run_policy(void);
+
+/**
+ * Control the most updates that can be run in a row
+ * before a frame is drawn. Must be at least 1.
+ */
+void drc_set_max_catch_up(int max_updates);
+
+/**
+ * How far along the game is between the last update and
+ * the next one, from 0.0 to 1.0. Use this while drawing
+ * to smoothly place things between their previous and
+ * current positions.
+ */
+float drc_get_interpolation(void);
+
+/**
+ * How many updates have been run since the game started.
+ * Anything that only depends on how much time has passed
+ * (such as a looping animation, see "drc_sprite.h") can be
+ * worked out from this instead of being updated every time.
+ */
+int64_t drc_get_tick_count(void);
+
 /* Run until "update" returns false */
 void drc_run(void (*control)(void *data, ALLEGRO_EVENT *event),
         bool (*update)(void *data), void (*draw)(void *data), void *data);
@@ -1,16 +1,265 @@
 #include <stdbool.h>
+#include <stdio.h>
 #include "drc_sound.h"
 
+/* Sounds were always played this loud */
+#define DRC_SOUND_GAIN (6.0)
+
+typedef struct
+{
+    ALLEGRO_SAMPLE_INSTANCE *instance;
+    DRC_SOUND_PRIORITY priority;
+
+    /* To the default mixer, once it has a sound to play */
+    bool attached;
+
+    /* When it started, to find the oldest sound */
+    double start_time;
+} DRC_VOICE;
+
+/* What's known about each sound */
+typedef struct
+{
+    ALLEGRO_SAMPLE *sample;
+    DRC_SOUND_PRIORITY priority;
+
+    /* When it last started playing, or a negative number if it hasn't */
+    double last_played;
+
+    /* If it was played since the last update */
+    bool queued;
+} DRC_SOUND_INFO;
+
 static bool drc_is_audio_on = true;
 
+static DRC_VOICE drc_voices[DRC_MAX_VOICES];
+static int drc_num_voices = 0;
+
+static DRC_SOUND_INFO drc_sounds[DRC_MAX_SOUNDS];
+static int drc_num_sounds = 0;
+
+/* Stats */
+static int drc_num_sounds_played = 0;
+static int drc_num_sounds_coalesced = 0;
+static int drc_num_sounds_throttled = 0;
+static int drc_num_sounds_dropped = 0;
+
+bool drc_init_sound(int num_voices)
+{
+    if (!al_is_audio_installed() || al_get_default_mixer() == NULL) {
+        return false;
+    }
+
+    if (num_voices > DRC_MAX_VOICES) {
+        num_voices = DRC_MAX_VOICES;
+    }
+
+    drc_free_sound();
+
+    for (int i = 0; i < num_voices; i++) {
+
+        ALLEGRO_SAMPLE_INSTANCE *instance = al_create_sample_instance(NULL);
+
+        if (instance == NULL) {
+            break;
+        }
+
+        drc_voices[drc_num_voices].instance = instance;
+        drc_voices[drc_num_voices].attached = false;
+        drc_num_voices++;
+    }
+
+    return drc_num_voices > 0;
+}
+
+void drc_free_sound(void)
+{
+    for (int i = 0; i < drc_num_voices; i++) {
+        al_destroy_sample_instance(drc_voices[i].instance);
+        drc_voices[i].instance = NULL;
+    }
+
+    drc_num_voices = 0;
+    drc_num_sounds = 0;
+}
+
+static DRC_SOUND_INFO *drc_get_sound_info(ALLEGRO_SAMPLE *snd)
+{
+    for (int i = 0; i < drc_num_sounds; i++) {
+        if (drc_sounds[i].sample == snd) {
+            return &drc_sounds[i];
+        }
+    }
+
+    if (drc_num_sounds >= DRC_MAX_SOUNDS) {
+        return NULL;
+    }
+
+    DRC_SOUND_INFO *info = &drc_sounds[drc_num_sounds];
+    drc_num_sounds++;
+
+    info->sample = snd;
+    info->priority = DRC_SOUND_PRIORITY_NORMAL;
+    info->last_played = -1;
+    info->queued = false;
+
+    return info;
+}
+
+void drc_set_sound_priority(ALLEGRO_SAMPLE *snd, DRC_SOUND_PRIORITY priority)
+{
+    if (snd == NULL) {
+        return;
+    }
+
+    DRC_SOUND_INFO *info = drc_get_sound_info(snd);
+
+    if (info != NULL) {
+        info->priority = priority;
+    }
+}
+
 void drc_play_sound(ALLEGRO_SAMPLE *snd)
 {
-    if (al_is_audio_installed() && drc_is_audio_on) {
-        al_play_sample(snd, 6.0, 0.0, 1.0, ALLEGRO_PLAYMODE_ONCE, NULL);
+    if (!al_is_audio_installed() || !drc_is_audio_on || snd == NULL) {
+        return;
+    }
+
+    DRC_SOUND_INFO *info = NULL;
+
+    if (drc_num_voices > 0) {
+        info = drc_get_sound_info(snd);
+    }
+
+    /* There aren't any voices (or too many sounds), just play it */
+    if (info == NULL) {
+        if (al_play_sample(snd, DRC_SOUND_GAIN, 0.0, 1.0, ALLEGRO_PLAYMODE_ONCE, NULL)) {
+            drc_num_sounds_played++;
+        } else {
+            drc_num_sounds_dropped++;
+        }
+        return;
+    }
+
+    if (info->queued) {
+        drc_num_sounds_coalesced++;
+        return;
+    }
+
+    info->queued = true;
+}
+
+/**
+ * A voice that isn't playing anything, or else the oldest
+ * sound with the lowest priority below "priority", or else NULL.
+ */
+static DRC_VOICE *drc_find_voice(DRC_SOUND_PRIORITY priority)
+{
+    DRC_VOICE *found = NULL;
+
+    for (int i = 0; i < drc_num_voices; i++) {
+
+        DRC_VOICE *voice = &drc_voices[i];
+
+        if (!al_get_sample_instance_playing(voice->instance)) {
+            return voice;
+        }
+
+        if (voice->priority >= priority) {
+            continue;
+        }
+
+        if (found == NULL || voice->priority < found->priority ||
+                (voice->priority == found->priority && voice->start_time < found->start_time)) {
+            found = voice;
+        }
     }
+
+    return found;
+}
+
+static void drc_start_sound(DRC_SOUND_INFO *info, double now)
+{
+    if (info->last_played >= 0 && now - info->last_played < DRC_SOUND_MIN_INTERVAL) {
+        drc_num_sounds_throttled++;
+        return;
+    }
+
+    DRC_VOICE *voice = drc_find_voice(info->priority);
+
+    if (voice == NULL) {
+        drc_num_sounds_dropped++;
+        return;
+    }
+
+    al_stop_sample_instance(voice->instance);
+
+    if (!al_set_sample(voice->instance, info->sample)) {
+        drc_num_sounds_dropped++;
+        return;
+    }
+
+    if (!voice->attached) {
+        voice->attached = al_attach_sample_instance_to_mixer(voice->instance, al_get_default_mixer());
+    }
+
+    al_set_sample_instance_gain(voice->instance, DRC_SOUND_GAIN);
+
+    if (!voice->attached || !al_play_sample_instance(voice->instance)) {
+        drc_num_sounds_dropped++;
+        return;
+    }
+
+    voice->priority = info->priority;
+    voice->start_time = now;
+    info->last_played = now;
+
+    drc_num_sounds_played++;
+}
+
+void drc_update_sound(void)
+{
+    double now = -1;
+
+    /* The most important sounds get the voices first */
+    for (int priority = DRC_SOUND_PRIORITY_HIGH; priority >= DRC_SOUND_PRIORITY_LOW; priority--) {
+        for (int i = 0; i < drc_num_sounds; i++) {
+
+            DRC_SOUND_INFO *info = &drc_sounds[i];
+
+            if (!info->queued || (int)info->priority != priority) {
+                continue;
+            }
+
+            info->queued = false;
+
+            /* In case audio was just toggled off */
+            if (!drc_is_audio_on) {
+                continue;
+            }
+
+            /* Only check the time if something needs to play */
+            if (now < 0) {
+                now = al_get_time();
+            }
+
+            drc_start_sound(info, now);
+        }
+    }
+}
+
+void drc_print_sound_stats(void)
+{
+    printf("Sounds: played %d, %d were the same sound at the same time, %d too soon after the last one, %d had no voice.\n",
+        drc_num_sounds_played, drc_num_sounds_coalesced, drc_num_sounds_throttled, drc_num_sounds_dropped);
 }
 
 void drc_toggle_audio(void)
 {
     drc_is_audio_on = drc_is_audio_on ? false : true;
 }
+
+bool drc_is_audio_toggled_on(void)
+{
+    return drc_is_audio_on;
+}
@@ -3,8 +3,56 @@
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_audio.h>
 
+/**
+ * Sounds are played on a small number of voices. When a sound is
+ * played, it waits until the end of the update ("drc_update_sound",
+ * called by "drc_run"), so if the same sound is played more than
+ * once in the same update (such as a laser destroying a whole row
+ * of blocks) it's only heard once.
+ *
+ * The same sound won't play again until DRC_SOUND_MIN_INTERVAL
+ * seconds later. When every voice is busy, a sound takes the voice
+ * of a sound with a lower priority, or it isn't played.
+ */
+
+#define DRC_DEFAULT_NUM_VOICES (8)
+#define DRC_MAX_VOICES (32)
+
+/* The most different sounds that can have their own priority */
+#define DRC_MAX_SOUNDS (64)
+
+/* How long until the same sound can play again, in seconds */
+#define DRC_SOUND_MIN_INTERVAL (0.03)
+
+typedef enum
+{
+    DRC_SOUND_PRIORITY_LOW = 0,
+    DRC_SOUND_PRIORITY_NORMAL,
+    DRC_SOUND_PRIORITY_HIGH
+} DRC_SOUND_PRIORITY;
+
+/**
+ * Create the voices that sounds are played on, using the default
+ * mixer (so "al_reserve_samples" has to be called first, it can
+ * reserve 0 samples). Without this, sounds are played right away,
+ * the same as "al_play_sample".
+ */
+bool drc_init_sound(int num_voices);
+
+void drc_free_sound(void);
+
 /* Play a sound, won't do anything if audio is toggled off */
 void drc_play_sound(ALLEGRO_SAMPLE *snd);
 
+/* Sounds are DRC_SOUND_PRIORITY_NORMAL unless they're set to something else */
+void drc_set_sound_priority(ALLEGRO_SAMPLE *snd, DRC_SOUND_PRIORITY priority);
+
+/* Start the sounds that were played since the last update */
+void drc_update_sound(void);
+
+/* Print how many sounds were played, and how many weren't */
+void drc_print_sound_stats(void);
+
 /* Toggle audio on and off, audio is on by default */
 void drc_toggle_audio(void);
+bool drc_is_audio_toggled_on(void);
@@ -1,19 +1,181 @@
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
 #include "drc_run.h"
 #include "drc_sprite.h"
 
+/**
+ * Every animation, in a hash table with each one in the first
+ * free spot after where its hash says it goes. It doubles in
+ * size whenever it gets more than half full. The animations
+ * themselves are in the global arena, so they never move.
+ */
+#define DRC_ANIMATIONS_START_SIZE (64)
+
+static const DRC_ANIMATION **drc_animations = NULL;
+static int drc_animations_size = 0;
+static int drc_num_animations = 0;
+
+static ALLEGRO_MUTEX *drc_animations_mutex = NULL;
+
+/* Stats */
+static int drc_num_animation_lookups = 0;
+
+static uint32_t drc_hash_animation(ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop)
+{
+    /* FNV-1a, on the frame pointers */
+    uint32_t hash = 2166136261u ^ (uint32_t)((len << 1) | (loop ? 1 : 0));
+    hash = (hash ^ (uint32_t)speed) * 16777619u;
+
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ (uint32_t)((uintptr_t)frames[i] >> 4)) * 16777619u;
+    }
+
+    return hash;
+}
+
+static bool drc_is_same_animation(const DRC_ANIMATION *animation, ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop)
+{
+    return animation->len == len && animation->speed == speed && animation->loop == loop &&
+        (len == 0 || memcmp(animation->frames, frames, len * sizeof(ALLEGRO_BITMAP *)) == 0);
+}
+
+static const DRC_ANIMATION **drc_find_animation_spot(const DRC_ANIMATION **table, int size, ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop)
+{
+    int i = drc_hash_animation(frames, len, speed, loop) & (size - 1);
+
+    while (table[i] != NULL && !drc_is_same_animation(table[i], frames, len, speed, loop)) {
+        i = (i + 1) & (size - 1);
+    }
+
+    return &table[i];
+}
+
+static void drc_grow_animations(void)
+{
+    int size = drc_animations_size > 0 ? drc_animations_size * 2 : DRC_ANIMATIONS_START_SIZE;
+
+    const DRC_ANIMATION **table = drc_calloc_memory("DRC_ANIMATIONS", size, sizeof(DRC_ANIMATION *));
+    assert(table != NULL);
+
+    /* Move everything to its spot in the bigger table */
+    for (int i = 0; i < drc_animations_size; i++) {
+        const DRC_ANIMATION *animation = drc_animations[i];
+        if (animation != NULL) {
+            *drc_find_animation_spot(table, size, animation->frames, animation->len, animation->speed, animation->loop) = animation;
+        }
+    }
+
+    if (drc_animations != NULL) {
+        drc_free_memory("DRC_ANIMATIONS", drc_animations);
+    }
+
+    drc_animations = table;
+    drc_animations_size = size;
+}
+
+static DRC_ANIMATION *drc_make_animation(ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop)
+{
+    DRC_ANIMATION *animation = drc_arena_alloc_memory(drc_get_global_arena(), "DRC_ANIMATION", sizeof(DRC_ANIMATION));
+    assert(animation != NULL);
+
+    for (int i = 0; i < len; i++) {
+        assert(frames[i] != NULL);
+        animation->frames[i] = frames[i];
+    }
+
+    animation->len = len;
+    animation->speed = speed;
+    animation->loop = loop;
+
+    return animation;
+}
+
+const DRC_ANIMATION *drc_get_animation(ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop)
+{
+    assert(len >= 0 && len <= MAX_FRAMES);
+    assert(len == 0 || frames != NULL);
+
+    speed = speed < 0 ? 0 : speed;
+
+    if (drc_animations_mutex != NULL) {
+        al_lock_mutex(drc_animations_mutex);
+    }
+
+    drc_num_animation_lookups++;
+
+    if ((drc_num_animations + 1) * 2 > drc_animations_size) {
+        drc_grow_animations();
+    }
+
+    const DRC_ANIMATION **spot = drc_find_animation_spot(drc_animations, drc_animations_size, frames, len, speed, loop);
+
+    if (*spot == NULL) {
+        *spot = drc_make_animation(frames, len, speed, loop);
+        drc_num_animations++;
+    }
+
+    const DRC_ANIMATION *animation = *spot;
+
+    if (drc_animations_mutex != NULL) {
+        al_unlock_mutex(drc_animations_mutex);
+    }
+
+    return animation;
+}
+
+void drc_free_animations(void)
+{
+    if (drc_animations != NULL) {
+        drc_free_memory("DRC_ANIMATIONS", drc_animations);
+    }
+
+    drc_animations = NULL;
+    drc_animations_size = 0;
+    drc_num_animations = 0;
+
+    if (drc_animations_mutex != NULL) {
+        al_destroy_mutex(drc_animations_mutex);
+        drc_animations_mutex = NULL;
+    }
+}
+
+void drc_share_animations_between_threads(void)
+{
+    if (drc_animations_mutex == NULL) {
+        drc_animations_mutex = al_create_mutex();
+        assert(drc_animations_mutex != NULL);
+    }
+}
+
+
+void drc_print_animation_stats(void)
+{
+    printf("Animations: %d shared by sprites %d times, a sprite is %d bytes (%d with its own frames).\n",
+        drc_num_animations, drc_num_animation_lookups, (int)sizeof(DRC_SPRITE), (int)(sizeof(DRC_SPRITE) + sizeof(DRC_ANIMATION)));
+}
+
+void drc_set_animation(DRC_SPRITE *sprite, const DRC_ANIMATION *animation)
+{
+    assert(sprite != NULL);
+
+    sprite->animation = animation;
+    drc_reset_sprite(sprite);
+}
+
 void drc_init_sprite(DRC_SPRITE *sprite, bool loop, int speed)
+{
+    /* No frames yet, but it knows how fast they'll go */
+    drc_init_sprite_with_animation(sprite, drc_get_animation(NULL, 0, speed, loop));
+}
+
+void drc_init_sprite_with_animation(DRC_SPRITE *sprite, const DRC_ANIMATION *animation)
 {
     assert(sprite != NULL);
-    
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        sprite->frames[i] = NULL;
-    }
-    
-    sprite->speed = speed < 0 ? 0 : speed;
-    sprite->loop = loop;
 
-    sprite->len = 0;
+    sprite->animation = animation;
+
     sprite->pos = 0;
     sprite->done = false;
     sprite->fudge = 0;
@@ -22,6 +184,7 @@ void drc_init_sprite(DRC_SPRITE *sprite, bool loop, int speed)
     sprite->rotate = false;
     sprite->mirror = false;
     sprite->flip = false;
+    sprite->on_clock = false;
 }
 
 void drc_copy_sprite(DRC_SPRITE *copy, DRC_SPRITE *orig)
@@ -30,17 +193,8 @@ void drc_copy_sprite(DRC_SPRITE *copy, DRC_SPRITE *orig)
     assert(copy != NULL);
     assert(orig != NULL);
 
-    drc_init_sprite(copy, orig->loop, orig->speed);
-    
-    for (int i = 0; i < orig->len; i++) {
-        drc_add_frame(copy, orig->frames[i]);
-    }
-    
-    copy->x_offset = orig->x_offset;
-    copy->y_offset = orig->y_offset;
-    copy->rotate = orig->rotate;
-    copy->mirror = orig->mirror;
-    copy->flip = orig->flip;
+    /* The animation is shared, so it doesn't need to be copied */
+    *copy = *orig;
   
     drc_reset_sprite(copy);
 }
@@ -56,35 +210,85 @@ void drc_reset_sprite(DRC_SPRITE *sprite)
     sprite->fudge = 0;
 }
 
+/* The number of frames, a sprite that was never initialized has none */
+static int drc_get_num_frames(DRC_SPRITE *sprite)
+{
+    return sprite->animation != NULL ? sprite->animation->len : 0;
+}
+
+void drc_put_sprite_on_clock(DRC_SPRITE *sprite)
+{
+    assert(sprite != NULL);
+
+    sprite->on_clock = true;
+    drc_reset_sprite(sprite);
+}
+
+/**
+ * The frame "drc_animate" would be on if it had been
+ * called once for every update that has been run.
+ */
+static int drc_get_clock_pos(const DRC_ANIMATION *animation)
+{
+    if (animation->len < 2 || animation->speed == 0) {
+        return 0;
+    }
+
+    int64_t num_frames = (drc_get_tick_count() * animation->speed) / drc_get_fps();
+
+    if (animation->loop) {
+        return (int)(num_frames % animation->len);
+    }
+
+    return num_frames < animation->len ? (int)num_frames : animation->len - 1;
+}
+
 ALLEGRO_BITMAP *drc_get_frame(DRC_SPRITE *sprite)
 {
-    if (sprite == NULL || sprite->len == 0) {
+    if (sprite == NULL || drc_get_num_frames(sprite) == 0) {
         return NULL;
     }
 
-    return sprite->frames[sprite->pos];
+    if (sprite->on_clock) {
+        return sprite->animation->frames[drc_get_clock_pos(sprite->animation)];
+    }
+
+    return sprite->animation->frames[sprite->pos];
 }
 
 void drc_add_frame(DRC_SPRITE *sprite, ALLEGRO_BITMAP *frame)
 {
     assert(sprite != NULL);
     assert(frame != NULL);
-    assert(sprite->len <= MAX_FRAMES);
 
-    sprite->frames[sprite->len] = frame;
-    sprite->len++;
+    const DRC_ANIMATION *animation = sprite->animation;
+
+    if (animation == NULL) {
+        animation = drc_get_animation(NULL, 0, 0, false);
+    }
+
+    assert(animation->len < MAX_FRAMES);
+
+    ALLEGRO_BITMAP *frames[MAX_FRAMES];
+
+    memcpy(frames, animation->frames, animation->len * sizeof(ALLEGRO_BITMAP *));
+    frames[animation->len] = frame;
+
+    sprite->animation = drc_get_animation(frames, animation->len + 1, animation->speed, animation->loop);
 }
 
-void delete_frames(DRC_SPRITE *sprite)
+void drc_delete_frames(DRC_SPRITE *sprite)
 {
     assert(sprite != NULL);
     drc_reset_sprite(sprite);
 
     /**
-     * Just set the length to zero. The images will be handled
-     * by the resource manager.
+     * Just use the same animation without any frames. The
+     * images will be handled by the resource manager.
      */
-    sprite->len = 0;
+    if (sprite->animation != NULL) {
+        sprite->animation = drc_get_animation(NULL, 0, sprite->animation->speed, sprite->animation->loop);
+    }
 }
 
 static void draw_image(ALLEGRO_BITMAP *img, float x, float y, bool rotate, bool mirror, bool flip)
@@ -120,7 +324,7 @@ static void draw_image(ALLEGRO_BITMAP *img, float x, float y, bool rotate, bool
 
 void drc_draw_sprite(DRC_SPRITE *sprite, float x, float y)
 {
-    if (sprite == NULL || sprite->len == 0) {
+    if (sprite == NULL || drc_get_num_frames(sprite) == 0) {
         return;
     }
 
@@ -134,14 +338,17 @@ void drc_draw_sprite(DRC_SPRITE *sprite, float x, float y)
 /* Animate the sprite */
 void drc_animate(DRC_SPRITE *sprite)
 {
-    if (sprite == NULL) {
+    /* The clock animates it */
+    if (sprite == NULL || sprite->on_clock) {
         return;
     }
 
+    const DRC_ANIMATION *animation = sprite->animation;
+
     /* If there's actually anything to animate...*/
-    if (sprite->len > 1 && sprite->speed != 0) {
+    if (animation != NULL && animation->len > 1 && animation->speed != 0) {
      
-        sprite->fudge += sprite->speed;
+        sprite->fudge += animation->speed;
       
         /**
          * Cycle through as many frames as necessary for the
@@ -149,8 +356,8 @@ void drc_animate(DRC_SPRITE *sprite)
          */
         while (sprite->fudge >= drc_get_fps()) {
             sprite->pos++;
-            if (sprite->pos == sprite->len) {
-                if (sprite->loop) {
+            if (sprite->pos == animation->len) {
+                if (animation->loop) {
                     sprite->pos = 0;
                 } else {
                     sprite->pos--;
@@ -167,7 +374,7 @@ void drc_animate(DRC_SPRITE *sprite)
 
 int drc_get_sprite_width(DRC_SPRITE *sprite)
 {
-    if (sprite == NULL || sprite->len == 0) {
+    if (sprite == NULL || drc_get_num_frames(sprite) == 0) {
         return 0;
     }
 
@@ -176,7 +383,7 @@ int drc_get_sprite_width(DRC_SPRITE *sprite)
 
 int drc_get_sprite_height(DRC_SPRITE *sprite)
 {
-    if (sprite == NULL || sprite->len == 0) {
+    if (sprite == NULL || drc_get_num_frames(sprite) == 0) {
         return 0;
     }
 
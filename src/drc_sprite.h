@@ -4,12 +4,30 @@
 
 #define MAX_FRAMES (32)
 
+/**
+ * The frames of an animation, how fast it goes and if it loops.
+ *
+ * Animations are shared: every sprite showing the same animation
+ * points to the same one, so a sprite doesn't need its own copy
+ * of the frames. An animation never changes once it's made.
+ */
 typedef struct
 {
     ALLEGRO_BITMAP *frames[MAX_FRAMES];
     int len;
-    int pos;
+
+    /* In frames per second */
     int speed;
+
+    bool loop;
+} DRC_ANIMATION;
+
+/* One thing showing an animation, and where it is in it */
+typedef struct
+{
+    const DRC_ANIMATION *animation;
+
+    int pos;
     int fudge;
     
     bool done;
@@ -18,11 +36,12 @@ typedef struct
     int x_offset;
     int y_offset;
   
-    bool loop;
-  
     bool rotate;
     bool mirror;
     bool flip;
+
+    /* Animated by the clock instead of "drc_animate", see below */
+    bool on_clock;
 } DRC_SPRITE;
 
 /**
@@ -31,6 +50,32 @@ typedef struct
  */
 void drc_set_animation_fps(int fps);
 
+/**
+ * Get the animation with these frames, speed and loop.
+ * It's only made the first time, after that the same
+ * one is given back.
+ */
+const DRC_ANIMATION *drc_get_animation(ALLEGRO_BITMAP *const *frames, int len, int speed, bool loop);
+
+/**
+ * Show an animation, from the beginning.
+ * The offsets and rotation of the sprite stay the same.
+ */
+void drc_set_animation(DRC_SPRITE *sprite, const DRC_ANIMATION *animation);
+
+/* Forget every animation, sprites can't use them after this */
+void drc_free_animations(void);
+
+/**
+ * Call this before getting animations (or initializing sprites)
+ * on more than one thread at a time. The animations stay shared
+ * until they're freed.
+ */
+void drc_share_animations_between_threads(void);
+
+/* Print how many animations there are and how much memory they save */
+void drc_print_animation_stats(void);
+
 /**
  * Initialize a sprite.
  * It will have no frames of animation by default.
@@ -38,6 +83,12 @@ void drc_set_animation_fps(int fps);
  */
 void drc_init_sprite(DRC_SPRITE *sprite, bool loop, int speed);
 
+/**
+ * Initialize a sprite showing an animation, which is
+ * much faster than adding the frames one at a time.
+ */
+void drc_init_sprite_with_animation(DRC_SPRITE *sprite, const DRC_ANIMATION *animation);
+
 /**
  * Copy an existing sprite.
  * Useful when you want the same sprite but rotated.
@@ -49,6 +100,16 @@ void drc_copy_sprite(DRC_SPRITE *copy, DRC_SPRITE *orig);
  */
 void drc_animate(DRC_SPRITE *sprite);
 
+/**
+ * Put a sprite "on the clock". Its frame is worked out from the
+ * number of updates that have been run (see "drc_get_tick_count")
+ * whenever it's drawn, so it doesn't need "drc_animate" and every
+ * sprite on the clock with the same animation shows the same frame.
+ * Good for scenery and blocks, that loop forever and all
+ * start at the same time.
+ */
+void drc_put_sprite_on_clock(DRC_SPRITE *sprite);
+
 /**
  * Returns a pointer to the current frame of animation.
  */
@@ -56,6 +117,10 @@ ALLEGRO_BITMAP *drc_get_frame(DRC_SPRITE *sprite);
 
 /**
  * Add a frame to the sprite.
+ *
+ * This changes the sprite to a different animation, with one
+ * more frame. To show an animation with many frames on many
+ * sprites, get it once with "drc_get_animation" instead.
  */
 void drc_add_frame(DRC_SPRITE *sprite, ALLEGRO_BITMAP *frame);
 
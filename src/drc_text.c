@@ -2,10 +2,96 @@
 #include <allegro5/allegro_font.h>
 #include "drc_text.h"
 
+/* The letters in the letter sheet, every printable ASCII character */
+#define DRC_FIRST_GLYPH (32)
+#define DRC_LAST_GLYPH (126)
+#define DRC_NUM_GLYPHS ((DRC_LAST_GLYPH) - (DRC_FIRST_GLYPH) + 1)
+#define DRC_GLYPH_COLS (16)
+
+typedef struct
+{
+    char text[DRC_TEXT_MAX_LEN];
+    ALLEGRO_BITMAP *image;
+
+    /* When this was last drawn, to find the oldest entry */
+    unsigned long last_used;
+} DRC_TEXT_CACHE_ENTRY;
+
 static bool drc_text_init = false;
 
 static ALLEGRO_FONT *drc_font = NULL;
 
+/* Strings that have already been drawn with a border */
+static DRC_TEXT_CACHE_ENTRY drc_text_cache[DRC_TEXT_CACHE_SIZE];
+static unsigned long drc_text_clock = 0;
+
+/**
+ * The letter sheet, for dynamic text.
+ *
+ * Each letter is in a cell one pixel bigger than the letter on
+ * every side, to make room for the border. The top half of the
+ * sheet has just the black borders and the bottom half has just
+ * the white letters, so that all of the borders can be drawn
+ * before the letters, the same as "drc_draw_outlined_text".
+ */
+static ALLEGRO_BITMAP *drc_glyph_sheet = NULL;
+static int drc_glyph_w = 0;
+static int drc_glyph_h = 0;
+
+/**
+ * Draw the text five times, four black offsets for the
+ * border and then the white text on top.
+ */
+static void drc_draw_outlined_text(float x, float y, const char *text)
+{
+    /* Draw the black outline */
+    al_draw_text(drc_font, al_map_rgb(0, 0, 0), x - 1, y, ALLEGRO_ALIGN_INTEGER, text);
+    al_draw_text(drc_font, al_map_rgb(0, 0, 0), x + 1, y, ALLEGRO_ALIGN_INTEGER, text);
+    al_draw_text(drc_font, al_map_rgb(0, 0, 0), x, y - 1, ALLEGRO_ALIGN_INTEGER, text);
+    al_draw_text(drc_font, al_map_rgb(0, 0, 0), x, y + 1, ALLEGRO_ALIGN_INTEGER, text);
+
+    /* Draw the white text */
+    al_draw_text(drc_font, al_map_rgb(255, 255, 255), x, y, ALLEGRO_ALIGN_INTEGER, text);
+}
+
+static void drc_make_glyph_sheet(void)
+{
+    drc_glyph_w = al_get_text_width(drc_font, "M");
+    drc_glyph_h = al_get_font_line_height(drc_font);
+
+    int cell_w = drc_glyph_w + 2;
+    int cell_h = drc_glyph_h + 2;
+    int rows = (DRC_NUM_GLYPHS + DRC_GLYPH_COLS - 1) / DRC_GLYPH_COLS;
+
+    drc_glyph_sheet = al_create_bitmap(DRC_GLYPH_COLS * cell_w, rows * cell_h * 2);
+    assert(drc_glyph_sheet != NULL);
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+
+    al_set_target_bitmap(drc_glyph_sheet);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+
+    for (int i = 0; i < DRC_NUM_GLYPHS; i++) {
+
+        char letter[2] = {(char)(DRC_FIRST_GLYPH + i), '\0'};
+
+        float x = ((i % DRC_GLYPH_COLS) * cell_w) + 1;
+        float y = ((i / DRC_GLYPH_COLS) * cell_h) + 1;
+
+        /* Border in the top half */
+        al_draw_text(drc_font, al_map_rgb(0, 0, 0), x - 1, y, ALLEGRO_ALIGN_INTEGER, letter);
+        al_draw_text(drc_font, al_map_rgb(0, 0, 0), x + 1, y, ALLEGRO_ALIGN_INTEGER, letter);
+        al_draw_text(drc_font, al_map_rgb(0, 0, 0), x, y - 1, ALLEGRO_ALIGN_INTEGER, letter);
+        al_draw_text(drc_font, al_map_rgb(0, 0, 0), x, y + 1, ALLEGRO_ALIGN_INTEGER, letter);
+
+        /* Letter in the bottom half */
+        al_draw_text(drc_font, al_map_rgb(255, 255, 255), x, y + (rows * cell_h), ALLEGRO_ALIGN_INTEGER, letter);
+    }
+
+    al_restore_state(&state);
+}
+
 bool drc_init_text(void)
 {
     if (drc_text_init) {
@@ -13,10 +99,18 @@ bool drc_init_text(void)
     }
 
     assert(al_init_font_addon());
-    
+
     drc_font = al_create_builtin_font();
     assert(drc_font != NULL);
 
+    for (int i = 0; i < DRC_TEXT_CACHE_SIZE; i++) {
+        drc_text_cache[i].text[0] = '\0';
+        drc_text_cache[i].image = NULL;
+        drc_text_cache[i].last_used = 0;
+    }
+
+    drc_make_glyph_sheet();
+
     drc_text_init = true;
     return true;
 }
@@ -27,21 +121,117 @@ void drc_free_text(void)
         return;
     }
 
+    for (int i = 0; i < DRC_TEXT_CACHE_SIZE; i++) {
+        if (drc_text_cache[i].image != NULL) {
+            al_destroy_bitmap(drc_text_cache[i].image);
+            drc_text_cache[i].image = NULL;
+        }
+    }
+
+    al_destroy_bitmap(drc_glyph_sheet);
+    drc_glyph_sheet = NULL;
+
     al_destroy_font(drc_font);
     drc_font = NULL;
+
+    drc_text_init = false;
+}
+
+/**
+ * Find the bordered image of the text, making
+ * it (and forgetting the oldest one) if needed.
+ */
+static ALLEGRO_BITMAP *drc_get_text_image(const char *text)
+{
+    DRC_TEXT_CACHE_ENTRY *oldest = &drc_text_cache[0];
+
+    drc_text_clock++;
+
+    for (int i = 0; i < DRC_TEXT_CACHE_SIZE; i++) {
+
+        DRC_TEXT_CACHE_ENTRY *entry = &drc_text_cache[i];
+
+        if (entry->image != NULL && strcmp(entry->text, text) == 0) {
+            entry->last_used = drc_text_clock;
+            return entry->image;
+        }
+
+        if (entry->last_used < oldest->last_used) {
+            oldest = entry;
+        }
+    }
+
+    /* Not found, replace the oldest one */
+    if (oldest->image != NULL) {
+        al_destroy_bitmap(oldest->image);
+    }
+
+    oldest->image = al_create_bitmap(al_get_text_width(drc_font, text) + 2, al_get_font_line_height(drc_font) + 2);
+    assert(oldest->image != NULL);
+
+    strcpy(oldest->text, text);
+    oldest->last_used = drc_text_clock;
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+
+    al_set_target_bitmap(oldest->image);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    drc_draw_outlined_text(1, 1, text);
+
+    al_restore_state(&state);
+
+    return oldest->image;
 }
 
 void drc_draw_text(int x, int y, const char *text)
 {
     assert(drc_text_init);
 
-    /* Draw the black outline */
-    al_draw_text(drc_font, al_map_rgb(0, 0, 0), (float)(x - 1), (float)y, ALLEGRO_ALIGN_INTEGER, text);
-    al_draw_text(drc_font, al_map_rgb(0, 0, 0), (float)(x + 1), (float)y, ALLEGRO_ALIGN_INTEGER, text);
-    al_draw_text(drc_font, al_map_rgb(0, 0, 0), (float)x, (float)(y - 1), ALLEGRO_ALIGN_INTEGER, text);
-    al_draw_text(drc_font, al_map_rgb(0, 0, 0), (float)x, (float)(y + 1), ALLEGRO_ALIGN_INTEGER, text);
+    if (text[0] == '\0') {
+        return;
+    }
 
-    /* Draw the white text */
-    al_draw_text(drc_font, al_map_rgb(255, 255, 255), (float)x, (float)y, ALLEGRO_ALIGN_INTEGER, text);
+    /* Too long to remember, just draw it */
+    if (strlen(text) >= DRC_TEXT_MAX_LEN) {
+        drc_draw_outlined_text(x, y, text);
+        return;
+    }
+
+    al_draw_bitmap(drc_get_text_image(text), x - 1, y - 1, 0);
 }
 
+void drc_draw_dynamic_text(int x, int y, const char *text)
+{
+    assert(drc_text_init);
+
+    int cell_w = drc_glyph_w + 2;
+    int cell_h = drc_glyph_h + 2;
+    int rows = (DRC_NUM_GLYPHS + DRC_GLYPH_COLS - 1) / DRC_GLYPH_COLS;
+
+    /* Everything comes from the same image, so it can all be sent to the screen at once */
+    al_hold_bitmap_drawing(true);
+
+    /* Borders first, then letters, so a border never covers a letter */
+    for (int half = 0; half < 2; half++) {
+
+        int dx = x - 1;
+
+        for (const char *c = text; *c != '\0'; c++, dx += drc_glyph_w) {
+
+            int i = (unsigned char)*c - DRC_FIRST_GLYPH;
+
+            /* Skip spaces and anything not in the letter sheet */
+            if (i <= 0 || i >= DRC_NUM_GLYPHS) {
+                continue;
+            }
+
+            float sx = (i % DRC_GLYPH_COLS) * cell_w;
+            float sy = ((i / DRC_GLYPH_COLS) * cell_h) + (half * rows * cell_h);
+
+            al_draw_bitmap_region(drc_glyph_sheet, sx, sy, cell_w, cell_h, dx, y - 1, 0);
+        }
+    }
+
+    al_hold_bitmap_drawing(false);
+}
@@ -1,10 +1,32 @@
 #pragma once
 
+/**
+ * The number of different strings that are remembered
+ * by "drc_draw_text". When it's full, the string that
+ * was drawn the longest time ago is forgotten.
+ */
+#define DRC_TEXT_CACHE_SIZE (32)
+
+/* Strings at least this long are drawn without being remembered */
+#define DRC_TEXT_MAX_LEN (128)
+
 bool drc_init_text(void);
 void drc_free_text(void);
 
 /**
  * Draw the text to the screen, white with a black border.
+ *
+ * The bordered text is drawn to an image the first time
+ * and that image is reused after that, so this is best
+ * for text that doesn't change much (like menus).
  */
 void drc_draw_text(int x, int y, const char *text);
 
+/**
+ * Draw the text to the screen, white with a black border.
+ *
+ * Each letter is copied from a set of bordered letters
+ * that was made ahead of time, so this is best for text
+ * that changes all of the time (like a score or timer).
+ */
+void drc_draw_dynamic_text(int x, int y, const char *text);
@@ -0,0 +1,197 @@
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include "drc_memory.h"
+#include "drc_trace.h"
+
+#ifdef DRC_TRACE
+
+typedef struct
+{
+    char name[DRC_TRACE_MAX_NAME];
+    char detail[DRC_TRACE_MAX_NAME];
+
+    /* In microseconds, since tracing started */
+    double start;
+    double duration;
+
+    int tid;
+    int depth;
+} DRC_TRACE_EVENT;
+
+/* A span that has begun but not ended yet */
+typedef struct
+{
+    const char *name;
+    const char *detail;
+    double start;
+} DRC_TRACE_OPEN_SPAN;
+
+/* All of the finished spans, shared by every thread */
+static DRC_TRACE_EVENT *drc_trace_events = NULL;
+static int drc_trace_num_events = 0;
+static int drc_trace_num_dropped = 0;
+static ALLEGRO_MUTEX *drc_trace_mutex = NULL;
+
+static double drc_trace_start_time = 0;
+static int drc_trace_next_tid = 1;
+
+/* Every thread has its own ID and list of open spans */
+static _Thread_local int drc_trace_tid = 0;
+static _Thread_local DRC_TRACE_OPEN_SPAN drc_trace_open[DRC_TRACE_MAX_DEPTH];
+static _Thread_local int drc_trace_depth = 0;
+
+void drc_init_trace(void)
+{
+    if (drc_trace_events != NULL) {
+        return;
+    }
+
+    drc_trace_events = drc_calloc_memory("DRC_TRACE_EVENTS", DRC_TRACE_MAX_EVENTS, sizeof(DRC_TRACE_EVENT));
+    assert(drc_trace_events != NULL);
+
+    drc_trace_mutex = al_create_mutex();
+    assert(drc_trace_mutex != NULL);
+
+    drc_trace_start_time = al_get_time();
+}
+
+void drc_free_trace(void)
+{
+    if (drc_trace_events == NULL) {
+        return;
+    }
+
+    drc_trace_events = drc_free_memory("DRC_TRACE_EVENTS", drc_trace_events);
+    drc_trace_num_events = 0;
+
+    al_destroy_mutex(drc_trace_mutex);
+    drc_trace_mutex = NULL;
+}
+
+void drc_trace_begin(const char *name, const char *detail)
+{
+    if (drc_trace_events == NULL) {
+        return;
+    }
+
+    /* Spans nested too deep still need to be counted, so "end" matches up */
+    if (drc_trace_depth < DRC_TRACE_MAX_DEPTH) {
+        DRC_TRACE_OPEN_SPAN *span = &drc_trace_open[drc_trace_depth];
+        span->name = name;
+        span->detail = detail;
+        span->start = al_get_time();
+    }
+
+    drc_trace_depth++;
+}
+
+void drc_trace_end(void)
+{
+    if (drc_trace_events == NULL) {
+        return;
+    }
+
+    assert(drc_trace_depth > 0);
+
+    double end = al_get_time();
+
+    drc_trace_depth--;
+
+    if (drc_trace_depth >= DRC_TRACE_MAX_DEPTH) {
+        return;
+    }
+
+    DRC_TRACE_OPEN_SPAN *span = &drc_trace_open[drc_trace_depth];
+
+    al_lock_mutex(drc_trace_mutex);
+
+    /* The first time a thread finishes a span, give it an ID */
+    if (drc_trace_tid == 0) {
+        drc_trace_tid = drc_trace_next_tid;
+        drc_trace_next_tid++;
+    }
+
+    if (drc_trace_num_events < DRC_TRACE_MAX_EVENTS) {
+
+        DRC_TRACE_EVENT *event = &drc_trace_events[drc_trace_num_events];
+
+        snprintf(event->name, DRC_TRACE_MAX_NAME, "%s", span->name);
+        snprintf(event->detail, DRC_TRACE_MAX_NAME, "%s", span->detail != NULL ? span->detail : "");
+        event->start = (span->start - drc_trace_start_time) * 1000000.0;
+        event->duration = (end - span->start) * 1000000.0;
+        event->tid = drc_trace_tid;
+        event->depth = drc_trace_depth;
+
+        drc_trace_num_events++;
+
+    } else {
+        drc_trace_num_dropped++;
+    }
+
+    al_unlock_mutex(drc_trace_mutex);
+}
+
+/**
+ * Write a string with any quotes and backslashes escaped,
+ * so it's safe to put in JSON.
+ */
+static void drc_write_json_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if ((unsigned char)*c < 0x20) {
+            fputc(' ', file);
+        } else {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+bool drc_write_trace(const char *filename)
+{
+    if (drc_trace_events == NULL) {
+        return false;
+    }
+
+    FILE *file = fopen(filename, "w");
+
+    if (file == NULL) {
+        fprintf(stderr, "TRACE: Failed to open \"%s\".\n", filename);
+        return false;
+    }
+
+    al_lock_mutex(drc_trace_mutex);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for (int i = 0; i < drc_trace_num_events; i++) {
+
+        DRC_TRACE_EVENT *event = &drc_trace_events[i];
+
+        fprintf(file, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":", event->tid, event->start, event->duration);
+        drc_write_json_string(file, event->name);
+        fprintf(file, ",\"args\":{\"depth\":%d,\"detail\":", event->depth);
+        drc_write_json_string(file, event->detail);
+        fprintf(file, "}}%s\n", i < drc_trace_num_events - 1 ? "," : "");
+    }
+
+    fprintf(file, "]}\n");
+
+    if (drc_trace_num_dropped > 0) {
+        fprintf(stderr, "TRACE: Dropped %d spans, try increasing DRC_TRACE_MAX_EVENTS.\n", drc_trace_num_dropped);
+    }
+
+    al_unlock_mutex(drc_trace_mutex);
+
+    fclose(file);
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * Record spans of time (loading a room, decoding an image,
+ * drawing a frame...) and save them as a Chrome trace file.
+ * Open the file in Perfetto (https://ui.perfetto.dev) or
+ * "chrome://tracing" to see exactly when everything happened.
+ *
+ * Tracing is compiled out unless DRC_TRACE is defined
+ * (use "./configure --enable-trace"). Use the macros below
+ * so that the calls disappear completely in a normal build.
+ *
+ * Spans can be nested, and every thread keeps track of
+ * its own spans.
+ */
+
+/* The most spans that will be remembered, the rest are dropped */
+#define DRC_TRACE_MAX_EVENTS (65536)
+
+/* The longest span name or detail, anything longer is cut off */
+#define DRC_TRACE_MAX_NAME (48)
+
+/* The most spans that can be nested inside each other on one thread */
+#define DRC_TRACE_MAX_DEPTH (32)
+
+#ifdef DRC_TRACE
+
+/**
+ * Use this once, after Allegro is initialized,
+ * before any other trace functions.
+ */
+void drc_init_trace(void);
+void drc_free_trace(void);
+
+/**
+ * Start and end a span. Every "begin" needs a matching "end",
+ * on the same thread. The "detail" is extra information shown
+ * with the span (such as a filename), it can be NULL. Both
+ * strings need to stay around until the span ends.
+ */
+void drc_trace_begin(const char *name, const char *detail);
+void drc_trace_end(void);
+
+/**
+ * Save everything that has been recorded to a
+ * Chrome trace JSON file. Returns true on success.
+ */
+bool drc_write_trace(const char *filename);
+
+#define DRC_INIT_TRACE() drc_init_trace()
+#define DRC_FREE_TRACE() drc_free_trace()
+#define DRC_TRACE_BEGIN(name, detail) drc_trace_begin(name, detail)
+#define DRC_TRACE_END() drc_trace_end()
+#define DRC_WRITE_TRACE(filename) drc_write_trace(filename)
+
+#else
+
+#define DRC_INIT_TRACE() ((void)0)
+#define DRC_FREE_TRACE() ((void)0)
+#define DRC_TRACE_BEGIN(name, detail) ((void)0)
+#define DRC_TRACE_END() ((void)0)
+#define DRC_WRITE_TRACE(filename) ((void)0)
+
+#endif
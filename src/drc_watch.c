@@ -0,0 +1,261 @@
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
+#include "drc_watch.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define DRC_WATCH_START_SIZE (64)
+#define DRC_MAX_WATCH_DIR_LEN (256)
+
+typedef struct
+{
+    char *fullpath;
+
+    /* The filename, after the directory in "fullpath" */
+    const char *name;
+
+    /* The directory being watched for it, with inotify */
+    int dir;
+
+    /* When it last changed, when checking every file */
+    time_t mtime;
+
+    bool changed;
+} DRC_WATCHED_FILE;
+
+static DRC_WATCHED_FILE *drc_watched_files = NULL;
+static int drc_num_watched_files = 0;
+static int drc_watched_files_size = 0;
+
+static bool drc_watching = false;
+static ALLEGRO_MUTEX *drc_watch_mutex = NULL;
+
+/* The last time every file was checked */
+static double drc_last_poll_time = 0;
+
+#ifdef __linux__
+static int drc_inotify_fd = -1;
+#endif
+
+static time_t drc_get_file_mtime(const char *fullpath)
+{
+    ALLEGRO_FS_ENTRY *entry = al_create_fs_entry(fullpath);
+    time_t mtime = al_get_fs_entry_mtime(entry);
+    al_destroy_fs_entry(entry);
+
+    return mtime;
+}
+
+void drc_start_watching(void)
+{
+    if (drc_watching) {
+        return;
+    }
+
+    drc_watch_mutex = al_create_mutex();
+    assert(drc_watch_mutex != NULL);
+
+#ifdef __linux__
+    drc_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (drc_inotify_fd < 0) {
+        fprintf(stderr, "WATCH: Failed to start inotify, checking every %.1f seconds instead.\n", DRC_WATCH_POLL_TIME);
+    }
+#endif
+
+    drc_last_poll_time = al_get_time();
+    drc_watching = true;
+}
+
+void drc_stop_watching(void)
+{
+    if (!drc_watching) {
+        return;
+    }
+
+#ifdef __linux__
+    if (drc_inotify_fd >= 0) {
+        close(drc_inotify_fd);
+        drc_inotify_fd = -1;
+    }
+#endif
+
+    if (drc_watched_files != NULL) {
+        drc_watched_files = drc_free_memory("DRC_WATCHED_FILES", drc_watched_files);
+    }
+
+    drc_num_watched_files = 0;
+    drc_watched_files_size = 0;
+
+    al_destroy_mutex(drc_watch_mutex);
+    drc_watch_mutex = NULL;
+
+    drc_watching = false;
+}
+
+bool drc_is_watching(void)
+{
+    return drc_watching;
+}
+
+static void drc_grow_watched_files(void)
+{
+    int size = drc_watched_files_size > 0 ? drc_watched_files_size * 2 : DRC_WATCH_START_SIZE;
+
+    DRC_WATCHED_FILE *files = drc_calloc_memory("DRC_WATCHED_FILES", size, sizeof(DRC_WATCHED_FILE));
+    assert(files != NULL);
+
+    if (drc_watched_files != NULL) {
+        memcpy(files, drc_watched_files, drc_num_watched_files * sizeof(DRC_WATCHED_FILE));
+        drc_free_memory("DRC_WATCHED_FILES", drc_watched_files);
+    }
+
+    drc_watched_files = files;
+    drc_watched_files_size = size;
+}
+
+void drc_watch_file(const char *fullpath)
+{
+    if (!drc_watching) {
+        return;
+    }
+
+    al_lock_mutex(drc_watch_mutex);
+
+    for (int i = 0; i < drc_num_watched_files; i++) {
+        if (strcmp(drc_watched_files[i].fullpath, fullpath) == 0) {
+            al_unlock_mutex(drc_watch_mutex);
+            return;
+        }
+    }
+
+    if (drc_num_watched_files >= drc_watched_files_size) {
+        drc_grow_watched_files();
+    }
+
+    DRC_WATCHED_FILE *file = &drc_watched_files[drc_num_watched_files];
+
+    file->fullpath = drc_arena_copy_string(drc_get_global_arena(), "DRC_WATCHED_FILE->fullpath", fullpath);
+
+    const char *slash = strrchr(file->fullpath, '/');
+    file->name = slash != NULL ? slash + 1 : file->fullpath;
+    file->dir = -1;
+    file->mtime = drc_get_file_mtime(fullpath);
+    file->changed = false;
+
+#ifdef __linux__
+    if (drc_inotify_fd >= 0) {
+
+        /**
+         * Editors often save a new file and rename it over the old
+         * one, so the directory is watched instead of the file.
+         * Watching the same directory again gives the same number.
+         */
+        char dir[DRC_MAX_WATCH_DIR_LEN];
+        if (slash != NULL) {
+            snprintf(dir, DRC_MAX_WATCH_DIR_LEN, "%.*s", (int)(slash - file->fullpath) + 1, file->fullpath);
+        } else {
+            snprintf(dir, DRC_MAX_WATCH_DIR_LEN, "./");
+        }
+
+        file->dir = inotify_add_watch(drc_inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (file->dir < 0) {
+            fprintf(stderr, "WATCH: Failed to watch \"%s\".\n", dir);
+        }
+    }
+#endif
+
+    drc_num_watched_files++;
+
+    al_unlock_mutex(drc_watch_mutex);
+}
+
+#ifdef __linux__
+static void drc_read_inotify_events(void)
+{
+    /* Big enough for a lot of events at once, they're lined up the same as the struct */
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read(drc_inotify_fd, buffer, sizeof(buffer))) > 0) {
+
+        for (char *pos = buffer; pos < buffer + len; pos += sizeof(struct inotify_event) + ((struct inotify_event *)pos)->len) {
+
+            struct inotify_event *event = (struct inotify_event *)pos;
+
+            if (event->len == 0) {
+                continue;
+            }
+
+            for (int i = 0; i < drc_num_watched_files; i++) {
+                if (drc_watched_files[i].dir == event->wd && strcmp(drc_watched_files[i].name, event->name) == 0) {
+                    drc_watched_files[i].changed = true;
+                }
+            }
+        }
+    }
+}
+#endif
+
+static void drc_poll_watched_files(void)
+{
+    double now = al_get_time();
+
+    if (now - drc_last_poll_time < DRC_WATCH_POLL_TIME) {
+        return;
+    }
+
+    drc_last_poll_time = now;
+
+    for (int i = 0; i < drc_num_watched_files; i++) {
+
+        DRC_WATCHED_FILE *file = &drc_watched_files[i];
+
+        /* Files that inotify is watching don't need to be checked */
+        if (file->dir >= 0) {
+            continue;
+        }
+
+        time_t mtime = drc_get_file_mtime(file->fullpath);
+
+        if (mtime != file->mtime) {
+            file->mtime = mtime;
+            file->changed = true;
+        }
+    }
+}
+
+bool drc_next_changed_file(char *fullpath, int size)
+{
+    if (!drc_watching) {
+        return false;
+    }
+
+    al_lock_mutex(drc_watch_mutex);
+
+#ifdef __linux__
+    if (drc_inotify_fd >= 0) {
+        drc_read_inotify_events();
+    }
+#endif
+
+    drc_poll_watched_files();
+
+    for (int i = 0; i < drc_num_watched_files; i++) {
+        if (drc_watched_files[i].changed) {
+            drc_watched_files[i].changed = false;
+            fullpath[0] = '\0';
+            strncat(fullpath, drc_watched_files[i].fullpath, size - 1);
+            al_unlock_mutex(drc_watch_mutex);
+            return true;
+        }
+    }
+
+    al_unlock_mutex(drc_watch_mutex);
+
+    return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * Watch files for changes while the game is running,
+ * so they can be loaded again without restarting.
+ *
+ * Only files that are asked to be watched are watched. On Linux
+ * the operating system says when a file changes ("inotify"),
+ * everywhere else every file is checked every DRC_WATCH_POLL_TIME
+ * seconds to see if it changed.
+ *
+ * Nothing is watched until "drc_start_watching" is called,
+ * so asking to watch a file is free when it isn't needed.
+ */
+
+/* How often files are checked, when the operating system can't tell us */
+#define DRC_WATCH_POLL_TIME (0.5)
+
+/**
+ * Start watching files. Call this before any threads
+ * start, files can be watched from any thread after.
+ */
+void drc_start_watching(void);
+
+/* Stop watching files and forget all of them */
+void drc_stop_watching(void);
+
+bool drc_is_watching(void);
+
+/**
+ * Watch a file for changes, using the full path to it.
+ * Does nothing if it's already watched, or if
+ * "drc_start_watching" hasn't been called.
+ */
+void drc_watch_file(const char *fullpath);
+
+/**
+ * Returns true and puts the full path of a file in "fullpath"
+ * if it changed since the last time. Call it until it returns
+ * false to find every file that changed. It doesn't wait.
+ */
+bool drc_next_changed_file(char *fullpath, int size);
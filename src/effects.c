@@ -94,11 +94,20 @@ void load_poof_effect(float x, float y)
         return;
     }
 
-    drc_init_sprite(&effect->sprite, false, 15);
-    drc_add_frame(&effect->sprite, DRC_IMG("effect-poof-1.png"));
-    drc_add_frame(&effect->sprite, DRC_IMG("effect-poof-2.png"));
-    drc_add_frame(&effect->sprite, DRC_IMG("effect-poof-3.png"));
-    drc_add_frame(&effect->sprite, DRC_IMG("effect-poof-4.png"));
+    /* Made the first time, every poof after that shares it */
+    static const DRC_ANIMATION *poof_animation = NULL;
+
+    if (poof_animation == NULL) {
+        ALLEGRO_BITMAP *frames[] = {
+            DRC_IMG("effect-poof-1.png"),
+            DRC_IMG("effect-poof-2.png"),
+            DRC_IMG("effect-poof-3.png"),
+            DRC_IMG("effect-poof-4.png")
+        };
+        poof_animation = drc_get_animation(frames, 4, 15, false);
+    }
+
+    drc_init_sprite_with_animation(&effect->sprite, poof_animation);
     effect->sprite.x_offset = -10;
     effect->sprite.y_offset = -10;
     effect->x = x;
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
 #include "gamedata.h"
 
 void init_hero(HERO *hero)
@@ -19,6 +21,9 @@ void init_hero(HERO *hero)
     hero->body.dx = 0;
     hero->body.dy = 0;
 
+    hero->body.old_x = hero->body.x;
+    hero->body.old_y = hero->body.y;
+
     hero->u = false;
     hero->d = false;
     hero->l = false;
@@ -51,8 +56,13 @@ void init_enemy(ENEMY *enemy)
     enemy->body.h = 0;
     enemy->body.dx = 0;
     enemy->body.dy = 0;
+    enemy->body.old_x = 0;
+    enemy->body.old_y = 0;
     enemy->speed = 0;
     enemy->dist = 0;
+    enemy->node = 0;
+    enemy->heading = NO_DIRECTION;
+    enemy->to_go = 0;
     enemy->update = NULL;
 }
 
@@ -66,15 +76,40 @@ static void init_enemy_definition(ENEMY_DEFINITION *enemy_def)
     enemy_def->dist = 0;
 }
 
+void init_texture_def(TEXTURE_DEF *texture_def, int speed)
+{
+    for (int i = 0; i < MAX_FRAMES; i++) {
+        texture_def->frames[i] = NO_NAME;
+    }
+    texture_def->len = 0;
+    texture_def->speed = speed;
+    texture_def->loop = false;
+}
+
+void free_room(ROOM *room)
+{
+    /* They're in the room arena, which is reset when the next room is finished loading */
+    room->tiles = NULL;
+    room->blocks = NULL;
+}
+
 void init_room(ROOM *room)
 {
     if (room == NULL) {
         return;
     }
 
+    free_room(room);
+
     /* Title */
     strncpy(room->title, "", MAX_STRING_SIZE);
 
+    /* Music */
+    strncpy(room->music, "", MAX_STRING_SIZE);
+
+    /* Imports */
+    room->num_imports = 0;
+
     /* Size */
     room->rows = MAX_ROOM_ROWS;
     room->cols = MAX_ROOM_COLS;
@@ -87,39 +122,22 @@ void init_room(ROOM *room)
     room->facing = RIGHT;
     
     /* Tile list */
-    for (int i = 0; i < MAX_TILES; i++) {
-        drc_init_sprite(&room->tiles[i], false, 0);
-    }
+    /* Each tile definition is initialized when it's added */
     room->num_tiles = 0;
 
     /* Background map */
     /* Foreground map */
     /* Collision map */
     /* Block map */
-    for (int i = 0; i < MAX_ROOM_SIZE; i++) {
-        room->farground_map[i] = NO_TILE;
-        room->background_map[i] = NO_TILE;
-        room->foreground_map[i] = NO_TILE;
-        room->collision_map[i] = NO_COLLISION;
-        room->block_map[i] = NO_BLOCK;
-        room->block_map_orig[i] = NO_BLOCK;
-    }
+    memset(room->farground_map, NO_TILE, sizeof(room->farground_map));
+    memset(room->background_map, NO_TILE, sizeof(room->background_map));
+    memset(room->foreground_map, NO_TILE, sizeof(room->foreground_map));
+    memset(room->collision_map, NO_COLLISION, sizeof(room->collision_map));
+    memset(room->block_map, NO_BLOCK, sizeof(room->block_map));
+    memset(room->block_map_orig, NO_BLOCK, sizeof(room->block_map_orig));
 
     /* Texture list */
-    /* Block list */
-    for (int i = 0; i < MAX_TEXTURES; i++) {
-        //strncpy(room->textures[i], "", MAX_FILENAME_LEN);
-        for (int j = 0; j < MAX_FRAMES; j++) {
-            strncpy(room->texture_defs[i].frames[i], "", MAX_FILENAME_LEN);;
-        }
-        room->texture_defs[i].len = 0;
-        room->texture_defs[i].speed = 1;
-        //drc_init_sprite(&room->texture_anims[i], false, 0);
-
-        drc_init_sprite(&room->blocks[i], false, 0);
-    }
-    //room->num_textures = 0;
-    //room->num_texture_anims = 0;
+    /* Each texture definition is initialized when it's added */
     room->num_texture_defs = 0;
 
     /* Enemy definitions */
@@ -130,8 +148,8 @@ void init_room(ROOM *room)
     room->cleared = false;
 
     /* Exits */
+    /* The door image is added when the room is loaded */
     drc_init_sprite(&room->door_sprite, false, 0);
-    drc_add_frame(&room->door_sprite, DRC_IMG("tile-door.png"));
     room->last_cleared_x = 0;
     room->last_cleared_y = 0;
 
@@ -152,6 +170,8 @@ void init_screenshot(SCREENSHOT *screenshot)
     screenshot->y = 0;
     screenshot->dx = 0;
     screenshot->dy = 0;
+    screenshot->old_x = 0;
+    screenshot->old_y = 0;
     screenshot->direction = NO_DIRECTION;
 }
 
@@ -167,6 +187,8 @@ void init_powerup(POWERUP *powerup)
     powerup->body.h = 0;
     powerup->body.dx = 0;
     powerup->body.dy = 0;
+    powerup->body.old_x = 0;
+    powerup->body.old_y = 0;
 
     powerup->type = UNDEFINED_TYPE;
     powerup->subtype = UNDEFINED_TYPE;
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
 #include "drc_sprite.h"
 #include "direction.h"
+#include "names.h"
 
 #define TILE_SIZE (20)
 #define COLS (16)
@@ -25,8 +27,8 @@
 #define MAX_POWERUPS (16)
 #define MAX_TILES (128)
 #define MAX_TEXTURES (128)
-#define MAX_ROOMS (64)
 #define MAX_STRING_SIZE (128)
+#define MAX_IMPORTS (8)
 
 #define POWERUP_SPEED (TILE_SIZE)
 
@@ -48,7 +50,9 @@ typedef enum
     ENEMY_TYPE_DIAGONAL,
     ENEMY_TYPE_TRACER,
     ENEMY_TYPE_SNEAK,
-    ENEMY_TYPE_BLOCKER
+    ENEMY_TYPE_BLOCKER,
+    ENEMY_TYPE_CHASER,
+    NUM_ENEMY_TYPES
 } ENEMY_TYPE;
 
 typedef enum
@@ -85,6 +89,10 @@ typedef struct
     int h;   /* Height */
     int dx;  /* Horizontal velocity, in pixels per second */
     int dy;  /* Vertical velocity */
+
+    /* The position before the last update, used to draw smoothly between updates */
+    float old_x;
+    float old_y;
 } BODY;
 
 /**
@@ -115,6 +123,10 @@ typedef struct
     int dx;
     int dy;
 
+    /* The position before the last update */
+    float old_x;
+    float old_y;
+
     DIRECTION direction;
 
 } SCREENSHOT;
@@ -185,6 +197,16 @@ typedef struct ENEMY
     int speed; /* In PPS */
     int dist; /* In pixels, how far to travel before turning around, -1 to bounce */
 
+    /**
+     * Enemies that follow the walls or chase the hero go
+     * from spot to spot (see "contour.h" and "path.h").
+     * This is the spot it's going to, which way it's going,
+     * and how many pixels are left until it gets there.
+     */
+    int node;
+    DIRECTION heading;
+    float to_go;
+
     void (*update)(struct ENEMY *enemy, void *data);
 } ENEMY;
 
@@ -210,20 +232,44 @@ typedef struct
 
 /**
  * Used to define a texture, which will be used to create
- * the image on a block and a bullet.
+ * the image on a block and a bullet. Tiles are defined
+ * the same way.
  */
 typedef struct
 {
-    char frames[MAX_FRAMES][MAX_FILENAME_LEN];
+    /* The name of the image for each frame, see "names.h" */
+    NAME_ID frames[MAX_FRAMES];
     int len;
     int speed;
+    bool loop;
 } TEXTURE_DEF;
 
+/**
+ * One spot in one of the maps of a room.
+ * Every tile and texture number has to fit in one.
+ */
+typedef int8_t ROOM_CELL;
+
+_Static_assert(MAX_TILES <= INT8_MAX + 1 && MAX_TEXTURES <= INT8_MAX + 1, "Tile and texture numbers must fit in a ROOM_CELL");
+
 typedef struct
 {
     /* Name of the room */
     char title[MAX_STRING_SIZE];
 
+    /**
+     * The music for the room (see "drc_music.h"). If there
+     * isn't any, the music from the last room keeps playing.
+     */
+    char music[MAX_STRING_SIZE];
+
+    /**
+     * The files that the room IMPORTs (and the files that they
+     * import), to know if a compiled room is older than any of them.
+     */
+    NAME_ID imports[MAX_IMPORTS];
+    int num_imports;
+
     /* Size of the room */
     int rows;
     int cols;
@@ -241,20 +287,23 @@ typedef struct
 
     /* List of tiles used in the room */
     /* Tiles define the play area */
-    DRC_SPRITE tiles[MAX_TILES];
+    TEXTURE_DEF tile_defs[MAX_TILES];
     int num_tiles;
 
+    /* One for each tile, made when the room is finished loading */
+    DRC_SPRITE *tiles;
+
     /* The farground is drawn below everything else, and never "scrolls" */
     /* Each entry is an index number for the list of tiles */
-    int farground_map[MAX_ROOM_SIZE];
+    ROOM_CELL farground_map[MAX_ROOM_SIZE];
 
     /* The background is drawn behind the foreground */
     /* Each entry is an index number for the list of tiles */
-    int background_map[MAX_ROOM_SIZE];
+    ROOM_CELL background_map[MAX_ROOM_SIZE];
 
     /* The foreground is what the hero interacts with */
     /* Each entry is an index number for the list of tiles */
-    int foreground_map[MAX_ROOM_SIZE];
+    ROOM_CELL foreground_map[MAX_ROOM_SIZE];
 
     /**
      * Collision detection map for the hero and bullets.
@@ -264,7 +313,7 @@ typedef struct
      * The collision map is optional, if it isn't defined
      * then the foreground map wil be used instead.
      */
-    int collision_map[MAX_ROOM_SIZE];
+    ROOM_CELL collision_map[MAX_ROOM_SIZE];
 
     /* List of textures used to make blocks and bullets in the level */
     //char textures[MAX_TEXTURES][MAX_FILENAME_LEN];
@@ -277,14 +326,15 @@ typedef struct
     int num_texture_defs;
 
     /* Blocks, that can be destroyed by the hero */
-    DRC_SPRITE blocks[MAX_TEXTURES];
+    /* One for each texture, made when the room is finished loading */
+    DRC_SPRITE *blocks;
 
     /* The position of blocks */
     /* Each entry is an index number for the list of blocks */
-    int block_map[MAX_ROOM_SIZE];
+    ROOM_CELL block_map[MAX_ROOM_SIZE];
 
     /* Same as above, but this stores the original state of the room blocks */
-    int block_map_orig[MAX_ROOM_SIZE];
+    ROOM_CELL block_map_orig[MAX_ROOM_SIZE];
 
     /* This info is used to create the enemies when the level starts */
     ENEMY_DEFINITION enemy_definitions[MAX_ENEMIES];
@@ -308,9 +358,23 @@ void init_hero(HERO *hero);
 /* Initialize an enemy to its default state */
 void init_enemy(ENEMY *enemy);
 
-/* Initialize a room to its default, empty state */
+/**
+ * Initialize a room to its default, empty state.
+ * This also frees the tile and block sprites from the last
+ * room, so a room has to start out zeroed (such as a static
+ * variable) the first time.
+ */
 void init_room(ROOM *room);
 
+/* Forget the tile and block sprites, when done with a room (see "finish_loading_room") */
+void free_room(ROOM *room);
+
+/**
+ * Initialize a tile or texture definition when it's added
+ * to a room. Tiles have a speed of 0 and textures 1.
+ */
+void init_texture_def(TEXTURE_DEF *texture_def, int speed);
+
 /* Initialize a powerup to its default state */
 void init_powerup(POWERUP *powerup);
 
@@ -1,16 +1,29 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "archetype.h"
 #include "compiler.h"
+#include "contour.h"
 #include "datafile.h"
 #include "drc_collision.h"
 #include "drc_display.h"
+#include "drc_memory.h"
+#include "drc_music.h"
+#include "drc_profile.h"
 #include "drc_random.h"
 #include "drc_run.h"
 #include "drc_sound.h"
 #include "drc_sprite.h"
+#include "drc_trace.h"
+#include "drc_watch.h"
 #include "effects.h"
 #include "gameplay.h"
 #include "mask.h"
 #include "path.h"
+#include "preload.h"
+#include "roombundle.h"
+#include "tmxfile.h"
 
 static const int HERO_SPEED = TILE_SIZE * 4;
 
@@ -30,6 +43,8 @@ static bool update_gameplay_playing();
 static bool update_gameplay_dying();
 static void draw_gameplay_playing();
 static void draw_gameplay_scrolling_rooms();
+static void draw_room_objects();
+static void load_gameplay_enemy_archetypes();
 static void control_gameplay_options(ALLEGRO_EVENT *event);
 static void control_gameplay_playing(ALLEGRO_EVENT *event);
 
@@ -58,7 +73,21 @@ static int curr_room = 0;
 /* The primary gameplay characters! */
 static ROOM room;
 static HERO hero;
+
+/* The surfaces in the room, for enemies that follow them */
+static CONTOUR_GRAPH contours;
+
+/**
+ * The way to the hero, shared by every enemy that chases
+ * the hero. It's only found again when the hero moves to
+ * another spot, or the blocks change.
+ */
+static FLOW_FIELD hero_flow_field;
+static bool is_hero_flow_field_stale = true;
 static ENEMY enemies[MAX_ENEMIES];
+
+/* Read once, an enemy is made by copying the one for its type */
+static ENEMY_ARCHETYPE enemy_archetypes[NUM_ENEMY_TYPES];
 static BULLET bullets[MAX_BULLETS];
 static POWERUP powerups[MAX_POWERUPS];
 static DRC_SPRITE powerup_dot;
@@ -73,6 +102,47 @@ static GAMEPLAY_DIFFICULTY gameplay_difficulty = GAMEPLAY_DIFFICULTY_EASY;
 static SCREENSHOT screenshot1;
 static SCREENSHOT screenshot2;
 
+/**
+ * The parts of the room that never change (the farground,
+ * background and foreground tiles) are drawn once to these
+ * layers, and then each layer is drawn to the screen in one go.
+ * There are two of each that take turns, one for the current
+ * room and one for the next room while they scroll.
+ */
+static ALLEGRO_BITMAP *farground_layers[2] = {NULL, NULL};
+static ALLEGRO_BITMAP *scenery_layers[2] = {NULL, NULL};
+static int curr_layer = 0;
+
+/**
+ * While the rooms scroll, the next room is loaded one step
+ * at a time, one step each update, so that no update takes
+ * too long. Then it's drawn to its layers a few rows (or
+ * columns) at a time.
+ */
+typedef enum
+{
+    NEXT_ROOM_READ = 0,   /* Read the data for the room */
+    NEXT_ROOM_FINISH,     /* Get its images ready */
+    NEXT_ROOM_START,      /* Put the blocks, enemies and hero in it */
+    NEXT_ROOM_LOADED
+} NEXT_ROOM_STEP;
+
+#define LAYER_STRIPS_PER_UPDATE (2)
+static NEXT_ROOM_STEP next_room_step = NEXT_ROOM_LOADED;
+static bool next_room_read = false;
+static int num_layer_strips_drawn = 0;
+static bool next_room_layers_done = true;
+
+/**
+ * Where the hero comes into the next room, once it's loaded.
+ * It's figured out before the rooms start scrolling.
+ */
+static float hero_entering_x = 0;
+static float hero_entering_y = 0;
+
+/* The music changes while the rooms scroll, which takes about a second */
+#define MUSIC_FADE_SECS (1.0)
+
 /* The number of blocks the hero needs to destroy before a powerup appears */
 #define RESET_POWERUP_COUNTER (-1)
 static int blocks_until_powerup_appears = RESET_POWERUP_COUNTER;
@@ -86,12 +156,47 @@ static int next_powerup_type = POWERUP_TYPE_NONE;
  * All velocity values (dx, dy...) are stored as "int" values,
  * as "Pixels Per Second". Use this to convert it to "Frames
  * Per Second" before adding it to the sprite's location.
+ *
+ * Every update is exactly one tick long (see "drc_run"),
+ * no matter how often the screen is drawn.
  */
 static float convert_pps_to_fps(int pps)
 {
     return pps / (float)(drc_get_fps());
 }
 
+/**
+ * Remember where a body is before it gets updated,
+ * so it can be drawn smoothly between updates.
+ */
+static void save_body_position(BODY *body)
+{
+    body->old_x = body->x;
+    body->old_y = body->y;
+}
+
+/**
+ * Move a body straight to a new position.
+ * It won't be drawn sliding over from where it used to be.
+ */
+static void place_body(BODY *body, float x, float y)
+{
+    body->x = x;
+    body->y = y;
+    save_body_position(body);
+}
+
+/* Where to draw a body, somewhere between its old and current position */
+static float get_draw_x(BODY *body)
+{
+    return body->old_x + ((body->x - body->old_x) * drc_get_interpolation());
+}
+
+static float get_draw_y(BODY *body)
+{
+    return body->old_y + ((body->y - body->old_y) * drc_get_interpolation());
+}
+
 static bool is_offscreen(BODY *body, DRC_SPRITE *sprite)
 {
     int room_w = room.cols * TILE_SIZE;
@@ -228,7 +333,7 @@ static int get_next_bullet_texture(void)
      * possible to hit.
      */
 
-    int textures[MAX_TEXTURES];
+    int *textures = drc_alloc_frame_memory("BULLET_TEXTURES", MAX_TEXTURES * sizeof(int));
     int num_textures = 0;
 
     for (int i = 0; i < MAX_TEXTURES; i++) {
@@ -238,6 +343,15 @@ static int get_next_bullet_texture(void)
     /* Find the position of the hero in rows / cols */
     int hero_row = ((int)hero.body.y  + 7) / TILE_SIZE;
     int hero_col = ((int)hero.body.x  + 7) / TILE_SIZE;
+
+    /**
+     * Everywhere the hero can get to right now. It's the same
+     * as checking for a path from the hero to each block, but
+     * the room is only searched once.
+     */
+    bool *reachable = drc_alloc_frame_memory("BULLET_REACHABLE", MAX_ROOM_SIZE * sizeof(bool));
+    int *points = drc_alloc_frame_memory("BULLET_REACHABLE_POINTS", MAX_ROOM_SIZE * sizeof(int));
+    find_reachable_points(&room, hero_row, hero_col, reachable, points);
  
     /* Create a list of blocks that are available to hit */
     for (int r = 0; r < room.rows; r++) {
@@ -254,7 +368,11 @@ static int get_next_bullet_texture(void)
                 int dest_row = r - directions[room.direction].v_offset;
                 int dest_col = c - directions[room.direction].h_offset;
 
-                if (!is_path_between_points(&room, hero_row, hero_col, dest_row, dest_col)) {
+                if (dest_row < 0 || dest_row >= room.rows || dest_col < 0 || dest_col >= room.cols) {
+                    continue;
+                }
+
+                if (!reachable[(dest_row * room.cols) + dest_col]) {
                     continue;
                 }
 
@@ -308,7 +426,7 @@ static bool room_has_exits(void)
     return false;
 }
 
-static ALLEGRO_BITMAP *get_hero_bullet_image(char *texture_name, int hero_type, int frame)
+static ALLEGRO_BITMAP *get_hero_bullet_image(const char *texture_name, int hero_type, int frame)
 {
     /**
      * Return an image of the hero's bullet based on
@@ -324,38 +442,26 @@ static ALLEGRO_BITMAP *get_hero_bullet_image(char *texture_name, int hero_type,
 
 static void load_hero_bullet_sprite(DRC_SPRITE *sprite, int texture, int hero_type)
 {
+    ALLEGRO_BITMAP *frames[MAX_FRAMES];
+    char name[MAX_STRING_SIZE];
+
     if (hero.powerup_type == POWERUP_TYPE_FLASHING) {
-        drc_init_sprite(sprite, true, 12);
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,0", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,1", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,2", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,3", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,4", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,5", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,0", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,1", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,2", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,3", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,4", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-strobe.png:20x20:0,5", hero_type, 1));
+        /* The strobe goes around twice */
+        for (int i = 0; i < 12; i++) {
+            snprintf(name, MAX_STRING_SIZE, "texture-strobe.png:20x20:0,%d", i % 6);
+            frames[i] = get_hero_bullet_image(name, hero_type, (i % 6) < 3 ? 0 : 1);
+        }
+        drc_init_sprite_with_animation(sprite, drc_get_animation(frames, 12, 12, true));
     } else if (hero.powerup_type == POWERUP_TYPE_LASER) {
-        drc_init_sprite(sprite, true, 12);
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,0", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,1", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,2", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,3", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,4", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,5", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,6", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,7", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,8", hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,9", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,10", hero_type, 1));
-        drc_add_frame(sprite, get_hero_bullet_image("texture-laser.png:20x20:0,11", hero_type, 1));
+        for (int i = 0; i < 12; i++) {
+            snprintf(name, MAX_STRING_SIZE, "texture-laser.png:20x20:0,%d", i);
+            frames[i] = get_hero_bullet_image(name, hero_type, (i % 6) < 3 ? 0 : 1);
+        }
+        drc_init_sprite_with_animation(sprite, drc_get_animation(frames, 12, 12, true));
     } else {
-        drc_init_sprite(sprite, true, 4);
-        drc_add_frame(sprite, get_hero_bullet_image(room.texture_defs[texture].frames[0], hero_type, 0));
-        drc_add_frame(sprite, get_hero_bullet_image(room.texture_defs[texture].frames[0], hero_type, 1));
+        frames[0] = get_hero_bullet_image(get_name(room.texture_defs[texture].frames[0]), hero_type, 0);
+        frames[1] = get_hero_bullet_image(get_name(room.texture_defs[texture].frames[0]), hero_type, 1);
+        drc_init_sprite_with_animation(sprite, drc_get_animation(frames, 2, 4, true));
     }
 
     sprite->x_offset = -5;
@@ -403,7 +509,7 @@ static POWERUP *find_available_powerup(void)
 
 static void draw_powerup(POWERUP *powerup)
 {
-    drc_draw_sprite(&powerup->sprite, powerup->body.x, powerup->body.y);
+    drc_draw_sprite(&powerup->sprite, get_draw_x(&powerup->body), get_draw_y(&powerup->body));
 }
 
 static void load_powerup(float x, float y)
@@ -437,8 +543,7 @@ static void load_powerup(float x, float y)
         drc_add_frame(&powerup->sprite, STACKED_IMG("texture-laser.png:20x20:0,10", "powerup-frame-1.png"));
         drc_add_frame(&powerup->sprite, STACKED_IMG("texture-laser.png:20x20:0,11", "powerup-frame-2.png"));
     }
-    powerup->body.x = x;
-    powerup->body.y = y;
+    place_body(&powerup->body, x, y);
     powerup->body.w = 20;
     powerup->body.h = 20;
     powerup->draw = draw_powerup;
@@ -549,17 +654,15 @@ static void init_bullets(void)
     }
 }
 
-static void load_screenshot(SCREENSHOT *screenshot, const char *name)
+static ALLEGRO_BITMAP *load_layer(const char *name)
 {
-    init_screenshot(screenshot);
-
     ALLEGRO_BITMAP *canvas = al_create_bitmap(drc_get_display_width(), drc_get_display_height());
     assert(canvas);
 
     drc_insert_image_resource(name, canvas);
     drc_lock_resource(name);
 
-    drc_add_frame(&screenshot->sprite, DRC_IMG(name));
+    return DRC_IMG(name);
 }
 
 static void init_enemies(void)
@@ -581,6 +684,7 @@ void init_gameplay(void)
     init_bullets();
 
     /* Enemies */
+    load_gameplay_enemy_archetypes();
     init_enemies();
 
     /* Powerups */
@@ -590,14 +694,28 @@ void init_gameplay(void)
     init_room_list(&room_list);
     curr_room = 0;
 
-    /* Screenshots */
-    load_screenshot(&screenshot1, "screenshot1");
-    load_screenshot(&screenshot2, "screenshot2");
+    /* Room layers */
+    farground_layers[0] = load_layer("farground-layer-1");
+    farground_layers[1] = load_layer("farground-layer-2");
+    scenery_layers[0] = load_layer("scenery-layer-1");
+    scenery_layers[1] = load_layer("scenery-layer-2");
+    curr_layer = 0;
+
+    /* Screenshots, they show the scenery layers while the rooms scroll */
+    init_screenshot(&screenshot1);
+    init_screenshot(&screenshot2);
 
     /* Init powerup dots */
     drc_init_sprite(&powerup_dot, false, 0);
     drc_add_frame(&powerup_dot, DRC_IMG("powerup-dot.png"));
 
+    /* Dying and clearing a room should always be heard, blocks and bullets less so */
+    drc_set_sound_priority(DRC_SND("hero-die.wav"), DRC_SOUND_PRIORITY_HIGH);
+    drc_set_sound_priority(DRC_SND("room-cleared.wav"), DRC_SOUND_PRIORITY_HIGH);
+    drc_set_sound_priority(DRC_SND("block-destroyed.wav"), DRC_SOUND_PRIORITY_LOW);
+    drc_set_sound_priority(DRC_SND("bullet-bounce.wav"), DRC_SOUND_PRIORITY_LOW);
+    drc_set_sound_priority(DRC_SND("bullet-disolve.wav"), DRC_SOUND_PRIORITY_LOW);
+
     update = NULL;
     control = NULL;
     draw = NULL;
@@ -627,8 +745,7 @@ static void reset_hero(int x, int y)
     hero.sprite = &hero.sprite_flying;
 
     /* Set a new given position */
-    hero.body.x = x;
-    hero.body.y = y;
+    place_body(&hero.body, x, y);
 
     /* Allow the hero to be controlled by the player */
     hero.control = control_hero_from_keyboard;
@@ -644,11 +761,97 @@ static void update_enemy_animation(ENEMY *enemy, void *data)
     drc_animate(&enemy->sprite);
 }
 
+static void start_enemy_on_spots(ENEMY *enemy, int row, int col)
+{
+    /* It starts in its own spot, and goes whichever way it was moving */
+    enemy->node = (row * room.cols) + col;
+    enemy->to_go = 0;
+
+    if (enemy->body.dx != 0) {
+        enemy->heading = enemy->body.dx > 0 ? RIGHT : LEFT;
+    } else if (enemy->body.dy != 0) {
+        enemy->heading = enemy->body.dy > 0 ? DOWN : UP;
+    } else {
+        enemy->heading = NO_DIRECTION;
+    }
+
+    enemy->speed = abs(enemy->body.dx) > abs(enemy->body.dy) ? abs(enemy->body.dx) : abs(enemy->body.dy);
+}
+
+/**
+ * Move an enemy from spot to spot. Each time it gets to a
+ * spot, "get_next_heading" says which way to go from there.
+ */
+static void move_enemy_on_spots(ENEMY *enemy, DIRECTION (*get_next_heading)(ENEMY *enemy))
+{
+    float step = convert_pps_to_fps(enemy->speed);
+
+    while (step > 0) {
+
+        if (enemy->to_go <= 0) {
+
+            DIRECTION heading = get_next_heading(enemy);
+
+            /* Nowhere to go, wait in case a block is destroyed or the hero moves */
+            if (heading == NO_DIRECTION) {
+                break;
+            }
+
+            enemy->heading = heading;
+            enemy->node += (directions[heading].v_offset * room.cols) + directions[heading].h_offset;
+            enemy->to_go = TILE_SIZE;
+        }
+
+        float move = step < enemy->to_go ? step : enemy->to_go;
+
+        enemy->body.x += directions[enemy->heading].x_offset * move;
+        enemy->body.y += directions[enemy->heading].y_offset * move;
+        enemy->to_go -= move;
+        step -= move;
+
+        /* Spots are on whole pixels, don't let it drift away from them */
+        if (enemy->to_go <= 0) {
+            enemy->body.x = roundf(enemy->body.x);
+            enemy->body.y = roundf(enemy->body.y);
+        }
+    }
+}
+
+/* The contours say where to go to keep following the wall */
+static DIRECTION get_tracer_heading(ENEMY *enemy)
+{
+    return get_contour_heading(&contours, enemy->node / room.cols, enemy->node % room.cols, enemy->heading);
+}
+
 static void update_enemy_tracer(ENEMY *enemy, void *data)
 {
-    /* YOU LEFT OFF HERE!!! */
-    /* Add code for the enemy to follow the walls */
+    move_enemy_on_spots(enemy, get_tracer_heading);
+    update_enemy_animation(enemy, data);
+}
+
+static FLOW_FIELD *get_hero_flow_field(void)
+{
+    /* The spot with the middle of the hero in it */
+    int r = (int)((hero.body.y + (hero.body.h / 2)) / TILE_SIZE);
+    int c = (int)((hero.body.x + (hero.body.w / 2)) / TILE_SIZE);
+
+    if (is_hero_flow_field_stale || hero_flow_field.row != r || hero_flow_field.col != c) {
+        find_flow_field(&hero_flow_field, &room, r, c);
+        is_hero_flow_field_stale = false;
+    }
 
+    return &hero_flow_field;
+}
+
+/* Every chaser looks up the same way to the hero */
+static DIRECTION get_chaser_heading(ENEMY *enemy)
+{
+    return get_flow_direction(get_hero_flow_field(), enemy->node / room.cols, enemy->node % room.cols);
+}
+
+static void update_enemy_chaser(ENEMY *enemy, void *data)
+{
+    move_enemy_on_spots(enemy, get_chaser_heading);
     update_enemy_animation(enemy, data);
 }
 
@@ -678,6 +881,23 @@ static void update_enemy_movement(ENEMY *enemy, void *data)
     update_enemy_animation(enemy, data);
 }
 
+static void load_gameplay_enemy_archetypes(void)
+{
+    /* How each type of enemy moves */
+    static void (*enemy_updates[NUM_ENEMY_UPDATES])(ENEMY *enemy, void *data) = {
+        [ENEMY_UPDATE_ANIMATION] = update_enemy_animation,
+        [ENEMY_UPDATE_MOVEMENT] = update_enemy_movement,
+        [ENEMY_UPDATE_TRACER] = update_enemy_tracer,
+        [ENEMY_UPDATE_CHASER] = update_enemy_chaser
+    };
+
+    load_enemy_archetypes(ENEMY_ARCHETYPES_FILENAME, enemy_archetypes);
+
+    for (int i = 0; i < NUM_ENEMY_TYPES; i++) {
+        enemy_archetypes[i].enemy.update = enemy_updates[enemy_archetypes[i].update];
+    }
+}
+
 static void load_enemy_from_definition(ENEMY *enemy, ENEMY_DEFINITION *definition)
 {
     if (!definition->is_active) {
@@ -686,92 +906,25 @@ static void load_enemy_from_definition(ENEMY *enemy, ENEMY_DEFINITION *definitio
         return;
     }
 
-    enemy->body.x = definition->col * TILE_SIZE;
-    enemy->body.y = definition->row * TILE_SIZE;
-
-    enemy->type = definition->type;
-
-    if (enemy->type == ENEMY_TYPE_LEFTRIGHT) {
-        drc_init_sprite(&enemy->sprite, true, 20);
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-bat-1.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-bat-2.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-bat-2.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-bat-3.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-bat-3.png"));
-        enemy->sprite.x_offset = -10;
-        enemy->sprite.y_offset = -10;
-        enemy->body.x += 5; /* Fix the initial position */
-        enemy->body.y += 5;
-        enemy->body.w = 10;
-        enemy->body.h = 10;
-        enemy->body.dx = -definition->speed;
-        enemy->update = update_enemy_movement;
-    } else if (enemy->type == ENEMY_TYPE_UPDOWN) {
-        drc_init_sprite(&enemy->sprite, true, 8);
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-1.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-2.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-3.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-4.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-5.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-6.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-3.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-spider-7.png"));
-        enemy->sprite.x_offset = -10;
-        enemy->sprite.y_offset = -10;
-        enemy->body.x += 5; /* Fix the initial position */
-        enemy->body.y += 5;
-        enemy->body.w = 10;
-        enemy->body.h = 10;
-        enemy->body.dy = -definition->speed;
-        enemy->update = update_enemy_movement;
-    } else if (enemy->type == ENEMY_TYPE_DIAGONAL) {
-        drc_init_sprite(&enemy->sprite, true, 10);
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-ghost-1.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-ghost-2.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-ghost-3.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-ghost-4.png"));
-        enemy->sprite.x_offset = -10;
-        enemy->sprite.y_offset = -10;
-        enemy->body.x += 5; /* Fix the initial position */
-        enemy->body.y += 5;
-        enemy->body.w = 10;
-        enemy->body.h = 10;
-        enemy->body.dx = definition->speed;
-        enemy->body.dy = -definition->speed;
-        enemy->update = update_enemy_movement;
-    } else if (enemy->type == ENEMY_TYPE_BLOCKER) {
-        drc_init_sprite(&enemy->sprite, true, 1);
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-blocker-1.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-blocker-2.png"));
-        enemy->body.w = 19;
-        enemy->body.h = 19;
-        enemy->update = update_enemy_animation;
-    } else if (enemy->type == ENEMY_TYPE_TRACER) {
-        drc_init_sprite(&enemy->sprite, true, 10);
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-1.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-2.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-3.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-4.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-5.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-5.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-5.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-5.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-6.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-7.png"));
-        drc_add_frame(&enemy->sprite, DRC_IMG("enemy-tracer-8.png"));
-        enemy->sprite.x_offset = -10;
-        enemy->sprite.y_offset = -10;
-        enemy->body.x += 5; /* Fix the initial position */
-        enemy->body.y += 5;
-        enemy->body.w = 10;
-        enemy->body.h = 10;
-        enemy->body.dx = definition->speed;
-        enemy->body.dy = -definition->speed;
-        enemy->update = update_enemy_tracer;
-    }
+    ENEMY_ARCHETYPE *archetype = &enemy_archetypes[definition->type];
+
+    /* Everything but where it is and how fast it's going */
+    *enemy = archetype->enemy;
+
+    enemy->body.x = (definition->col * TILE_SIZE) + archetype->x;
+    enemy->body.y = (definition->row * TILE_SIZE) + archetype->y;
+    enemy->body.dx = archetype->dx * definition->speed;
+    enemy->body.dy = archetype->dy * definition->speed;
 
     enemy->dist = definition->dist;
 
+    if (archetype->update == ENEMY_UPDATE_TRACER || archetype->update == ENEMY_UPDATE_CHASER) {
+        start_enemy_on_spots(enemy, definition->row, definition->col);
+    }
+
+    /* Don't draw the enemy sliding in from wherever it was before */
+    save_body_position(&enemy->body);
+
     enemy->is_active = true;
 }
 
@@ -790,6 +943,9 @@ static void load_blocks_from_orig(void)
             room.block_map[(r * room.cols) + c] = room.block_map_orig[(r * room.cols) + c];
         }
     }
+
+    init_contour_graph(&contours, &room);
+    is_hero_flow_field_stale = true;
 }
 
 static void to_gameplay_state_starting_new_game(void)
@@ -799,6 +955,14 @@ static void to_gameplay_state_starting_new_game(void)
     draw = NULL;
 }
 
+/* A room bundle is used instead of the room list, if one is open */
+static int get_num_rooms(void)
+{
+    int num_bundle_rooms = get_num_bundle_rooms();
+
+    return num_bundle_rooms > 0 ? num_bundle_rooms : room_list.size;
+}
+
 static void to_gameplay_state_win(void)
 {
     end_gameplay = true;
@@ -807,7 +971,7 @@ static void to_gameplay_state_win(void)
 static void to_gameplay_state_door_entered(void)
 {
     /* Go to the next level? */
-    if (curr_room < room_list.size - 1) {
+    if (curr_room < get_num_rooms() - 1) {
 
         /* The hero has entered the end-level door, go to the next level */
 
@@ -852,69 +1016,229 @@ static void to_gameplay_state_starting_after_dying(void)
     to_gameplay_state_playing();
 }
 
-static bool load_gameplay_room_from_filename(const char *filename)
+/**
+ * Read a room, without getting its images ready. Loading a room
+ * is split up like this so it can be spread out over a few updates.
+ */
+static bool read_gameplay_room_from_num(int room_num)
 {
     assert(is_gameplay_init);
+    assert(room_num < get_num_rooms());
 
-    bool success = load_room_from_datafile_with_filename(filename, &room);
+    DRC_TRACE_BEGIN("read_room", NULL);
 
-    if (success) {
-        load_blocks_from_orig();
-        load_enemies_from_definitions();
+    bool success = false;
+
+    /**
+     * Rooms in a bundle are already compiled. When a bundle is
+     * open there's no room list to fall back on, so a room that
+     * can't be read from the bundle can't be read at all.
+     */
+    if (get_num_bundle_rooms() > 0) {
+        success = read_room_from_bundle(room_num, &room);
+    } else {
+        /* Rooms that were read ahead of time are already compiled too */
+        success = read_preloaded_room(room_num, &room) ||
+            read_room_with_filename(room_list.filenames[room_num], &room);
     }
 
+    DRC_TRACE_END();
+
     return success;
 }
 
+/* Once the room has been read and finished, get it ready to play */
+static void start_gameplay_room(int room_num)
+{
+    load_blocks_from_orig();
+    load_enemies_from_definitions();
+
+    curr_room = room_num;
+
+    /* Fade to the music for this room, if it has any */
+    if (room.music[0] != '\0') {
+        drc_play_music(room.music, MUSIC_FADE_SECS);
+    }
+}
+
 static bool load_gameplay_room_from_num(int room_num)
 {
-    assert(is_gameplay_init);
-    assert(room_num < room_list.size);
+    if (!read_gameplay_room_from_num(room_num)) {
+        return false;
+    }
 
-    bool success = load_gameplay_room_from_filename(room_list.filenames[room_num]);
+    finish_loading_room(&room);
+    start_gameplay_room(room_num);
 
-    if (success) {
-        curr_room = room_num;
+    return true;
+}
+
+static void draw_tile_map(ROOM_CELL *map, int r1, int c1, int r2, int c2)
+{
+    for (int r = r1; r <= r2; r++) {
+        for (int c = c1; c <= c2; c++) {
+            int n = map[(r * room.cols) + c];
+            if (n >= 0 && n < room.num_tiles) {
+                drc_draw_sprite(&room.tiles[n], c * TILE_SIZE, r * TILE_SIZE);
+            }
+        }
     }
+}
 
-    return success;
+static void clear_room_layers(void)
+{
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+
+    al_set_target_bitmap(farground_layers[curr_layer]);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+
+    al_set_target_bitmap(scenery_layers[curr_layer]);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+
+    al_restore_state(&state);
 }
 
-static void start_next_room(void)
+/**
+ * Draw the tiles of the room, from row "r1" column "c1"
+ * to row "r2" column "c2", to the room layers.
+ */
+static void render_room_layers_area(int r1, int c1, int r2, int c2)
 {
-    /* Clear the old room */
-    init_room(&room);
+    DRC_TRACE_BEGIN("render_room_layers", NULL);
 
-    /* Clear any remaining enemies */
-    init_enemies();
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
 
-    /* Clear any existing powerups */
-    init_powerups();
+    al_set_target_bitmap(farground_layers[curr_layer]);
+    draw_tile_map(room.farground_map, r1, c1, r2, c2);
 
-    /* Load the next room */
-    load_gameplay_room_from_num(curr_room + 1);
+    al_set_target_bitmap(scenery_layers[curr_layer]);
+    draw_tile_map(room.background_map, r1, c1, r2, c2);
+    draw_tile_map(room.foreground_map, r1, c1, r2, c2);
 
-    /* Reset the hero */
-    reset_hero(room.start_x, room.start_y);
+    al_restore_state(&state);
 
-    int n = 0;
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        if (powerups[i].is_active) {
-            n++;
+    DRC_TRACE_END();
+}
+
+/* Draw the whole room to the room layers, all at once */
+static void render_room_layers(void)
+{
+    clear_room_layers();
+    render_room_layers_area(0, 0, room.rows - 1, room.cols - 1);
+}
+
+/**
+ * Draw one more row (or column) of the next room to the room
+ * layers while the rooms scroll. The edge that scrolls onto the
+ * screen first is drawn first. Returns false when there's
+ * nothing left to draw.
+ */
+static bool render_next_room_layer_strip(void)
+{
+    DIRECTION direction = screenshot2.direction;
+    int n = num_layer_strips_drawn;
+
+    if (direction == LEFT || direction == RIGHT) {
+        if (n >= room.cols) {
+            next_room_layers_done = true;
+            return false;
         }
+        int c = direction == RIGHT ? n : room.cols - 1 - n;
+        render_room_layers_area(0, c, room.rows - 1, c);
+    } else {
+        if (n >= room.rows) {
+            next_room_layers_done = true;
+            return false;
+        }
+        int r = direction == UP ? room.rows - 1 - n : n;
+        render_room_layers_area(r, 0, r, room.cols - 1);
+    }
+
+    num_layer_strips_drawn++;
+
+    return true;
+}
+
+/**
+ * Do the next step of loading the next room.
+ * Returns true once the room is completely loaded.
+ */
+static bool load_next_room_step(void)
+{
+    if (next_room_step == NEXT_ROOM_LOADED) {
+        return true;
     }
-    if (n > 0) {
-        printf("Starting a new room with %d number of powerups.\n", n);
+
+    drc_profile_start(DRC_PROFILE_ROOM);
+    DRC_TRACE_BEGIN("start_next_room", NULL);
+
+    if (next_room_step == NEXT_ROOM_READ) {
+
+        /* Clear the old room */
+        init_room(&room);
+
+        /* Clear any remaining enemies */
+        init_enemies();
+
+        /* Clear any existing powerups */
+        init_powerups();
+
+        /* Read the next room */
+        next_room_read = read_gameplay_room_from_num(curr_room + 1);
+
+    } else if (next_room_step == NEXT_ROOM_FINISH) {
+
+        if (next_room_read) {
+            finish_loading_room(&room);
+        }
+
+    } else if (next_room_step == NEXT_ROOM_START) {
+
+        if (next_room_read) {
+            start_gameplay_room(curr_room + 1);
+        }
+
+        /* Reset the hero */
+        reset_hero(room.start_x, room.start_y);
+
+        int n = 0;
+        for (int i = 0; i < MAX_POWERUPS; i++) {
+            if (powerups[i].is_active) {
+                n++;
+            }
+        }
+        if (n > 0) {
+            printf("Starting a new room with %d number of powerups.\n", n);
+        }
+    }
+
+    next_room_step++;
+
+    DRC_TRACE_END();
+    drc_profile_stop(DRC_PROFILE_ROOM);
+
+    return next_room_step == NEXT_ROOM_LOADED;
+}
+
+/* Load the next room all at once */
+static void start_next_room(void)
+{
+    next_room_step = NEXT_ROOM_READ;
+
+    while (!load_next_room_step()) {
+        continue;
     }
 }
 
 static void to_gameplay_state_starting_next_room(void)
 {
     start_next_room();
+    render_room_layers();
 
     /* Ready to start playing! */
     to_gameplay_state_playing();
-
 }
 
 static void to_gameplay_state_leaving_room(void)
@@ -943,27 +1267,29 @@ static void to_gameplay_state_scroll_rooms(void)
     screenshot1.direction = room.exits[room.used_exit_num].direction;
     screenshot2.direction = room.exits[room.used_exit_num].direction;
 
+    /**
+     * The current room is already drawn on its scenery layer.
+     * Draw the blocks, enemies and everything else on top of it,
+     * so that it looks just like it did, and scroll that away...
+     */
     ALLEGRO_STATE state;
     al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+    al_set_target_bitmap(scenery_layers[curr_layer]);
+    draw_room_objects();
+    draw_effects();
+    al_restore_state(&state);
 
-    /* Erase the farground from the current room so it doesn't get drawn anymore */
-    for (int i = 0; i < MAX_ROOM_SIZE; i++) {
-        room.farground_map[i] = NO_TILE;
-    }
+    drc_delete_frames(&screenshot1.sprite);
+    drc_add_frame(&screenshot1.sprite, scenery_layers[curr_layer]);
 
-    /* Take a screenshot of the current room */
-    /* Clear the screenshot then draw the room */
-    al_set_target_bitmap(drc_get_frame(&screenshot1.sprite));
-    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-    draw_gameplay_playing();
+    /* ...and draw the next room on the other layers while it scrolls in */
+    curr_layer = 1 - curr_layer;
+    drc_delete_frames(&screenshot2.sprite);
+    drc_add_frame(&screenshot2.sprite, scenery_layers[curr_layer]);
 
     /* Clear all resources before loading the new room */
     /* ONLY DO THIS WHEN NEEDED */
     //drc_free_resources();
-    
-    /* Grab a copy of the hero position */
-    float old_hero_pos_x = hero.body.x;
-    float old_hero_pos_y = hero.body.y;
 
     /* Clear the screnshots, in preparation of making the screen scroll */
     screenshot1.x = 0;
@@ -975,9 +1301,6 @@ static void to_gameplay_state_scroll_rooms(void)
     screenshot2.dx = 0;
     screenshot2.dy = 0;
 
-    /* Load the next room */
-    start_next_room();
-
     /* Configure the screenshots to scroll, based on the direction of the exit used */
     if (screenshot1.direction == RIGHT) {
         screenshot2.x = drc_get_display_width();
@@ -993,43 +1316,71 @@ static void to_gameplay_state_scroll_rooms(void)
         screenshot2.dy = -drc_get_display_height();
     }
 
+    screenshot1.old_x = screenshot1.x;
+    screenshot1.old_y = screenshot1.y;
+    screenshot2.old_x = screenshot2.x;
+    screenshot2.old_y = screenshot2.y;
+
+    /* The hero comes in right across from where they left, before anything scrolls */
+    hero_entering_x = hero.body.x - screenshot2.x;
+    hero_entering_y = hero.body.y - screenshot2.y;
+
+    /* The next room is loaded over the first few scrolling updates */
+    next_room_step = NEXT_ROOM_READ;
+    num_layer_strips_drawn = 0;
+    next_room_layers_done = false;
+
+    update = update_gameplay_scroll_rooms;
+    control = control_gameplay_playing;
+    draw = draw_gameplay_scrolling_rooms;
+}
+
+static void load_next_room_while_scrolling(void)
+{
+    if (!load_next_room_step()) {
+        return;
+    }
+
+    /* Start drawing its layers */
+    clear_room_layers();
+
     /* Set the hero pos to match where they entered the room... */
-    hero.body.x = old_hero_pos_x - screenshot2.x;
-    hero.body.y = old_hero_pos_y - screenshot2.y;
+    place_body(&hero.body, hero_entering_x, hero_entering_y);
 
     /* And save the hero pos as the new room default */
     room.start_x = hero.body.x;
     room.start_y = hero.body.y;
+}
 
-    /* Here's a little trick... */
-    /* Erase the farground from the new room so it doesn't get drawn anymore... */
-    /* Then restore the farground afterwards */
-    int farground_copy[MAX_ROOM_SIZE];
-    for (int i = 0; i < MAX_ROOM_SIZE; i++) {
-        farground_copy[i] = room.farground_map[i];
-        room.farground_map[i] = NO_TILE;
+static void finish_scrolling_rooms(void)
+{
+    /* Normally the next room has been completely loaded and drawn long before now */
+    while (next_room_step != NEXT_ROOM_LOADED) {
+        load_next_room_while_scrolling();
     }
-    
-    /* Take a screenshot of the next room */
-    /* Clear the screenshot then draw the room */
-    al_set_target_bitmap(drc_get_frame(&screenshot2.sprite));
-    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-    draw_gameplay_playing();
-
-    al_restore_state(&state);
 
-    /* Restore the farground (see above) */
-    for (int i = 0; i < MAX_ROOM_SIZE; i++) {
-        room.farground_map[i] = farground_copy[i];
+    while (render_next_room_layer_strip()) {
+        continue;
     }
 
-    update = update_gameplay_scroll_rooms;
-    control = control_gameplay_playing;
-    draw = draw_gameplay_scrolling_rooms;
+    to_gameplay_state_playing();
 }
 
 static bool update_gameplay_scroll_rooms(void)
 {
+    /**
+     * Loading the room takes a while, so it's done one step
+     * each update while the rooms keep scrolling. Drawing
+     * the next room is spread out over the updates after that.
+     */
+    if (next_room_step != NEXT_ROOM_LOADED) {
+        load_next_room_while_scrolling();
+    } else {
+        for (int i = 0; i < LAYER_STRIPS_PER_UPDATE; i++) {
+            render_next_room_layer_strip();
+        }
+    }
+
     float change_x = convert_pps_to_fps(screenshot2.dx);
     float change_y = convert_pps_to_fps(screenshot2.dy);
 
@@ -1041,15 +1392,15 @@ static bool update_gameplay_scroll_rooms(void)
 
     /* Find out if we're done scrolling (and don't over-scroll!) */
     if (screenshot2.dx < 0 && (int)screenshot2.x <= 0) {
-        to_gameplay_state_playing();
+        finish_scrolling_rooms();
     } else if (screenshot2.dx > 0 && (int)screenshot2.x >= 0) {
-        to_gameplay_state_playing();
+        finish_scrolling_rooms();
     }
 
     if (screenshot2.dy < 0 && (int)screenshot2.y <= 0) {
-        to_gameplay_state_playing();
+        finish_scrolling_rooms();
     } else if (screenshot2.dy > 0 && (int)screenshot2.y >= 0) {
-        to_gameplay_state_playing();
+        finish_scrolling_rooms();
     }
 
     return true;
@@ -1059,6 +1410,7 @@ static bool update_gameplay_starting_new_game(void)
 {
     /* Load the current room */
     load_gameplay_room_from_num(curr_room);
+    render_room_layers();
 
     /* Load the hero sprites */
     /* Reset the hero */
@@ -1100,6 +1452,9 @@ static void control_gameplay_options(ALLEGRO_EVENT *event)
         } else if (key == ALLEGRO_KEY_J || key == ALLEGRO_KEY_C) {
             /* Toggle the hero */
             toggle_hero();
+        } else if (key == ALLEGRO_KEY_F3) {
+            /* F3 : Toggle frame timings */
+            drc_toggle_profile_overlay();
         }
     } else if (event->type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
         end_gameplay = true;
@@ -1156,6 +1511,8 @@ static bool move_bullet(BULLET *bullet, float new_x, float new_y)
             drc_play_sound(DRC_SND("block-destroyed.wav"));
             load_poof_effect(c * TILE_SIZE, r * TILE_SIZE);
             room.block_map[(r * room.cols) + c] = NO_BLOCK;
+            update_contour_graph(&contours, &room, r, c);
+            is_hero_flow_field_stale = true;
 
             /* Save the location that was cleared, in case we need to draw a door */
             room.last_cleared_x = c * TILE_SIZE;
@@ -1239,8 +1596,7 @@ static void shoot_bullet(int texture, float x, float y)
     bullet->texture = texture;
     bullet->hits = 2;
     bullet->destroy_on_block = true;
-    bullet->body.x = x;
-    bullet->body.y = y;
+    place_body(&bullet->body, x, y);
     bullet->body.w = 10;
     bullet->body.h = 10;
 
@@ -1558,10 +1914,7 @@ static bool update_gameplay_playing(void)
         }
     }
 
-    /* Blocks */
-    for (int i = 0; i < room.num_texture_defs; i++) {
-        drc_animate(&room.blocks[i]);
-    }
+    /* Blocks are animated by the clock (see "finish_loading_room") */
 
     /* Powerups */
     for (int i = 0; i < MAX_POWERUPS; i++) {
@@ -1699,12 +2052,181 @@ static bool update_gameplay_playing(void)
     return true;
 }
 
+static void save_positions(void)
+{
+    save_body_position(&hero.body);
+
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        save_body_position(&bullets[i].body);
+    }
+
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        save_body_position(&enemies[i].body);
+    }
+
+    for (int i = 0; i < MAX_POWERUPS; i++) {
+        save_body_position(&powerups[i].body);
+    }
+
+    screenshot1.old_x = screenshot1.x;
+    screenshot1.old_y = screenshot1.y;
+    screenshot2.old_x = screenshot2.x;
+    screenshot2.old_y = screenshot2.y;
+}
+
+/* If the file at "fullpath" is the file "name", from any datafile path */
+static bool is_same_file(const char *fullpath, const char *name)
+{
+    int fullpath_len = strlen(fullpath);
+    int name_len = strlen(name);
+
+    if (name_len > fullpath_len || strcmp(fullpath + fullpath_len - name_len, name) != 0) {
+        return false;
+    }
+
+    return name_len == fullpath_len || fullpath[fullpath_len - name_len - 1] == '/';
+}
+
+/* If the file is a room in the room list, other than the current room */
+static bool is_other_room_file(const char *fullpath)
+{
+    char tmx_filename[MAX_FILEPATH_LEN];
+
+    for (int i = 0; i < room_list.size; i++) {
+        if (i == curr_room) {
+            continue;
+        }
+        get_tmx_file_name(room_list.filenames[i], tmx_filename, MAX_FILEPATH_LEN);
+        if (is_same_file(fullpath, room_list.filenames[i]) || is_same_file(fullpath, tmx_filename)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* If the file is the current room, or something it imports */
+static bool is_curr_room_file(const char *fullpath)
+{
+    if (get_num_bundle_rooms() > 0 || curr_room < 0 || curr_room >= room_list.size) {
+        return false;
+    }
+
+    char tmx_filename[MAX_FILEPATH_LEN];
+
+    get_tmx_file_name(room_list.filenames[curr_room], tmx_filename, MAX_FILEPATH_LEN);
+
+    if (is_same_file(fullpath, room_list.filenames[curr_room]) || is_same_file(fullpath, tmx_filename)) {
+        return true;
+    }
+
+    for (int i = 0; i < room.num_imports; i++) {
+        if (is_same_file(fullpath, get_name(room.imports[i]))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* The room is read into here first, so a mistake doesn't break the room being played */
+static ROOM reloaded_room;
+
+static void reload_gameplay_room(void)
+{
+    /* Rooms in a bundle are already compiled, there's no file to read again */
+    if (get_num_bundle_rooms() > 0 || curr_room < 0 || curr_room >= room_list.size) {
+        return;
+    }
+
+    /* Reading a room adds to its tiles and textures, so start from nothing */
+    init_room(&reloaded_room);
+
+    /* This reads the text data file if it, or anything it imports, changed */
+    if (!read_room_with_filename(room_list.filenames[curr_room], &reloaded_room)) {
+        fprintf(stderr, "Failed to reload room \"%s\", keeping the old one.\n", room_list.filenames[curr_room]);
+        return;
+    }
+
+    init_enemies();
+    init_powerups();
+    init_bullets();
+
+    /* The old room's tiles and blocks go away when the new one is finished */
+    room = reloaded_room;
+    finish_loading_room(&room);
+
+    load_blocks_from_orig();
+    load_enemies_from_definitions();
+
+    reset_hero(room.start_x, room.start_y);
+    clear_hero_input();
+
+    render_room_layers();
+
+    printf("Reloaded room \"%s\".\n", room_list.filenames[curr_room]);
+}
+
+/**
+ * Load any files that changed while the game is running.
+ * Images are changed right away, they're drawn the same way no matter
+ * what's happening. The room is only loaded again while playing, so
+ * it doesn't change in the middle of scrolling from one to the next.
+ */
+static void check_for_changed_files(void)
+{
+    static bool need_room_reload = false;
+    static bool need_render = false;
+
+    char fullpath[MAX_FILEPATH_LEN];
+
+    while (drc_next_changed_file(fullpath, MAX_FILEPATH_LEN)) {
+        if (drc_reload_images_from_file(fullpath) > 0) {
+            need_render = true;
+        } else if (is_same_file(fullpath, ENEMY_ARCHETYPES_FILENAME)) {
+            /* The enemies start over, the same as the room */
+            load_gameplay_enemy_archetypes();
+            need_room_reload = true;
+        } else if (is_curr_room_file(fullpath)) {
+            free_preloaded_rooms();
+            need_room_reload = true;
+        } else if (is_other_room_file(fullpath)) {
+            /* Read it again when it's needed, instead of using the old copy */
+            free_preloaded_rooms();
+        } else {
+            /* Maybe another room imports it, those will be read again too */
+            free_preloaded_rooms();
+            fprintf(stderr, "Not reloading the room, it doesn't use \"%s\".\n", fullpath);
+        }
+    }
+
+    if (update != update_gameplay_playing) {
+        return;
+    }
+
+    if (need_room_reload) {
+        reload_gameplay_room();
+    } else if (need_render) {
+        render_room_layers();
+    }
+
+    need_room_reload = false;
+    need_render = false;
+}
+
 bool update_gameplay(void *data)
 {
     UNUSED(data);
 
     assert(is_gameplay_init);
 
+    if (drc_is_watching()) {
+        check_for_changed_files();
+    }
+
+    /* Everything is about to move, remember where it was */
+    save_positions();
+
     update();
 
     update_effects();
@@ -1723,56 +2245,75 @@ void draw_gameplay(void *data)
     }
 }
 
+static float get_screenshot_draw_x(SCREENSHOT *screenshot)
+{
+    return screenshot->old_x + ((screenshot->x - screenshot->old_x) * drc_get_interpolation());
+}
+
+static float get_screenshot_draw_y(SCREENSHOT *screenshot)
+{
+    return screenshot->old_y + ((screenshot->y - screenshot->old_y) * drc_get_interpolation());
+}
+
+static void draw_screenshot(SCREENSHOT *screenshot)
+{
+    drc_draw_sprite(&screenshot->sprite, get_screenshot_draw_x(screenshot), get_screenshot_draw_y(screenshot));
+}
+
 static void draw_gameplay_scrolling_rooms(void)
 {
     /* Draw the farground */
-    /* This will draw the farground from the NEXT room */
     /* The farground never scrolls! */
-    for (int r = 0; r < room.rows; r++) {
-        for (int c = 0; c < room.cols; c++) {
+    /* This will draw the farground from the NEXT room once its layer is done */
+    if (next_room_layers_done) {
+        al_draw_bitmap(farground_layers[curr_layer], 0, 0, 0);
+    } else {
+        al_draw_bitmap(farground_layers[1 - curr_layer], 0, 0, 0);
+    }
 
-            int n = 0;
+    draw_screenshot(&screenshot1);
+    draw_screenshot(&screenshot2);
 
-            /* Farground */
-            n = room.farground_map[(r * room.cols) + c];
-            if (n >= 0 && n < room.num_tiles) {
-                drc_draw_sprite(&room.tiles[n], c * TILE_SIZE, r * TILE_SIZE);
-            }
-        }
-    }
+    if (next_room_step == NEXT_ROOM_LOADED) {
+
+        /* Everything in the next room scrolls in along with it */
+        ALLEGRO_TRANSFORM old_transform;
+        al_copy_transform(&old_transform, al_get_current_transform());
+
+        ALLEGRO_TRANSFORM transform;
+        al_identity_transform(&transform);
+        al_translate_transform(&transform, get_screenshot_draw_x(&screenshot2), get_screenshot_draw_y(&screenshot2));
+        al_compose_transform(&transform, &old_transform);
 
-    drc_draw_sprite(&screenshot1.sprite, screenshot1.x, screenshot1.y);
-    drc_draw_sprite(&screenshot2.sprite, screenshot2.x, screenshot2.y);
+        al_use_transform(&transform);
+        draw_room_objects();
+        al_use_transform(&old_transform);
+    }
 }
 
 static void draw_gameplay_playing(void)
 {
-    /* Draw the room (backgrounds, blocks...) */
-    for (int r = 0; r < room.rows; r++) {
-        for (int c = 0; c < room.cols; c++) {
-
-            int n = 0;
-
-            /* Farground */
-            n = room.farground_map[(r * room.cols) + c];
-            if (n >= 0 && n < room.num_tiles) {
-                drc_draw_sprite(&room.tiles[n], c * TILE_SIZE, r * TILE_SIZE);
-            }
+    /* Draw the room */
+    al_draw_bitmap(farground_layers[curr_layer], 0, 0, 0);
+    al_draw_bitmap(scenery_layers[curr_layer], 0, 0, 0);
 
-            /* Background */
-            n = room.background_map[(r * room.cols) + c];
-            if (n >= 0 && n < room.num_tiles) {
-                drc_draw_sprite(&room.tiles[n], c * TILE_SIZE, r * TILE_SIZE);
-            }
+    /* Draw blocks, enemies, the hero... */
+    draw_room_objects();
 
-            /* Foreground */
-            n = room.foreground_map[(r * room.cols) + c];
-            if (n >= 0 && n < room.num_tiles) {
-                drc_draw_sprite(&room.tiles[n], c * TILE_SIZE, r * TILE_SIZE);
-            }
+    /* Draw the special effects */
+    draw_effects();
+}
 
-            /* Blocks */
-            n = room.block_map[(r * room.cols) + c];
+/**
+ * Draw everything in the room that moves or
+ * changes, on top of the room layers.
+ */
+static void draw_room_objects(void)
+{
+    /* Draw the blocks */
+    for (int r = 0; r < room.rows; r++) {
+        for (int c = 0; c < room.cols; c++) {
+            int n = room.block_map[(r * room.cols) + c];
             if (n >= 0 && n < room.num_texture_defs) {
                 drc_draw_sprite(&room.blocks[n], c * TILE_SIZE, r * TILE_SIZE);
             }
@@ -1789,7 +2330,7 @@ static void draw_gameplay_playing(void)
     for (int i = 0; i < MAX_BULLETS; i++) {
         BULLET *bullet = &bullets[i];
         if (bullet->is_active) {
-            drc_draw_sprite(&bullet->sprite, bullet->body.x, bullet->body.y);
+            drc_draw_sprite(&bullet->sprite, get_draw_x(&bullet->body), get_draw_y(&bullet->body));
         }
     }
 
@@ -1797,7 +2338,7 @@ static void draw_gameplay_playing(void)
     for (int i = 0; i < MAX_ENEMIES; i++) {
         ENEMY *enemy = &enemies[i];
         if (enemy->is_active) {
-            drc_draw_sprite(&enemy->sprite, enemy->body.x, enemy->body.y);
+            drc_draw_sprite(&enemy->sprite, get_draw_x(&enemy->body), get_draw_y(&enemy->body));
         }
     }
 
@@ -1809,38 +2350,52 @@ static void draw_gameplay_playing(void)
     }
 
     /* Draw the hero */
-    drc_draw_sprite(hero.sprite, hero.body.x, hero.body.y);
+    float hero_x = get_draw_x(&hero.body);
+    float hero_y = get_draw_y(&hero.body);
+    drc_draw_sprite(hero.sprite, hero_x, hero_y);
     
     /* Draw the hero's bullet */
     if (hero.has_bullet) {
-        drc_draw_sprite(&hero.bullet, hero.bullet_x, hero.bullet_y);
+
+        /* The bullet follows the hero, so move it along with the smoothed hero position */
+        float bullet_x = hero.bullet_x + (hero_x - hero.body.x);
+        float bullet_y = hero.bullet_y + (hero_y - hero.body.y);
+
+        drc_draw_sprite(&hero.bullet, bullet_x, bullet_y);
 
         /* Draw a dot for every powerup shot left (if any) */
         for (int i = 0; i < hero.powerup_remaining; i++) {
             if (room.direction == UP) {
                 /* Draw dots to the right */
-                drc_draw_sprite(&powerup_dot, hero.bullet_x + 16, hero.bullet_y - 2 + (i * 5));
+                drc_draw_sprite(&powerup_dot, bullet_x + 16, bullet_y - 2 + (i * 5));
             } else if (room.direction == DOWN) {
                 /* Draw dots to the right */
-                drc_draw_sprite(&powerup_dot, hero.bullet_x + 16, hero.bullet_y - 1 + (i * 5));
+                drc_draw_sprite(&powerup_dot, bullet_x + 16, bullet_y - 1 + (i * 5));
             } else if (room.direction == LEFT) {
                 /* Draw dots above */
-                drc_draw_sprite(&powerup_dot, hero.bullet_x - 2 + (i * 5), hero.bullet_y - 10);
+                drc_draw_sprite(&powerup_dot, bullet_x - 2 + (i * 5), bullet_y - 10);
             } else {
                 /* Draw dots above */
-                drc_draw_sprite(&powerup_dot, hero.bullet_x - 1 + (i * 5), hero.bullet_y - 10);
+                drc_draw_sprite(&powerup_dot, bullet_x - 1 + (i * 5), bullet_y - 10);
             }
         }
     }
-
-    /* Draw the special effects */
-    draw_effects();
 }
 
 bool load_gameplay_room_list_from_filename(const char *filename)
 {
     assert(is_gameplay_init);
 
+    /* The rooms that were read ahead of time were from the old list */
+    free_preloaded_rooms();
+    close_room_bundle();
+
+    /* Rooms from a bundle are read as they're needed */
+    if (is_room_bundle_index(filename)) {
+        room_list.size = 0;
+        return open_room_bundle(filename);
+    }
+
     if (!load_room_list_from_datafile_with_filename(filename, &room_list)) {
         return false;
     }
@@ -1848,9 +2403,21 @@ bool load_gameplay_room_list_from_filename(const char *filename)
     return true;
 }
 
+int preload_gameplay_room_list(int num_threads, bool is_timing_one_thread)
+{
+    assert(is_gameplay_init);
+
+    /* The rooms in a bundle are already compiled, and there could be thousands */
+    if (get_num_bundle_rooms() > 0) {
+        return 0;
+    }
+
+    return preload_room_list(&room_list, num_threads, is_timing_one_thread);
+}
+
 void set_curr_room(int room_num)
 {
-    assert(room_num < room_list.size);
+    assert(room_num < get_num_rooms());
 
     curr_room = room_num;
 }
@@ -1859,13 +2426,19 @@ bool add_gameplay_room_filename_to_room_list(const char *filename)
 {
     assert(is_gameplay_init);
 
-    if (room_list.size == MAX_ROOMS) {
-        fprintf(stderr, "Failed to find space to add room filename to room list.\n");
-        return false;
-    }
+    /* The preloaded rooms and the bundle don't have this room */
+    free_preloaded_rooms();
+    close_room_bundle();
 
-    strncpy(room_list.filenames[room_list.size], filename, MAX_FILENAME_LEN);
-    room_list.size++;
+    add_room_to_room_list(&room_list, filename);
 
     return true;
 }
+
+void free_gameplay(void)
+{
+    free_room(&room);
+    free_preloaded_rooms();
+    close_room_bundle();
+    free_room_list(&room_list);
+}
@@ -7,10 +7,21 @@
 void init_gameplay(void);
 
 /* Initialization */
+/* The room list can also be the index of a room bundle, see "roombundle.h" */
 bool load_gameplay_room_list_from_filename(const char *filename);
 bool add_gameplay_room_filename_to_room_list(const char *filename);
 void set_curr_room(int room_num);
 
+/**
+ * Read and check every room in the room list now, on a few
+ * threads, instead of when the player gets to each one.
+ * Returns the number of rooms with problems.
+ */
+int preload_gameplay_room_list(int num_threads, bool is_timing_one_thread);
+
+/* Free the room list, and any rooms that were read ahead of time */
+void free_gameplay(void);
+
 /* Reset the gameplay, ready to start playing the current level */
 void reset_gameplay(void);
 
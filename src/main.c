@@ -1,16 +1,26 @@
 #include <allegro5/allegro.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "datafile.h"
 #include "drc_display.h"
 #include "drc_memory.h"
+#include "drc_music.h"
+#include "drc_path_cache.h"
+#include "drc_profile.h"
+#include "drc_random.h"
 #include "drc_resources.h"
 #include "drc_run.h"
 #include "drc_sound.h"
 #include "drc_sprite.h"
 #include "drc_text.h"
+#include "drc_trace.h"
+#include "drc_watch.h"
 #include "gamedata.h"
 #include "gameplay.h"
 #include "menu.h"
+#include "names.h"
+#include "preload.h"
 
 /**
  * The native resolution of the game.
@@ -34,6 +44,9 @@ int main(int argc, char **argv)
     /* Initialize Allegro */
     assert(al_init());
 
+    /* Start recording trace spans (only in "--enable-trace" builds) */
+    DRC_INIT_TRACE();
+
     /* Allows the use of PNG images */
     assert(al_init_image_addon());
    
@@ -49,22 +62,64 @@ int main(int argc, char **argv)
 
     /**
      * Allow the use of audio controls and many codecs.
-     * We shouldn't ever need to play more than this
-     * many sound effects at a time.
+     * Sound effects are played on their own voices (see "drc_sound.h"),
+     * so no samples need to be reserved, just the default mixer.
      */
-    if (!al_install_audio() || !al_init_acodec_addon() || !al_reserve_samples(4)) {
+    if (!al_install_audio() || !al_init_acodec_addon() || !al_reserve_samples(0) || !drc_init_sound(DRC_DEFAULT_NUM_VOICES)) {
         printf("Failed to init audio.\n");
     }
 
+    /**
+     * Music is streamed, in small buffers. If it skips, set
+     * COLORWANDCASTLE_MUSIC_BUFFER to a bigger number of samples
+     * (the default is DRC_DEFAULT_MUSIC_BUFFER_SAMPLES).
+     */
+    const char *music_buffer = getenv("COLORWANDCASTLE_MUSIC_BUFFER");
+    drc_init_music(music_buffer != NULL ? atoi(music_buffer) : 0);
+
+    /**
+     * Draw once per refresh of the monitor.
+     * The game logic still updates at a fixed rate, and everything
+     * moving is drawn smoothly in between updates.
+     */
+    drc_set_run_policy(DRC_RUN_POLICY_VSYNC);
+
+    /**
+     * Play the same game again, with the same random numbers.
+     * Set COLORWANDCASTLE_SEED to the seed that was printed.
+     */
+    const char *seed = getenv("COLORWANDCASTLE_SEED");
+    drc_seed_random(seed != NULL ? strtoull(seed, NULL, 10) : (uint64_t)time(NULL));
+    printf("Random seed: %llu\n", (unsigned long long)drc_get_random_seed());
+
     /* Create a display that will be used to draw the game on */
     assert(drc_init_display(DISPLAY_WIDTH, DISPLAY_HEIGHT, DRC_DISPLAY_MAX_SCALE, false));
 
     /* Setup text drawing */
     assert(drc_init_text());
 
+    /**
+     * Load rooms and images again as soon as they're saved, without
+     * restarting. Set COLORWANDCASTLE_WATCH to anything to turn it on.
+     */
+    if (getenv("COLORWANDCASTLE_WATCH") != NULL) {
+        drc_start_watching();
+    }
+
     /* So we know where to look for image and sound files... */
     drc_add_resource_path( PKGDATADIR "/images/");
     drc_add_resource_path( PKGDATADIR "/sounds/");
+    drc_add_resource_path( PKGDATADIR "/music/");
+
+    /**
+     * Rooms drawn in Tiled are used as soon as they're saved,
+     * set COLORWANDCASTLE_TILED_PATH to where they are (such as
+     * "dev/tiled/", see "tmxfile.h").
+     */
+    const char *tiled_path = getenv("COLORWANDCASTLE_TILED_PATH");
+    if (tiled_path != NULL) {
+        add_datafile_path(tiled_path);
+    }
 
     /* So we know where to look for data / level files... */
     add_datafile_path( PKGDATADIR "/levels/");
@@ -84,6 +139,7 @@ int main(int argc, char **argv)
     printf("  C : Toggle character\n");
     printf("  F : Toggle fullscreen\n");
     printf("  S : Toggle sound\n");
+    printf("  F3 : Toggle frame timings\n");
     printf("  Esc : Quit\n");
     printf("\n");
 
@@ -111,6 +167,17 @@ int main(int argc, char **argv)
         load_gameplay_room_list_from_filename("list-story.dat"); /* This can eventually be chosen from a menu */
     }
 
+    /**
+     * Read and check every room now, if asked to.
+     * Set COLORWANDCASTLE_PRELOAD to the number of threads to use.
+     * Set COLORWANDCASTLE_PRELOAD_ONE_THREAD to anything to also
+     * time reading them on one thread, to compare.
+     */
+    const char *preload_threads = getenv("COLORWANDCASTLE_PRELOAD");
+    if (preload_threads != NULL) {
+        preload_gameplay_room_list(atoi(preload_threads), getenv("COLORWANDCASTLE_PRELOAD_ONE_THREAD") != NULL);
+    }
+
     /* Set the first room number */
     /* In a normal game, this will start at 0 */
     set_curr_room(room_num - 1);
@@ -124,13 +191,57 @@ int main(int argc, char **argv)
         drc_run(control_gameplay, update_gameplay, draw_gameplay, NULL);
     }
  
+    /**
+     * Save how long frames took, if asked to.
+     * Set COLORWANDCASTLE_PROFILE to the name of the file to write.
+     */
+    const char *profile_filename = getenv("COLORWANDCASTLE_PROFILE");
+    if (profile_filename != NULL) {
+        drc_write_profile_histogram(profile_filename);
+    }
+
+    /* Save the trace spans (only in "--enable-trace" builds) */
+    DRC_WRITE_TRACE("colorwandcastle-trace.json");
+    DRC_FREE_TRACE();
+
+    /**
+     * Show how well the caches, sounds and music did, if asked to.
+     * Set COLORWANDCASTLE_STATS to anything to see them.
+     */
+    if (getenv("COLORWANDCASTLE_STATS") != NULL) {
+        print_preload_stats();
+        print_import_cache_stats();
+        drc_print_sound_stats();
+        drc_print_music_stats();
+        drc_print_path_cache_stats();
+        drc_print_animation_stats();
+    }
+
     /* DONE, clean up */
+    free_gameplay();
+    free_import_cache();
+    free_names();
+    drc_free_sound();
+    drc_free_music();
+    drc_free_animations();
     drc_unlock_resources();
     drc_free_resources();
     drc_free_resource_paths();
+    drc_free_path_cache();
+    drc_stop_watching();
     drc_free_text();
     drc_free_display();
 
+    /**
+     * Show how much memory everything used, if asked to.
+     * Set COLORWANDCASTLE_MEMORY to anything to see it.
+     */
+    if (getenv("COLORWANDCASTLE_MEMORY") != NULL) {
+        drc_print_memory_stats();
+    }
+
+    drc_free_arenas();
+
     /* See if we have any naughty memory leaks */
     drc_check_memory();
 
@@ -1,21 +1,12 @@
 #include <allegro5/allegro.h>
 #include <stdio.h>
 
+#include "drc_trace.h"
 #include "mask.h"
 
-ALLEGRO_BITMAP *get_masked_image(const char *name, const char *mask)
+/* Draw the masked image on a canvas that's the same size as the image */
+static void draw_masked_image(ALLEGRO_BITMAP *canvas, const char *name, const char *mask)
 {
-    char complete_name[MAX_FILENAME_LEN];
-    complete_name[0] = '\0';
-    strncat(complete_name, name, MAX_FILENAME_LEN - 1);
-    strncat(complete_name, mask, MAX_FILENAME_LEN - 1);
-
-    /* If the image has already been added, just return it */
-    ALLEGRO_BITMAP *masked_img = DRC_IMG(complete_name);
-    if (masked_img != NULL) {
-        return masked_img;
-    }
-
     /* Load the image */
     ALLEGRO_BITMAP *orig_img = DRC_IMG(name);
     assert(orig_img);
@@ -24,10 +15,6 @@ ALLEGRO_BITMAP *get_masked_image(const char *name, const char *mask)
     ALLEGRO_BITMAP *mask_img = DRC_IMG(mask);
     assert(mask_img);
 
-    /* Create a canvas to draw the newly created image to */
-    ALLEGRO_BITMAP *canvas = al_create_bitmap(al_get_bitmap_width(orig_img), al_get_bitmap_height(orig_img));
-    assert(canvas);
-
     /* STORE Allegro state */
     /* See http://liballeg.org/a5docs/trunk/graphics.html#drawing-operations */
     ALLEGRO_STATE state;
@@ -45,26 +32,43 @@ ALLEGRO_BITMAP *get_masked_image(const char *name, const char *mask)
 
     /* RESTORE Allegro state */
     al_restore_state(&state);
-
-    /* Add it to the collection of resources */
-    drc_insert_image_resource(complete_name, canvas);
-
-    return canvas;
 }
 
-ALLEGRO_BITMAP *get_stacked_image(const char *bottom, const char *top)
+ALLEGRO_BITMAP *get_masked_image(const char *name, const char *mask)
 {
     char complete_name[MAX_FILENAME_LEN];
     complete_name[0] = '\0';
-    strncat(complete_name, top, MAX_FILENAME_LEN - 1);
-    strncat(complete_name, bottom, MAX_FILENAME_LEN - 1);
+    strncat(complete_name, name, MAX_FILENAME_LEN - 1);
+    strncat(complete_name, mask, MAX_FILENAME_LEN - 1);
 
     /* If the image has already been added, just return it */
-    ALLEGRO_BITMAP *stacked_img = DRC_IMG(complete_name);
-    if (stacked_img != NULL) {
-        return stacked_img;
+    ALLEGRO_BITMAP *masked_img = DRC_IMG(complete_name);
+    if (masked_img != NULL) {
+        return masked_img;
     }
 
+    DRC_TRACE_BEGIN("mask_image", complete_name);
+
+    /* Create a canvas to draw the newly created image to */
+    ALLEGRO_BITMAP *orig_img = DRC_IMG(name);
+    assert(orig_img);
+
+    ALLEGRO_BITMAP *canvas = al_create_bitmap(al_get_bitmap_width(orig_img), al_get_bitmap_height(orig_img));
+    assert(canvas);
+
+    draw_masked_image(canvas, name, mask);
+
+    /* Add it to the collection of resources, it's drawn again if either image changes */
+    drc_insert_derived_image_resource(complete_name, canvas, draw_masked_image, name, mask);
+
+    DRC_TRACE_END();
+
+    return canvas;
+}
+
+/* Draw the stacked image on a canvas that's the same size as the bottom image */
+static void draw_stacked_image(ALLEGRO_BITMAP *canvas, const char *bottom, const char *top)
+{
     /* Load the top image */
     ALLEGRO_BITMAP *top_img = DRC_IMG(top);
     assert(top_img);
@@ -73,10 +77,6 @@ ALLEGRO_BITMAP *get_stacked_image(const char *bottom, const char *top)
     ALLEGRO_BITMAP *bottom_img = DRC_IMG(bottom);
     assert(bottom_img);
 
-    /* Create a canvas to draw the newly created image to */
-    ALLEGRO_BITMAP *canvas = al_create_bitmap(al_get_bitmap_width(bottom_img), al_get_bitmap_height(bottom_img));
-    assert(canvas);
-
     /* STORE Allegro state */
     ALLEGRO_STATE state;
     al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
@@ -92,9 +92,36 @@ ALLEGRO_BITMAP *get_stacked_image(const char *bottom, const char *top)
 
     /* RESTORE Allegro state */
     al_restore_state(&state);
+}
+
+ALLEGRO_BITMAP *get_stacked_image(const char *bottom, const char *top)
+{
+    char complete_name[MAX_FILENAME_LEN];
+    complete_name[0] = '\0';
+    strncat(complete_name, top, MAX_FILENAME_LEN - 1);
+    strncat(complete_name, bottom, MAX_FILENAME_LEN - 1);
+
+    /* If the image has already been added, just return it */
+    ALLEGRO_BITMAP *stacked_img = DRC_IMG(complete_name);
+    if (stacked_img != NULL) {
+        return stacked_img;
+    }
+
+    DRC_TRACE_BEGIN("stack_image", complete_name);
+
+    /* Create a canvas to draw the newly created image to */
+    ALLEGRO_BITMAP *bottom_img = DRC_IMG(bottom);
+    assert(bottom_img);
+
+    ALLEGRO_BITMAP *canvas = al_create_bitmap(al_get_bitmap_width(bottom_img), al_get_bitmap_height(bottom_img));
+    assert(canvas);
+
+    draw_stacked_image(canvas, bottom, top);
+
+    /* Add it to the collection of resources, it's drawn again if either image changes */
+    drc_insert_derived_image_resource(complete_name, canvas, draw_stacked_image, bottom, top);
 
-    /* Add it to the collection of resources */
-    drc_insert_image_resource(complete_name, canvas);
+    DRC_TRACE_END();
 
     return canvas;
 }
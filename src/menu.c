@@ -1,5 +1,6 @@
 #include "compiler.h"
 #include "drc_display.h"
+#include "drc_profile.h"
 #include "drc_run.h"
 #include "drc_sound.h"
 #include "drc_sprite.h"
@@ -53,6 +54,9 @@ void control_menu(void *data, ALLEGRO_EVENT *event)
         } else if (key == ALLEGRO_KEY_F || key == ALLEGRO_KEY_U) {
             /* F : Toggle fullscreen */
             drc_toggle_fullscreen();
+        } else if (key == ALLEGRO_KEY_F3) {
+            /* F3 : Toggle frame timings */
+            drc_toggle_profile_overlay();
         } else if (key == ALLEGRO_KEY_ENTER || key == ALLEGRO_KEY_SPACE) {
             /* Start the game! */
             drc_run(control_gameplay, update_gameplay, draw_gameplay, NULL);
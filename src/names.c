@@ -0,0 +1,181 @@
+#include <allegro5/allegro.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
+#include "names.h"
+
+/* Both of these double whenever they run out */
+#define NAMES_START_SIZE (256)
+
+/* Each name, by number */
+static char **names = NULL;
+static int num_names = 0;
+static int names_size = 0;
+
+/**
+ * A hash table of name numbers, to find the number for a name.
+ * Each number is in the first free spot after where the hash of
+ * its name says it goes. It's kept no more than half full.
+ */
+static NAME_ID *name_table = NULL;
+static int name_table_size = 0;
+
+static ALLEGRO_MUTEX *names_mutex = NULL;
+
+static uint32_t hash_name(const char *name)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    for (const char *c = name; *c != '\0'; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static NAME_ID *find_name_spot(NAME_ID *table, int size, const char *name)
+{
+    int i = hash_name(name) & (size - 1);
+
+    while (table[i] != NO_NAME && strcmp(names[table[i]], name) != 0) {
+        i = (i + 1) & (size - 1);
+    }
+
+    return &table[i];
+}
+
+static void grow_name_table(void)
+{
+    int size = name_table_size > 0 ? name_table_size * 2 : NAMES_START_SIZE * 2;
+
+    NAME_ID *table = drc_alloc_memory("NAME_TABLE", size * sizeof(NAME_ID));
+    assert(table != NULL);
+
+    for (int i = 0; i < size; i++) {
+        table[i] = NO_NAME;
+    }
+
+    for (int i = 0; i < num_names; i++) {
+        *find_name_spot(table, size, names[i]) = i;
+    }
+
+    if (name_table != NULL) {
+        drc_free_memory("NAME_TABLE", name_table);
+    }
+
+    name_table = table;
+    name_table_size = size;
+}
+
+static void grow_names(void)
+{
+    int size = names_size > 0 ? names_size * 2 : NAMES_START_SIZE;
+
+    char **new_names = drc_calloc_memory("NAMES", size, sizeof(char *));
+    assert(new_names != NULL);
+
+    if (names != NULL) {
+        memcpy(new_names, names, num_names * sizeof(char *));
+        drc_free_memory("NAMES", names);
+    }
+
+    names = new_names;
+    names_size = size;
+}
+
+static void lock_names(void)
+{
+    if (names_mutex != NULL) {
+        al_lock_mutex(names_mutex);
+    }
+}
+
+static void unlock_names(void)
+{
+    if (names_mutex != NULL) {
+        al_unlock_mutex(names_mutex);
+    }
+}
+
+NAME_ID intern_name(const char *name)
+{
+    lock_names();
+
+    if ((num_names + 1) * 2 > name_table_size) {
+        grow_name_table();
+    }
+
+    NAME_ID *spot = find_name_spot(name_table, name_table_size, name);
+
+    if (*spot == NO_NAME) {
+
+        if (num_names >= MAX_NAMES) {
+            fprintf(stderr, "Failed to remember name \"%s\", try increasing MAX_NAMES.\n", name);
+            unlock_names();
+            return NO_NAME;
+        }
+
+        if (num_names == names_size) {
+            grow_names();
+        }
+
+        /* Names are never forgotten one at a time, so they're kept in the global arena */
+        names[num_names] = drc_arena_copy_string(drc_get_global_arena(), "NAMES->name", name);
+
+        *spot = num_names;
+        num_names++;
+    }
+
+    NAME_ID id = *spot;
+
+    unlock_names();
+
+    return id;
+}
+
+const char *get_name(NAME_ID id)
+{
+    if (id == NO_NAME) {
+        return "";
+    }
+
+    lock_names();
+
+    assert(id >= 0 && id < num_names);
+    const char *name = names[id];
+
+    unlock_names();
+
+    return name;
+}
+
+void share_names_between_threads(void)
+{
+    if (names_mutex == NULL) {
+        names_mutex = al_create_mutex();
+        assert(names_mutex != NULL);
+    }
+}
+
+void free_names(void)
+{
+    if (names != NULL) {
+        names = drc_free_memory("NAMES", names);
+    }
+
+    if (name_table != NULL) {
+        name_table = drc_free_memory("NAME_TABLE", name_table);
+    }
+
+    num_names = 0;
+    names_size = 0;
+    name_table_size = 0;
+
+    if (names_mutex != NULL) {
+        al_destroy_mutex(names_mutex);
+        names_mutex = NULL;
+    }
+}
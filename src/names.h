@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Image names (such as "tile-bricks.png") are kept here, only
+ * once each, and rooms refer to them by number. A room only
+ * needs a couple of bytes for each frame of each tile, instead
+ * of room for the longest possible filename.
+ *
+ * The same name always gets the same number, and a number
+ * stays good until "free_names" is called.
+ */
+typedef int16_t NAME_ID;
+
+#define NO_NAME (-1)
+
+/* NAME_ID can't count any higher */
+#define MAX_NAMES (INT16_MAX)
+
+/**
+ * The number for a name, adding it if it's new.
+ * Returns NO_NAME if there are too many names.
+ */
+NAME_ID intern_name(const char *name);
+
+/**
+ * The name for a number, or "" for NO_NAME.
+ */
+const char *get_name(NAME_ID id);
+
+/**
+ * Call this before using names on more than one thread at a time.
+ * The names stay shared until they're freed.
+ */
+void share_names_between_threads(void);
+
+void free_names(void);
@@ -1,76 +1,111 @@
+#include "drc_memory.h"
 #include "path.h"
 
-static bool is_path_between_points_recursively(bool *map, int r1, int c1, int r2, int c2)
+static bool is_open_point(ROOM *room, int r, int c)
 {
-    /* Warning, recursion ahead! */
-
-    /* If the spot is already filled in, it's not a path */
-    if (map[(r1 * COLS) + c1]) {
+    if (r < 0 || r >= room->rows || c < 0 || c >= room->cols) {
         return false;
     }
- 
-    if (map[(r2 * COLS) + c2]) {
-        return false;
+
+    int i = (r * room->cols) + c;
+
+    return room->collision_map[i] != COLLISION && room->block_map[i] == NO_BLOCK;
+}
+
+int find_reachable_points(ROOM *room, int r, int c, bool *reachable, int *points)
+{
+    /* Each spot is only added to "points" once, so it's always big enough */
+    int num_points = 0;
+    int num_reachable = 0;
+
+    for (int i = 0; i < MAX_ROOM_SIZE; i++) {
+        reachable[i] = false;
     }
- 
-    /* If the two points match, you're done! */
-    if (r1 == r2 && c1 == c2) {
-        return true;
+
+    if (!is_open_point(room, r, c)) {
+        return 0;
     }
 
-    /* Mark this spot as visited */
-    map[(r1 * COLS) + c1] = true;
-  
-    /**
-     * Trace a path through the four directions.
-     * If you find a path, then great! Stop searching.
-     * If not, keep searching and searching.
-     */
-    for (int dir = FIRST_DIRECTION; dir < LAST_DIRECTION; dir++) {
+    reachable[(r * room->cols) + c] = true;
+    points[num_points++] = (r * room->cols) + c;
 
-        int row = r1 + directions[dir].v_offset;
-        int col = c1 + directions[dir].h_offset;
+    /* Fill in the room from the first point, without recursion this time */
+    while (num_points > 0) {
 
-        /* If out of bounds, then this in NOT a valid path... */
-        if (row < 0 || row >= ROWS || col < 0 || col >= COLS) {
+        int point = points[--num_points];
+        num_reachable++;
 
-            /* Try another direction */
-            continue;
-        }
-  
-        /* If the map is NOT filled in here... */
-        if (!map[(row * COLS) + col]) {
+        for (int dir = FIRST_DIRECTION; dir < LAST_DIRECTION; dir++) {
 
-            /* Then check if it has a path to the end! If it does... */
-            if (is_path_between_points_recursively(map, row, col, r2, c2)) {
+            int row = (point / room->cols) + directions[dir].v_offset;
+            int col = (point % room->cols) + directions[dir].h_offset;
 
-                /* ...return true! */
-                return true;
+            if (is_open_point(room, row, col) && !reachable[(row * room->cols) + col]) {
+                reachable[(row * room->cols) + col] = true;
+                points[num_points++] = (row * room->cols) + col;
             }
         }
     }
-  
-    /* No paths left to try, I give up :( */
-    return false;
+
+    return num_reachable;
 }
 
-bool is_path_between_points(ROOM *room, int r1, int c1, int r2, int c2)
+void find_flow_field(FLOW_FIELD *field, ROOM *room, int r, int c)
 {
-    bool map[MAX_ROOM_SIZE];
+    /* Coming from a direction means going back the other way */
+    static const DIRECTION back[LAST_DIRECTION] = {
+        [UP] = DOWN, [DOWN] = UP, [LEFT] = RIGHT, [RIGHT] = LEFT
+    };
+
+    /* Each spot is only added once, so this is always big enough */
+    int *points = drc_alloc_frame_memory("FLOW_FIELD_POINTS", MAX_ROOM_SIZE * sizeof(int));
+    assert(points != NULL);
+
+    int first = 0;
+    int last = 0;
+
+    field->rows = room->rows;
+    field->cols = room->cols;
+    field->row = r;
+    field->col = c;
 
-    /* Setup the traversal map to match the current state of the level */
     for (int i = 0; i < MAX_ROOM_SIZE; i++) {
+        field->next[i] = NO_DIRECTION;
+    }
+
+    if (!is_open_point(room, r, c)) {
+        return;
+    }
 
-        map[i] = false;
+    /* The spot itself is marked as found by pointing anywhere, it's cleared at the end */
+    field->next[(r * room->cols) + c] = UP;
+    points[last++] = (r * room->cols) + c;
 
-        if (room->collision_map[i] == COLLISION) {
-            map[i] = true;
-        }
+    /* First in, first out, so the closest spots are found first */
+    while (first < last) {
+
+        int point = points[first++];
+
+        for (int dir = FIRST_DIRECTION; dir < LAST_DIRECTION; dir++) {
+
+            int row = (point / room->cols) + directions[dir].v_offset;
+            int col = (point % room->cols) + directions[dir].h_offset;
 
-        if (room->block_map[i] != NO_BLOCK) {
-            map[i] = true;
+            if (is_open_point(room, row, col) && field->next[(row * room->cols) + col] == NO_DIRECTION) {
+                field->next[(row * room->cols) + col] = back[dir];
+                points[last++] = (row * room->cols) + col;
+            }
         }
     }
-    
-    return is_path_between_points_recursively(map, r1, c1, r2, c2);
+
+    field->next[(r * room->cols) + c] = NO_DIRECTION;
+}
+
+DIRECTION get_flow_direction(FLOW_FIELD *field, int r, int c)
+{
+    if (r < 0 || r >= field->rows || c < 0 || c >= field->cols) {
+        return NO_DIRECTION;
+    }
+
+    return field->next[(r * field->cols) + c];
 }
@@ -3,7 +3,45 @@
 #include "gamedata.h"
 
 /**
- * Returns true if there is an unblocked path in the room
- * from the first point to the secord point.
+ * Mark every spot in the room that has an unblocked path from
+ * the given point, going up, down, left and right.
+ * "reachable" needs room for MAX_ROOM_SIZE spots, one for each
+ * row and column in the room. "points" is somewhere to keep track
+ * of the search while it's going, also with room for MAX_ROOM_SIZE.
+ * Returns the number of spots that can be reached.
  */
-bool is_path_between_points(ROOM *room, int r1, int c1, int r2, int c2);
+int find_reachable_points(ROOM *room, int r, int c, bool *reachable, int *points);
+
+/**
+ * The way to one spot in the room from everywhere else, such
+ * as for enemies that chase the hero. It takes one search to
+ * make, and then anything can find its way by looking it up.
+ */
+typedef struct
+{
+    int rows;
+    int cols;
+
+    /* The spot everything is going to */
+    int row;
+    int col;
+
+    /* Which way to go from each spot to get there, or NO_DIRECTION */
+    int8_t next[MAX_ROOM_SIZE];
+} FLOW_FIELD;
+
+/**
+ * Find the shortest way to the given spot from every other
+ * spot in the room, over the same unblocked spots as
+ * "find_reachable_points".
+ * It uses frame memory, so it's only for the game loop
+ * (see "drc_memory.h").
+ */
+void find_flow_field(FLOW_FIELD *field, ROOM *room, int r, int c);
+
+/**
+ * Which way to go from a spot to get to the spot the field
+ * was made for. Returns NO_DIRECTION if it's already there,
+ * or if there's no way to get there.
+ */
+DIRECTION get_flow_direction(FLOW_FIELD *field, int r, int c);
@@ -0,0 +1,351 @@
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include "datafile.h"
+#include "drc_memory.h"
+#include "drc_path_cache.h"
+#include "drc_resources.h"
+#include "drc_sprite.h"
+#include "preload.h"
+#include "roomfile.h"
+
+typedef struct
+{
+    /* The room, compiled, or NULL if it couldn't be read */
+    unsigned char *data;
+    long size;
+
+    int num_problems;
+} PRELOADED_ROOM;
+
+/* One for each room in the room list */
+static PRELOADED_ROOM *preloaded_rooms = NULL;
+static int num_preloaded_rooms = 0;
+
+/* Stats, from the last time the rooms were preloaded */
+static int preload_num_threads = 0;
+static double preload_wall_time = 0;
+static long preload_total_size = 0;
+
+/* How long it took on just one thread, or less than 0 if it wasn't timed */
+static double preload_serial_time = -1;
+
+/* The problems were already printed the first time through */
+static bool is_printing_problems = true;
+
+/**
+ * The rooms still waiting to be read.
+ * Each thread takes the next room until there are none left.
+ */
+typedef struct
+{
+    ROOM_LIST *room_list;
+    int next_room;
+    ALLEGRO_MUTEX *mutex;
+} PRELOAD_JOB;
+
+static void print_room_problem(const char *filename, int *num_problems, const char *problem)
+{
+    if (is_printing_problems) {
+        fprintf(stderr, "%s: %s\n", filename, problem);
+    }
+    (*num_problems)++;
+}
+
+static void check_tile_map(const char *filename, ROOM *room, ROOM_CELL *map, const char *name, int *num_problems)
+{
+    for (int i = 0; i < room->rows * room->cols; i++) {
+        if (map[i] != NO_TILE && (map[i] < 0 || map[i] >= room->num_tiles)) {
+            char problem[MAX_STRING_SIZE];
+            snprintf(problem, MAX_STRING_SIZE, "The %s map uses tile %d, but there are only %d tiles.", name, map[i], room->num_tiles);
+            print_room_problem(filename, num_problems, problem);
+            return;
+        }
+    }
+}
+
+static void check_texture_defs(const char *filename, TEXTURE_DEF *texture_defs, int len, int *num_problems)
+{
+    char fullpath[MAX_FILEPATH_LEN];
+
+    for (int i = 0; i < len; i++) {
+        for (int j = 0; j < texture_defs[i].len; j++) {
+            const char *frame = get_name(texture_defs[i].frames[j]);
+            if (!drc_find_resource_file(frame, fullpath, MAX_FILEPATH_LEN)) {
+                char problem[MAX_STRING_SIZE];
+                snprintf(problem, MAX_STRING_SIZE, "Failed to find image \"%s\".", frame);
+                print_room_problem(filename, num_problems, problem);
+            }
+        }
+    }
+}
+
+static bool is_in_room(ROOM *room, int row, int col)
+{
+    return row >= 0 && row < room->rows && col >= 0 && col < room->cols;
+}
+
+/**
+ * Make sure everything the room refers to is really there.
+ * Returns the number of problems found.
+ */
+static int check_room(const char *filename, ROOM *room)
+{
+    int num_problems = 0;
+    char problem[MAX_STRING_SIZE];
+
+    check_texture_defs(filename, room->tile_defs, room->num_tiles, &num_problems);
+    check_texture_defs(filename, room->texture_defs, room->num_texture_defs, &num_problems);
+
+    check_tile_map(filename, room, room->farground_map, "farground", &num_problems);
+    check_tile_map(filename, room, room->background_map, "background", &num_problems);
+    check_tile_map(filename, room, room->foreground_map, "foreground", &num_problems);
+
+    for (int i = 0; i < room->rows * room->cols; i++) {
+        int block = room->block_map_orig[i];
+        if (block == NO_BLOCK) {
+            continue;
+        }
+        if ((block == RANDOM_BLOCK && room->num_texture_defs == 0) || (block != RANDOM_BLOCK && (block < 0 || block >= room->num_texture_defs))) {
+            snprintf(problem, MAX_STRING_SIZE, "The blocks map uses texture %d, but there are only %d textures.", block, room->num_texture_defs);
+            print_room_problem(filename, &num_problems, problem);
+            break;
+        }
+    }
+
+    if (!is_in_room(room, room->start_y / TILE_SIZE, room->start_x / TILE_SIZE)) {
+        print_room_problem(filename, &num_problems, "The hero starts outside of the room.");
+    }
+
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        ENEMY_DEFINITION *definition = &room->enemy_definitions[i];
+        if (!definition->is_active) {
+            continue;
+        }
+        if (definition->type == ENEMY_TYPE_NONE) {
+            snprintf(problem, MAX_STRING_SIZE, "Enemy %d doesn't have a type.", i + 1);
+            print_room_problem(filename, &num_problems, problem);
+        }
+        if (!is_in_room(room, definition->row, definition->col)) {
+            snprintf(problem, MAX_STRING_SIZE, "Enemy %d is outside of the room.", i + 1);
+            print_room_problem(filename, &num_problems, problem);
+        }
+    }
+
+    for (int i = 0; i < MAX_EXITS; i++) {
+        EXIT *exit = &room->exits[i];
+        if (!exit->active) {
+            continue;
+        }
+        if (exit->direction < FIRST_DIRECTION || exit->direction >= LAST_DIRECTION) {
+            snprintf(problem, MAX_STRING_SIZE, "Exit %d doesn't go anywhere.", i + 1);
+            print_room_problem(filename, &num_problems, problem);
+        }
+        if (!is_in_room(room, exit->row, exit->col)) {
+            snprintf(problem, MAX_STRING_SIZE, "Exit %d is outside of the room.", i + 1);
+            print_room_problem(filename, &num_problems, problem);
+        }
+    }
+
+    return num_problems;
+}
+
+static void preload_room(const char *filename, ROOM *room, PRELOADED_ROOM *preloaded)
+{
+    init_room(room);
+
+    if (read_room_with_filename(filename, room)) {
+        preloaded->num_problems = check_room(filename, room);
+        preloaded->data = compile_room(room, &preloaded->size);
+    } else {
+        print_room_problem(filename, &preloaded->num_problems, "Failed to read room.");
+    }
+}
+
+static void *preload_rooms_thread(ALLEGRO_THREAD *thread, void *arg)
+{
+    PRELOAD_JOB *job = arg;
+
+    (void)thread;
+
+    /* Much too big to go on the stack */
+    ROOM *room = drc_calloc_memory("PRELOAD_ROOM", 1, sizeof(ROOM));
+    assert(room != NULL);
+
+    while (true) {
+
+        al_lock_mutex(job->mutex);
+        int room_num = job->next_room;
+        job->next_room++;
+        al_unlock_mutex(job->mutex);
+
+        if (room_num >= job->room_list->size) {
+            break;
+        }
+
+        preload_room(job->room_list->filenames[room_num], room, &preloaded_rooms[room_num]);
+    }
+
+    drc_free_memory("PRELOAD_ROOM", room);
+
+    return NULL;
+}
+
+/**
+ * Read every room in the list on "num_threads" threads.
+ * Returns the number of threads that really ran.
+ */
+static int run_preload_job(ROOM_LIST *room_list, int num_threads)
+{
+    PRELOAD_JOB job = {room_list, 0, al_create_mutex()};
+    assert(job.mutex != NULL);
+
+    ALLEGRO_THREAD *threads[MAX_PRELOAD_THREADS];
+    int num_started = 0;
+
+    for (int i = 0; i < num_threads; i++) {
+        threads[num_started] = al_create_thread(preload_rooms_thread, &job);
+        if (threads[num_started] != NULL) {
+            al_start_thread(threads[num_started]);
+            num_started++;
+        }
+    }
+
+    /* If no threads could be started, just do it here */
+    if (num_started == 0) {
+        preload_rooms_thread(NULL, &job);
+    }
+
+    for (int i = 0; i < num_started; i++) {
+        al_join_thread(threads[i], NULL);
+        al_destroy_thread(threads[i]);
+    }
+
+    al_destroy_mutex(job.mutex);
+
+    return num_started > 0 ? num_started : 1;
+}
+
+/* Forget the compiled rooms, but keep room for them */
+static void clear_preloaded_rooms(int num_rooms)
+{
+    for (int i = 0; i < num_rooms; i++) {
+        if (preloaded_rooms[i].data != NULL) {
+            free_compiled_room(preloaded_rooms[i].data);
+        }
+        preloaded_rooms[i] = (PRELOADED_ROOM){NULL, 0, 0};
+    }
+}
+
+int preload_room_list(ROOM_LIST *room_list, int num_threads, bool is_timing_one_thread)
+{
+    free_preloaded_rooms();
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    } else if (num_threads > MAX_PRELOAD_THREADS) {
+        num_threads = MAX_PRELOAD_THREADS;
+    }
+    if (num_threads > room_list->size) {
+        num_threads = room_list->size;
+    }
+
+    share_import_cache_between_threads();
+    share_names_between_threads();
+    drc_share_path_cache_between_threads();
+    drc_share_animations_between_threads();
+
+    if (room_list->size > 0) {
+        preloaded_rooms = drc_calloc_memory("PRELOADED_ROOMS", room_list->size, sizeof(PRELOADED_ROOM));
+        assert(preloaded_rooms != NULL);
+    }
+
+    preload_serial_time = -1;
+
+    /**
+     * Read them all on just one thread first, to see how much the
+     * threads really help. This warms up the caches for the threads,
+     * so it's a little unfair to the one thread.
+     */
+    if (is_timing_one_thread && room_list->size > 0) {
+        is_printing_problems = false;
+
+        double serial_start = al_get_time();
+        run_preload_job(room_list, 1);
+        preload_serial_time = al_get_time() - serial_start;
+
+        clear_preloaded_rooms(room_list->size);
+        is_printing_problems = true;
+    }
+
+    double start = al_get_time();
+
+    preload_num_threads = run_preload_job(room_list, num_threads);
+    preload_wall_time = al_get_time() - start;
+
+    num_preloaded_rooms = room_list->size;
+
+    preload_total_size = 0;
+
+    int num_problem_rooms = 0;
+
+    for (int i = 0; i < num_preloaded_rooms; i++) {
+        preload_total_size += preloaded_rooms[i].size;
+        if (preloaded_rooms[i].num_problems > 0) {
+            num_problem_rooms++;
+        }
+    }
+
+    if (num_problem_rooms > 0) {
+        fprintf(stderr, "%d rooms have problems.\n", num_problem_rooms);
+    }
+
+    return num_problem_rooms;
+}
+
+bool read_preloaded_room(int room_num, ROOM *room)
+{
+    if (room_num < 0 || room_num >= num_preloaded_rooms || preloaded_rooms[room_num].data == NULL) {
+        return false;
+    }
+
+    PRELOADED_ROOM *preloaded = &preloaded_rooms[room_num];
+
+    init_room(room);
+
+    if (!read_compiled_room(preloaded->data, preloaded->size, room)) {
+        /* Don't leave half a room behind for whatever's tried next */
+        init_room(room);
+        return false;
+    }
+
+    return true;
+}
+
+void print_preload_stats(void)
+{
+    if (num_preloaded_rooms == 0) {
+        return;
+    }
+
+    printf("Preloaded %d rooms (%ld bytes) on %d threads in %.2f ms.\n",
+        num_preloaded_rooms, preload_total_size, preload_num_threads, preload_wall_time * 1000.0);
+
+    if (preload_serial_time >= 0) {
+        printf("The same rooms took %.2f ms on one thread.\n", preload_serial_time * 1000.0);
+    }
+}
+
+void free_preloaded_rooms(void)
+{
+    for (int i = 0; i < num_preloaded_rooms; i++) {
+        if (preloaded_rooms[i].data != NULL) {
+            free_compiled_room(preloaded_rooms[i].data);
+        }
+    }
+
+    if (preloaded_rooms != NULL) {
+        preloaded_rooms = drc_free_memory("PRELOADED_ROOMS", preloaded_rooms);
+    }
+
+    num_preloaded_rooms = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "roomlist.h"
+
+/**
+ * Read every room in a room list ahead of time, on a few
+ * threads at once, and check each one for mistakes (such as
+ * a missing tile image or an exit outside of the room) so a
+ * broken room is found when the game starts instead of when
+ * the player gets to it.
+ *
+ * Each room is kept as a compiled room in memory (see
+ * "roomfile.h"), which is small and quick to read, so
+ * changing rooms doesn't need to read any files.
+ */
+
+/* More threads than this won't help, there aren't that many rooms */
+#define MAX_PRELOAD_THREADS (16)
+
+/**
+ * Read and check every room in the list, using up to "num_threads"
+ * threads. Any rooms that were already preloaded are forgotten first.
+ * If "is_timing_one_thread", they're all read on one thread first
+ * too, just to see how long that takes.
+ * Returns the number of rooms with problems.
+ */
+int preload_room_list(ROOM_LIST *room_list, int num_threads, bool is_timing_one_thread);
+
+/**
+ * Print how long the rooms took to preload, and how
+ * long they took on one thread if that was timed.
+ */
+void print_preload_stats(void);
+
+/**
+ * Read a room that was preloaded, by room number in the list
+ * that was preloaded. It still needs to be finished with
+ * "finish_loading_room" before it's used.
+ * Returns false if the room wasn't preloaded (or it
+ * couldn't be read), so it should be read normally.
+ * If it couldn't be read, the room is left cleared.
+ */
+bool read_preloaded_room(int room_num, ROOM *room);
+
+void free_preloaded_rooms(void);
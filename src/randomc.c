@@ -0,0 +1,201 @@
+/**
+ * The random number checker.
+ *
+ * Makes sure the random numbers are the same every time for the
+ * same seed, and the same as the PCG32 reference ("pcg32-demo"),
+ * so a game can be played again exactly the same way anywhere.
+ * It exits with 1 if they aren't ("make check-random").
+ *
+ *   randomc
+ *
+ * With "-t" it times how fast random numbers are made, compared
+ * to "rand()" ("make bench-random").
+ *
+ *   randomc -t
+ */
+
+#include <allegro5/allegro.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drc_memory.h"
+#include "drc_random.h"
+
+/* How many numbers to make when timing */
+#define NUM_TIMING_NUMBERS (10000000)
+
+/* How many numbers to compare between two runs */
+#define NUM_CHECK_NUMBERS (4096)
+
+/* The first numbers from "pcg32-demo", seeded with 42 and sequence 54 */
+static const uint32_t reference_numbers[] = {
+    0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e
+};
+
+#define NUM_REFERENCE_NUMBERS ((int)(sizeof(reference_numbers) / sizeof(reference_numbers[0])))
+
+/* Keeps the compiler from skipping the work when timing */
+static volatile uint32_t sink = 0;
+
+static bool check_reference_numbers(void)
+{
+    DRC_RANDOM random;
+    drc_seed_random_generator(&random, 42, 54);
+
+    for (int i = 0; i < NUM_REFERENCE_NUMBERS; i++) {
+        uint32_t n = drc_next_random(&random);
+        if (n != reference_numbers[i]) {
+            fprintf(stderr, "Number %d is 0x%08" PRIx32 ", it should be 0x%08" PRIx32 ".\n", i + 1, n, reference_numbers[i]);
+            return false;
+        }
+    }
+
+    printf("The numbers match the PCG32 reference.\n");
+
+    return true;
+}
+
+/* Make numbers from every stream, the same way the game does */
+static void make_stream_numbers(uint64_t seed, uint32_t *numbers)
+{
+    drc_seed_random(seed);
+
+    int len = NUM_CHECK_NUMBERS / DRC_NUM_RANDOM_STREAMS;
+
+    for (int i = 0; i < DRC_NUM_RANDOM_STREAMS; i++) {
+        uint32_t *stream_numbers = &numbers[i * len];
+        for (int j = 0; j < len / 2; j++) {
+            stream_numbers[j] = (uint32_t)drc_random_number_from(i, 0, 999);
+        }
+        drc_fill_random_from(i, &stream_numbers[len / 2], len - (len / 2));
+    }
+}
+
+static bool check_streams(void)
+{
+    uint32_t *first = drc_calloc_memory("RANDOM_NUMBERS", NUM_CHECK_NUMBERS, sizeof(uint32_t));
+    uint32_t *second = drc_calloc_memory("RANDOM_NUMBERS", NUM_CHECK_NUMBERS, sizeof(uint32_t));
+    assert(first != NULL && second != NULL);
+
+    bool success = true;
+
+    make_stream_numbers(12345, first);
+    make_stream_numbers(12345, second);
+
+    if (memcmp(first, second, NUM_CHECK_NUMBERS * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "The same seed made different numbers.\n");
+        success = false;
+    }
+
+    /* Every stream should be different from the others */
+    int len = NUM_CHECK_NUMBERS / DRC_NUM_RANDOM_STREAMS;
+
+    for (int i = 1; i < DRC_NUM_RANDOM_STREAMS; i++) {
+        if (memcmp(first, &first[i * len], len * sizeof(uint32_t)) == 0) {
+            fprintf(stderr, "Stream %d made the same numbers as stream 0.\n", i);
+            success = false;
+        }
+    }
+
+    make_stream_numbers(54321, second);
+
+    if (memcmp(first, second, NUM_CHECK_NUMBERS * sizeof(uint32_t)) == 0) {
+        fprintf(stderr, "A different seed made the same numbers.\n");
+        success = false;
+    }
+
+    for (int i = 0; i < len / 2; i++) {
+        if (first[i] > 999) {
+            fprintf(stderr, "Number %d is %" PRIu32 ", it should be from 0 to 999.\n", i + 1, first[i]);
+            success = false;
+            break;
+        }
+    }
+
+    if (success) {
+        printf("The same seed makes the same numbers, in %d streams.\n", DRC_NUM_RANDOM_STREAMS);
+    }
+
+    drc_free_memory("RANDOM_NUMBERS", first);
+    drc_free_memory("RANDOM_NUMBERS", second);
+
+    return success;
+}
+
+static void print_time(const char *name, double start)
+{
+    double ns = ((al_get_time() - start) / NUM_TIMING_NUMBERS) * 1000000000.0;
+    printf("%-28s %6.2f ns per number\n", name, ns);
+}
+
+static int benchmark_random(void)
+{
+    double start;
+    uint32_t total = 0;
+
+    drc_seed_random(1);
+    srand(1);
+
+    start = al_get_time();
+    for (int i = 0; i < NUM_TIMING_NUMBERS; i++) {
+        total += (uint32_t)((rand() % 6) + 1);
+    }
+    print_time("rand() % 6", start);
+
+    start = al_get_time();
+    for (int i = 0; i < NUM_TIMING_NUMBERS; i++) {
+        total += (uint32_t)drc_random_number(1, 6);
+    }
+    print_time("drc_random_number(1, 6)", start);
+
+    DRC_RANDOM random;
+    drc_seed_random_generator(&random, 1, 0);
+
+    start = al_get_time();
+    for (int i = 0; i < NUM_TIMING_NUMBERS; i++) {
+        total += drc_next_random(&random);
+    }
+    print_time("drc_next_random", start);
+
+    uint32_t *numbers = drc_calloc_memory("RANDOM_NUMBERS", NUM_TIMING_NUMBERS, sizeof(uint32_t));
+    assert(numbers != NULL);
+
+    start = al_get_time();
+    drc_fill_random(&random, numbers, NUM_TIMING_NUMBERS);
+    print_time("drc_fill_random", start);
+
+    total += numbers[NUM_TIMING_NUMBERS - 1];
+    drc_free_memory("RANDOM_NUMBERS", numbers);
+
+    sink = total;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (!al_init()) {
+        fprintf(stderr, "Failed to initialize Allegro.\n");
+        return 1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "-t") == 0) {
+        return benchmark_random();
+    }
+
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        fprintf(stderr, "       %s -t\n", argv[0]);
+        return 1;
+    }
+
+    bool success = check_reference_numbers();
+    success = check_streams() && success;
+
+    drc_check_memory();
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,331 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "datafile.h"
+#include "drc_memory.h"
+#include "roombundle.h"
+#include "roomfile.h"
+
+static const char ROOM_BUNDLE_MAGIC[4] = {'C', 'W', 'R', 'I'};
+
+/* The size of the offset and size of one room in the index */
+#define INDEX_RECORD_SIZE (8)
+
+/**
+ * A room that was read from the bundle,
+ * still compiled (see "roomfile.h").
+ */
+typedef struct
+{
+    int room_num;
+    unsigned char *data;
+    long size;
+
+    /* When it was last used, to find the oldest room */
+    int last_used;
+} BUNDLE_CACHE_ENTRY;
+
+static FILE *index_file = NULL;
+static FILE *bundle_file = NULL;
+
+static int num_bundle_rooms = 0;
+
+/* Where in the index the offset and size of the first room are */
+static long first_record_pos = 0;
+
+static BUNDLE_CACHE_ENTRY bundle_cache[ROOM_BUNDLE_CACHE_SIZE];
+static int bundle_cache_time = 0;
+
+static bool read_bytes(FILE *file, unsigned char *bytes, int len)
+{
+    return (int)fread(bytes, 1, len, file) == len;
+}
+
+static uint32_t get_u32(const unsigned char *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void write_u16(FILE *file, int value)
+{
+    fputc(value & 0xFF, file);
+    fputc((value >> 8) & 0xFF, file);
+}
+
+static void write_u32(FILE *file, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        fputc((value >> (i * 8)) & 0xFF, file);
+    }
+}
+
+static void forget_bundle_room(BUNDLE_CACHE_ENTRY *entry)
+{
+    if (entry->data != NULL) {
+        free_compiled_room(entry->data);
+    }
+
+    entry->room_num = -1;
+    entry->data = NULL;
+    entry->size = 0;
+    entry->last_used = 0;
+}
+
+void close_room_bundle(void)
+{
+    if (index_file != NULL) {
+        close_data_file(index_file);
+        index_file = NULL;
+    }
+
+    if (bundle_file != NULL) {
+        close_data_file(bundle_file);
+        bundle_file = NULL;
+    }
+
+    for (int i = 0; i < ROOM_BUNDLE_CACHE_SIZE; i++) {
+        forget_bundle_room(&bundle_cache[i]);
+    }
+
+    bundle_cache_time = 0;
+    num_bundle_rooms = 0;
+}
+
+bool open_room_bundle(const char *index_filename)
+{
+    close_room_bundle();
+
+    index_file = open_data_file_with_mode(index_filename, "rb");
+
+    if (index_file == NULL) {
+        fprintf(stderr, "Failed to open room bundle index \"%s\".\n", index_filename);
+        return false;
+    }
+
+    /* Magic, version, flags and the length of the bundle filename */
+    unsigned char header[10];
+
+    if (!read_bytes(index_file, header, 10) || memcmp(header, ROOM_BUNDLE_MAGIC, 4) != 0 ||
+            (header[4] | (header[5] << 8)) != ROOM_BUNDLE_VERSION) {
+        fprintf(stderr, "Failed to read room bundle index \"%s\", it's not an index or it's from an old version of the game.\n", index_filename);
+        close_room_bundle();
+        return false;
+    }
+
+    int len = header[8] | (header[9] << 8);
+    char bundle_filename[MAX_FILENAME_LEN];
+    unsigned char count[4];
+
+    if (len >= MAX_FILENAME_LEN || !read_bytes(index_file, (unsigned char *)bundle_filename, len) || !read_bytes(index_file, count, 4)) {
+        fprintf(stderr, "Failed to read room bundle index \"%s\".\n", index_filename);
+        close_room_bundle();
+        return false;
+    }
+
+    bundle_filename[len] = '\0';
+
+    bundle_file = open_data_file_with_mode(bundle_filename, "rb");
+
+    if (bundle_file == NULL) {
+        fprintf(stderr, "Failed to open room bundle \"%s\".\n", bundle_filename);
+        close_room_bundle();
+        return false;
+    }
+
+    /* The rest of the index is only read one room at a time */
+    num_bundle_rooms = get_u32(count);
+    first_record_pos = ftell(index_file);
+
+    return true;
+}
+
+int get_num_bundle_rooms(void)
+{
+    return num_bundle_rooms;
+}
+
+/**
+ * Forget rooms that are far behind the room that's being loaded,
+ * the player probably won't go back to them.
+ */
+static void forget_old_bundle_rooms(int room_num)
+{
+    for (int i = 0; i < ROOM_BUNDLE_CACHE_SIZE; i++) {
+        if (bundle_cache[i].data != NULL && bundle_cache[i].room_num < room_num - ROOM_BUNDLE_KEEP_BEHIND) {
+            forget_bundle_room(&bundle_cache[i]);
+        }
+    }
+}
+
+static BUNDLE_CACHE_ENTRY *find_bundle_room(int room_num)
+{
+    for (int i = 0; i < ROOM_BUNDLE_CACHE_SIZE; i++) {
+        if (bundle_cache[i].data != NULL && bundle_cache[i].room_num == room_num) {
+            return &bundle_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* An empty entry, or else the one that was used longest ago */
+static BUNDLE_CACHE_ENTRY *get_free_bundle_cache_entry(void)
+{
+    BUNDLE_CACHE_ENTRY *oldest = &bundle_cache[0];
+
+    for (int i = 0; i < ROOM_BUNDLE_CACHE_SIZE; i++) {
+        if (bundle_cache[i].data == NULL) {
+            return &bundle_cache[i];
+        }
+        if (bundle_cache[i].last_used < oldest->last_used) {
+            oldest = &bundle_cache[i];
+        }
+    }
+
+    forget_bundle_room(oldest);
+
+    return oldest;
+}
+
+static BUNDLE_CACHE_ENTRY *read_bundle_room(int room_num)
+{
+    unsigned char record[INDEX_RECORD_SIZE];
+
+    if (fseek(index_file, first_record_pos + ((long)room_num * INDEX_RECORD_SIZE), SEEK_SET) != 0 ||
+            !read_bytes(index_file, record, INDEX_RECORD_SIZE)) {
+        return NULL;
+    }
+
+    long offset = get_u32(record);
+    long size = get_u32(record + 4);
+
+    if (size <= 0 || fseek(bundle_file, offset, SEEK_SET) != 0) {
+        return NULL;
+    }
+
+    unsigned char *data = drc_alloc_memory("ROOM_FILE", size);
+    assert(data != NULL);
+
+    if (!read_bytes(bundle_file, data, size)) {
+        free_compiled_room(data);
+        return NULL;
+    }
+
+    BUNDLE_CACHE_ENTRY *entry = get_free_bundle_cache_entry();
+
+    entry->room_num = room_num;
+    entry->data = data;
+    entry->size = size;
+
+    return entry;
+}
+
+bool read_room_from_bundle(int room_num, ROOM *room)
+{
+    if (room_num < 0 || room_num >= num_bundle_rooms) {
+        return false;
+    }
+
+    forget_old_bundle_rooms(room_num);
+
+    BUNDLE_CACHE_ENTRY *entry = find_bundle_room(room_num);
+
+    if (entry == NULL) {
+        entry = read_bundle_room(room_num);
+    }
+
+    init_room(room);
+
+    if (entry == NULL || !read_compiled_room(entry->data, entry->size, room)) {
+        fprintf(stderr, "Failed to read room %d from the room bundle.\n", room_num + 1);
+        /* Don't leave half a room behind for whatever's tried next */
+        init_room(room);
+        return false;
+    }
+
+    bundle_cache_time++;
+    entry->last_used = bundle_cache_time;
+
+    return true;
+}
+
+/* This is much too big to go on the stack */
+static ROOM bundle_room;
+
+bool write_room_bundle(ROOM_LIST *room_list, const char *bundle_filename, const char *index_filename)
+{
+    FILE *bundle = fopen(bundle_filename, "wb");
+    FILE *index = fopen(index_filename, "wb");
+
+    if (bundle == NULL || index == NULL) {
+        fprintf(stderr, "Failed to open \"%s\" and \"%s\" to save the room bundle.\n", bundle_filename, index_filename);
+        if (bundle != NULL) {
+            fclose(bundle);
+        }
+        if (index != NULL) {
+            fclose(index);
+        }
+        return false;
+    }
+
+    /* The index only needs the name of the bundle, it's found using the datafile paths */
+    const char *name = strrchr(bundle_filename, '/');
+    name = name != NULL ? name + 1 : bundle_filename;
+
+    fwrite(ROOM_BUNDLE_MAGIC, 1, 4, index);
+    write_u16(index, ROOM_BUNDLE_VERSION);
+    write_u16(index, 0);
+    write_u16(index, strlen(name));
+    fwrite(name, 1, strlen(name), index);
+    write_u32(index, room_list->size);
+
+    bool success = true;
+    long offset = 0;
+
+    for (int i = 0; i < room_list->size && success; i++) {
+
+        init_room(&bundle_room);
+
+        if (!read_room_with_filename(room_list->filenames[i], &bundle_room)) {
+            fprintf(stderr, "Failed to read room \"%s\" for the room bundle.\n", room_list->filenames[i]);
+            success = false;
+            break;
+        }
+
+        long size = 0;
+        unsigned char *data = compile_room(&bundle_room, &size);
+
+        success = (long)fwrite(data, 1, size, bundle) == size;
+
+        free_compiled_room(data);
+
+        write_u32(index, offset);
+        write_u32(index, size);
+
+        offset += size;
+    }
+
+    if (ferror(index) || ferror(bundle)) {
+        success = false;
+    }
+    if (fclose(bundle) != 0) {
+        success = false;
+    }
+    if (fclose(index) != 0) {
+        success = false;
+    }
+
+    if (!success) {
+        remove(bundle_filename);
+        remove(index_filename);
+    }
+
+    return success;
+}
+
+bool is_room_bundle_index(const char *filename)
+{
+    int len = strlen(filename);
+
+    return len >= 6 && strcmp(filename + len - 6, ".index") == 0;
+}
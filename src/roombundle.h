@@ -0,0 +1,70 @@
+#pragma once
+
+#include "roomlist.h"
+
+/**
+ * A room bundle is a lot of compiled rooms (see "roomfile.h")
+ * packed one after the other into one file, with an index file
+ * that says where each room is in the bundle. A campaign with
+ * thousands of rooms can be played from a bundle without reading
+ * all of them, or even the whole index, when the game starts.
+ *
+ * The layout of an index (all numbers are little endian):
+ *
+ *   "CWRI"                                  Magic
+ *   u16 version, u16 flags                  See ROOM_BUNDLE_VERSION
+ *   string bundle filename                  Found using datafile paths
+ *   u32 num_rooms
+ *   u32 offset, u32 size                    For each room, where it is
+ *                                           in the bundle
+ *
+ * A string is a u16 length followed by that many characters.
+ *
+ * Only one bundle is open at a time. Rooms are read from it when
+ * they're needed, and a few of them are kept in memory in case
+ * they're needed again (such as when the hero dies). Rooms that
+ * are far behind the player are forgotten first.
+ */
+
+/* Change this whenever the layout of an index changes */
+#define ROOM_BUNDLE_VERSION (1)
+
+/* The number of rooms kept in memory */
+#define ROOM_BUNDLE_CACHE_SIZE (4)
+
+/* Rooms more than this far behind the room being loaded are forgotten */
+#define ROOM_BUNDLE_KEEP_BEHIND (1)
+
+/**
+ * Open the room bundle described by an index file, taking into
+ * account datafile paths. Any bundle that is already open is closed.
+ * Returns false if it couldn't be opened.
+ */
+bool open_room_bundle(const char *index_filename);
+void close_room_bundle(void);
+
+/**
+ * The number of rooms in the open bundle,
+ * or 0 if there isn't one open.
+ */
+int get_num_bundle_rooms(void);
+
+/**
+ * Read a room from the open bundle. It still needs to be
+ * finished with "finish_loading_room" before it's used.
+ * Returns false if it couldn't be read, and the room is
+ * left cleared so it can be read some other way.
+ */
+bool read_room_from_bundle(int room_num, ROOM *room);
+
+/**
+ * Compile every room in a room list into a new bundle and index.
+ * The rooms are read with "read_room_with_filename".
+ * Returns true on success.
+ */
+bool write_room_bundle(ROOM_LIST *room_list, const char *bundle_filename, const char *index_filename);
+
+/**
+ * True if the filename looks like the index of a room bundle (".index").
+ */
+bool is_room_bundle_index(const char *filename);
@@ -0,0 +1,400 @@
+/**
+ * The room compiler.
+ *
+ * Reads a room data file (and every file that it imports)
+ * and saves it as a compiled room (see "roomfile.h"), then
+ * reports how long it takes to read the room both ways.
+ *
+ *   roomc data/levels/room-story-001.dat room-story-001.room
+ *
+ * With "-t" it just times reading the text data files, to
+ * see how fast the datafile parser is ("make bench-rooms").
+ *
+ *   roomc -t data/levels/room-*.dat
+ *
+ * With "-b" it compiles every room in a room list into a room
+ * bundle and its index (see "roombundle.h").
+ *
+ *   roomc -b data/levels/list-story.dat list-story.bundle list-story.index
+ *
+ * With "-u" it compiles every room in a room list into a directory,
+ * but only the rooms that changed since they were last compiled
+ * ("make update-rooms"). The room data file, its Tiled map and
+ * the files that the room imports are all checked.
+ *
+ *   roomc -u data/levels/list-story.dat data/levels
+ *
+ * Rooms drawn in Tiled are found in COLORWANDCASTLE_TILED_PATH,
+ * the same as in the game (see "tmxfile.h").
+ */
+
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datafile.h"
+#include "roombundle.h"
+#include "roomfile.h"
+
+/* Each room is read this many times, to get a good average */
+#define NUM_TIMING_RUNS (50)
+
+/* These are much too big to go on the stack */
+static ROOM text_room;
+static ROOM compiled_room;
+
+static bool texture_defs_match(TEXTURE_DEF *a, TEXTURE_DEF *b)
+{
+    if (a->len != b->len || a->speed != b->speed || a->loop != b->loop) {
+        return false;
+    }
+
+    for (int i = 0; i < a->len; i++) {
+        if (a->frames[i] != b->frames[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool maps_match(ROOM_CELL *a, ROOM_CELL *b, int size)
+{
+    return memcmp(a, b, size * sizeof(ROOM_CELL)) == 0;
+}
+
+/**
+ * Make sure that the compiled room is read back
+ * exactly the same as the text data file.
+ */
+static bool rooms_match(ROOM *a, ROOM *b)
+{
+    if (strcmp(a->title, b->title) != 0 || strcmp(a->music, b->music) != 0 ||
+            a->rows != b->rows || a->cols != b->cols ||
+            a->start_x != b->start_x || a->start_y != b->start_y ||
+            a->direction != b->direction || a->facing != b->facing ||
+            a->num_tiles != b->num_tiles || a->num_texture_defs != b->num_texture_defs ||
+            a->num_imports != b->num_imports) {
+        return false;
+    }
+
+    for (int i = 0; i < a->num_imports; i++) {
+        if (a->imports[i] != b->imports[i]) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < a->num_tiles; i++) {
+        if (!texture_defs_match(&a->tile_defs[i], &b->tile_defs[i])) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < a->num_texture_defs; i++) {
+        if (!texture_defs_match(&a->texture_defs[i], &b->texture_defs[i])) {
+            return false;
+        }
+    }
+
+    int size = a->rows * a->cols;
+
+    if (!maps_match(a->farground_map, b->farground_map, size) ||
+            !maps_match(a->background_map, b->background_map, size) ||
+            !maps_match(a->foreground_map, b->foreground_map, size) ||
+            !maps_match(a->collision_map, b->collision_map, size) ||
+            !maps_match(a->block_map_orig, b->block_map_orig, size)) {
+        return false;
+    }
+
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        ENEMY_DEFINITION *da = &a->enemy_definitions[i];
+        ENEMY_DEFINITION *db = &b->enemy_definitions[i];
+        if (da->is_active != db->is_active) {
+            return false;
+        }
+        if (da->is_active && (da->type != db->type || da->row != db->row ||
+                da->col != db->col || da->speed != db->speed || da->dist != db->dist)) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < MAX_EXITS; i++) {
+        EXIT *ea = &a->exits[i];
+        EXIT *eb = &b->exits[i];
+        if (ea->active != eb->active) {
+            return false;
+        }
+        if (ea->active && (ea->direction != eb->direction || ea->row != eb->row || ea->col != eb->col)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Average time, in milliseconds, to read the room from the text data file.
+ * Imported files are read every time, instead of being remembered.
+ */
+static double time_text_room(const char *filename)
+{
+    double total = 0;
+
+    for (int i = 0; i < NUM_TIMING_RUNS; i++) {
+        init_room(&text_room);
+        free_import_cache();
+        double start = al_get_time();
+        read_room_from_datafile_with_filename(filename, &text_room);
+        total += al_get_time() - start;
+    }
+
+    return (total / NUM_TIMING_RUNS) * 1000.0;
+}
+
+/* Average time, in milliseconds, to read the compiled room */
+static double time_compiled_room(const char *filename)
+{
+    double total = 0;
+
+    for (int i = 0; i < NUM_TIMING_RUNS; i++) {
+        init_room(&compiled_room);
+        double start = al_get_time();
+        read_room_file(filename, &compiled_room);
+        total += al_get_time() - start;
+    }
+
+    return (total / NUM_TIMING_RUNS) * 1000.0;
+}
+
+/**
+ * Look for files imported by the room next to it.
+ * Returns the name of the room file without the directory.
+ */
+static const char *add_room_directory(const char *input)
+{
+    static char dir[MAX_FILENAME_LEN * 4];
+    const char *name = strrchr(input, '/');
+
+    if (name != NULL) {
+        name++;
+        snprintf(dir, sizeof(dir), "%.*s", (int)(name - input), input);
+    } else {
+        name = input;
+        dir[0] = '\0';
+    }
+
+    add_datafile_path(dir);
+
+    return name;
+}
+
+/**
+ * Read a room from its text data file, save it as a compiled room
+ * and make sure it reads back the same. Returns true on success.
+ */
+static bool compile_room_file(const char *name, const char *output)
+{
+    init_room(&text_room);
+
+    if (!read_room_from_datafile_with_filename(name, &text_room)) {
+        fprintf(stderr, "Failed to read room \"%s\".\n", name);
+        return false;
+    }
+
+    if (!write_room_file(output, &text_room)) {
+        return false;
+    }
+
+    init_room(&compiled_room);
+
+    if (!read_room_file(output, &compiled_room) || !rooms_match(&text_room, &compiled_room)) {
+        fprintf(stderr, "Failed to read back the compiled room \"%s\", it doesn't match \"%s\".\n", output, name);
+        remove(output);
+        return false;
+    }
+
+    return true;
+}
+
+static int benchmark_rooms(int num_rooms, char **filenames)
+{
+    double total_ms = 0;
+
+    for (int i = 0; i < num_rooms; i++) {
+
+        /* Every room needs its own datafile path, so it goes first */
+        clear_datafile_paths();
+        const char *name = add_room_directory(filenames[i]);
+
+        init_room(&text_room);
+
+        if (!read_room_from_datafile_with_filename(name, &text_room)) {
+            fprintf(stderr, "Failed to read room \"%s\".\n", filenames[i]);
+            return 1;
+        }
+
+        double ms = time_text_room(name);
+        total_ms += ms;
+
+        printf("%s: %.3f ms\n", name, ms);
+    }
+
+    printf("%d rooms: %.3f ms total, %.3f ms per room\n", num_rooms, total_ms, num_rooms > 0 ? total_ms / num_rooms : 0.0);
+
+    free_import_cache();
+
+    return 0;
+}
+
+static int bundle_rooms(const char *input, const char *bundle_filename, const char *index_filename)
+{
+    const char *name = add_room_directory(input);
+
+    ROOM_LIST room_list;
+    init_room_list(&room_list);
+
+    if (!load_room_list_from_datafile_with_filename(name, &room_list)) {
+        return 1;
+    }
+
+    bool success = write_room_bundle(&room_list, bundle_filename, index_filename);
+
+    if (success) {
+        printf("%s: %d rooms\n", bundle_filename, room_list.size);
+    }
+
+    free_room_list(&room_list);
+    free_import_cache();
+
+    return success ? 0 : 1;
+}
+
+static int update_rooms(const char *input, const char *output_dir)
+{
+    const char *name = add_room_directory(input);
+
+    /* The output is opened as-is */
+    add_datafile_path("");
+
+    ROOM_LIST room_list;
+    init_room_list(&room_list);
+
+    if (!load_room_list_from_datafile_with_filename(name, &room_list)) {
+        return 1;
+    }
+
+    double start = al_get_time();
+    int num_compiled = 0;
+    bool success = true;
+
+    for (int i = 0; i < room_list.size; i++) {
+
+        char room_filename[MAX_FILENAME_LEN];
+        char output[MAX_FILENAME_LEN * 4];
+
+        get_room_file_name(room_list.filenames[i], room_filename, MAX_FILENAME_LEN);
+        snprintf(output, sizeof(output), "%s/%s", output_dir, room_filename);
+
+        /**
+         * File times are only to the second, so a room that was
+         * compiled the same second it was saved is compiled again,
+         * just in case it was saved again after.
+         */
+        time_t output_mtime = get_file_mtime(output);
+
+        if (output_mtime > 0 && output_mtime > get_room_source_mtime(room_list.filenames[i])) {
+
+            /* The files it imports are listed in the compiled room */
+            init_room(&compiled_room);
+            bool is_current = read_room_file(output, &compiled_room) && is_room_newer_than_imports(&compiled_room, output_mtime);
+            init_room(&compiled_room);
+
+            if (is_current) {
+                continue;
+            }
+        }
+
+        if (!compile_room_file(room_list.filenames[i], output)) {
+            success = false;
+            continue;
+        }
+
+        printf("%s\n", output);
+        num_compiled++;
+    }
+
+    printf("Compiled %d of %d rooms in %.2f ms.\n", num_compiled, room_list.size, (al_get_time() - start) * 1000.0);
+
+    free_room_list(&room_list);
+    free_import_cache();
+
+    return success ? 0 : 1;
+}
+
+/**
+ * Rooms drawn in Tiled can be somewhere else,
+ * see COLORWANDCASTLE_TILED_PATH in "main.c".
+ */
+static void add_tiled_path(void)
+{
+    const char *tiled_path = getenv("COLORWANDCASTLE_TILED_PATH");
+
+    if (tiled_path != NULL) {
+        add_datafile_path(tiled_path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (!al_init()) {
+        fprintf(stderr, "Failed to initialize Allegro.\n");
+        return 1;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "-t") == 0) {
+        return benchmark_rooms(argc - 2, argv + 2);
+    }
+
+    if (argc == 5 && strcmp(argv[1], "-b") == 0) {
+        add_tiled_path();
+        return bundle_rooms(argv[2], argv[3], argv[4]);
+    }
+
+    if (argc == 4 && strcmp(argv[1], "-u") == 0) {
+        add_tiled_path();
+        return update_rooms(argv[2], argv[3]);
+    }
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s INPUT.dat OUTPUT.room\n", argv[0]);
+        fprintf(stderr, "       %s -t INPUT.dat...\n", argv[0]);
+        fprintf(stderr, "       %s -b LIST.dat OUTPUT.bundle OUTPUT.index\n", argv[0]);
+        fprintf(stderr, "       %s -u LIST.dat OUTPUT_DIR\n", argv[0]);
+        return 1;
+    }
+
+    const char *input = argv[1];
+    const char *output = argv[2];
+
+    /* Files that are imported are found next to the input file */
+    const char *name = add_room_directory(input);
+
+    /* The output is opened as-is */
+    add_datafile_path("");
+
+    add_tiled_path();
+
+    if (!compile_room_file(name, output)) {
+        return 1;
+    }
+
+    double text_ms = time_text_room(name);
+    double compiled_ms = time_compiled_room(output);
+
+    printf("%s: text %.3f ms, compiled %.3f ms (%.1fx faster)\n",
+        name, text_ms, compiled_ms, compiled_ms > 0 ? text_ms / compiled_ms : 0.0);
+
+    free_import_cache();
+
+    return 0;
+}
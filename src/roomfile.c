@@ -0,0 +1,527 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "datafile.h"
+#include "drc_memory.h"
+#include "roomfile.h"
+
+static const char ROOM_FILE_MAGIC[4] = {'C', 'W', 'C', 'R'};
+
+/* The longest run that fits in a layer run length */
+#define MAX_RUN (255)
+
+/**
+ * Reading a compiled room.
+ *
+ * The whole file is read into memory at once, then the
+ * numbers are taken out of it one at a time. If anything
+ * goes wrong (such as reading past the end of the file)
+ * then "error" is set, and every read after that returns 0.
+ */
+typedef struct
+{
+    const unsigned char *data;
+    long size;
+    long pos;
+    bool error;
+} ROOM_FILE_READER;
+
+static int read_u8(ROOM_FILE_READER *reader)
+{
+    if (reader->error || reader->pos + 1 > reader->size) {
+        reader->error = true;
+        return 0;
+    }
+
+    int value = reader->data[reader->pos];
+    reader->pos += 1;
+
+    return value;
+}
+
+static int read_i8(ROOM_FILE_READER *reader)
+{
+    return (int8_t)read_u8(reader);
+}
+
+static int read_u16(ROOM_FILE_READER *reader)
+{
+    int low = read_u8(reader);
+    int high = read_u8(reader);
+
+    return low | (high << 8);
+}
+
+static int read_i16(ROOM_FILE_READER *reader)
+{
+    return (int16_t)read_u16(reader);
+}
+
+static int read_i32(ROOM_FILE_READER *reader)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)read_u8(reader) << (i * 8);
+    }
+
+    return (int32_t)value;
+}
+
+static void read_string(ROOM_FILE_READER *reader, char *string, int size)
+{
+    int len = read_u16(reader);
+
+    if (reader->error || len >= size || reader->pos + len > reader->size) {
+        reader->error = true;
+        string[0] = '\0';
+        return;
+    }
+
+    memcpy(string, reader->data + reader->pos, len);
+    string[len] = '\0';
+    reader->pos += len;
+}
+
+static void read_texture_def(ROOM_FILE_READER *reader, TEXTURE_DEF *texture_def)
+{
+    init_texture_def(texture_def, 0);
+
+    texture_def->len = read_u8(reader);
+    texture_def->speed = read_i16(reader);
+    texture_def->loop = read_u8(reader) != 0;
+
+    if (texture_def->len > MAX_FRAMES) {
+        reader->error = true;
+        return;
+    }
+
+    for (int i = 0; i < texture_def->len; i++) {
+        char frame[MAX_FILENAME_LEN];
+        read_string(reader, frame, MAX_FILENAME_LEN);
+        texture_def->frames[i] = intern_name(frame);
+    }
+}
+
+static void read_layer(ROOM_FILE_READER *reader, ROOM_CELL *map, int size)
+{
+    int i = 0;
+
+    while (i < size && !reader->error) {
+
+        int run = read_u8(reader);
+        int value = read_i16(reader);
+
+        if (run == 0 || i + run > size || value < INT8_MIN || value > INT8_MAX) {
+            reader->error = true;
+            return;
+        }
+
+        for (int j = 0; j < run; j++) {
+            map[i + j] = value;
+        }
+
+        i += run;
+    }
+}
+
+static bool read_room(ROOM_FILE_READER *reader, ROOM *room)
+{
+    for (int i = 0; i < 4; i++) {
+        if (read_u8(reader) != ROOM_FILE_MAGIC[i]) {
+            return false;
+        }
+    }
+
+    if (read_u16(reader) != ROOM_FILE_VERSION) {
+        return false;
+    }
+
+    int flags = read_u16(reader);
+
+    /* A flag from a newer version of the game */
+    if ((flags & ~ROOM_FILE_FLAGS) != 0) {
+        return false;
+    }
+
+    read_string(reader, room->title, MAX_STRING_SIZE);
+
+    if (flags & ROOM_FILE_FLAG_MUSIC) {
+        read_string(reader, room->music, MAX_STRING_SIZE);
+    } else {
+        room->music[0] = '\0';
+    }
+
+    room->num_imports = 0;
+
+    if (flags & ROOM_FILE_FLAG_IMPORTS) {
+
+        int num_imports = read_u8(reader);
+
+        if (num_imports > MAX_IMPORTS) {
+            return false;
+        }
+
+        for (int i = 0; i < num_imports; i++) {
+            char name[MAX_FILENAME_LEN];
+            read_string(reader, name, MAX_FILENAME_LEN);
+            room->imports[i] = intern_name(name);
+        }
+
+        room->num_imports = num_imports;
+    }
+
+    room->rows = read_i16(reader);
+    room->cols = read_i16(reader);
+
+    if (room->rows < 0 || room->rows > MAX_ROOM_ROWS || room->cols < 0 || room->cols > MAX_ROOM_COLS) {
+        return false;
+    }
+
+    room->start_x = read_i32(reader);
+    room->start_y = read_i32(reader);
+    room->direction = read_i8(reader);
+    room->facing = read_i8(reader);
+
+    room->num_tiles = read_u16(reader);
+    if (room->num_tiles > MAX_TILES) {
+        return false;
+    }
+    for (int i = 0; i < room->num_tiles; i++) {
+        read_texture_def(reader, &room->tile_defs[i]);
+    }
+
+    room->num_texture_defs = read_u16(reader);
+    if (room->num_texture_defs > MAX_TEXTURES) {
+        return false;
+    }
+    for (int i = 0; i < room->num_texture_defs; i++) {
+        read_texture_def(reader, &room->texture_defs[i]);
+    }
+
+    int size = room->rows * room->cols;
+
+    read_layer(reader, room->farground_map, size);
+    read_layer(reader, room->background_map, size);
+    read_layer(reader, room->foreground_map, size);
+    read_layer(reader, room->collision_map, size);
+    read_layer(reader, room->block_map_orig, size);
+
+    int num_enemies = read_u8(reader);
+    for (int i = 0; i < num_enemies && !reader->error; i++) {
+
+        int n = read_u8(reader);
+        if (n >= MAX_ENEMIES) {
+            return false;
+        }
+
+        ENEMY_DEFINITION *definition = &room->enemy_definitions[n];
+
+        definition->type = read_u8(reader);
+        if (definition->type >= NUM_ENEMY_TYPES) {
+            return false;
+        }
+
+        definition->row = read_i16(reader);
+        definition->col = read_i16(reader);
+        definition->speed = read_i16(reader);
+        definition->dist = read_i16(reader);
+        definition->is_active = true;
+    }
+
+    int num_exits = read_u8(reader);
+    for (int i = 0; i < num_exits && !reader->error; i++) {
+
+        int n = read_u8(reader);
+        if (n >= MAX_EXITS) {
+            return false;
+        }
+
+        EXIT *exit = &room->exits[n];
+
+        exit->direction = read_i8(reader);
+        exit->row = read_i16(reader);
+        exit->col = read_i16(reader);
+        exit->active = true;
+    }
+
+    return !reader->error;
+}
+
+bool read_room_file(const char *filename, ROOM *room)
+{
+    FILE *file = open_data_file_with_mode(filename, "rb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    /* Read the whole file at once */
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size <= 0) {
+        close_data_file(file);
+        return false;
+    }
+
+    unsigned char *data = drc_alloc_memory("ROOM_FILE", size);
+    assert(data != NULL);
+
+    bool success = (long)fread(data, 1, size, file) == size;
+
+    close_data_file(file);
+
+    if (success) {
+        success = read_compiled_room(data, size, room);
+    }
+
+    drc_free_memory("ROOM_FILE", data);
+
+    return success;
+}
+
+bool read_compiled_room(const unsigned char *data, long size, ROOM *room)
+{
+    ROOM_FILE_READER reader = {data, size, 0, false};
+
+    return read_room(&reader, room);
+}
+
+/**
+ * Writing a compiled room.
+ *
+ * The room is written to memory first, which grows as
+ * needed, and then it can be saved to a file all at once.
+ */
+typedef struct
+{
+    unsigned char *data;
+    long size;
+    long capacity;
+} ROOM_FILE_WRITER;
+
+/* Most rooms fit in this, it doubles whenever it runs out */
+#define ROOM_FILE_WRITER_START_SIZE (4096)
+
+static void write_u8(ROOM_FILE_WRITER *writer, int value)
+{
+    if (writer->size == writer->capacity) {
+
+        long capacity = writer->capacity > 0 ? writer->capacity * 2 : ROOM_FILE_WRITER_START_SIZE;
+        unsigned char *data = drc_alloc_memory("ROOM_FILE", capacity);
+        assert(data != NULL);
+
+        if (writer->data != NULL) {
+            memcpy(data, writer->data, writer->size);
+            drc_free_memory("ROOM_FILE", writer->data);
+        }
+
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+
+    writer->data[writer->size] = value & 0xFF;
+    writer->size++;
+}
+
+static void write_u16(ROOM_FILE_WRITER *writer, int value)
+{
+    write_u8(writer, value);
+    write_u8(writer, value >> 8);
+}
+
+/* Negative numbers are written the same way, they're read back with "read_i16" */
+static void write_i16(ROOM_FILE_WRITER *writer, int value)
+{
+    write_u16(writer, value);
+}
+
+static void write_i32(ROOM_FILE_WRITER *writer, int value)
+{
+    uint32_t bits = (uint32_t)value;
+
+    for (int i = 0; i < 4; i++) {
+        write_u8(writer, (bits >> (i * 8)) & 0xFF);
+    }
+}
+
+static void write_string(ROOM_FILE_WRITER *writer, const char *string)
+{
+    int len = strlen(string);
+
+    write_u16(writer, len);
+
+    for (int i = 0; i < len; i++) {
+        write_u8(writer, string[i]);
+    }
+}
+
+static void write_texture_def(ROOM_FILE_WRITER *writer, TEXTURE_DEF *texture_def)
+{
+    write_u8(writer, texture_def->len);
+    write_i16(writer, texture_def->speed);
+    write_u8(writer, texture_def->loop ? 1 : 0);
+
+    for (int i = 0; i < texture_def->len; i++) {
+        write_string(writer, get_name(texture_def->frames[i]));
+    }
+}
+
+static void write_layer(ROOM_FILE_WRITER *writer, ROOM_CELL *map, int size)
+{
+    int i = 0;
+
+    while (i < size) {
+
+        int run = 1;
+
+        while (i + run < size && run < MAX_RUN && map[i + run] == map[i]) {
+            run++;
+        }
+
+        write_u8(writer, run);
+        write_i16(writer, map[i]);
+
+        i += run;
+    }
+}
+
+unsigned char *compile_room(ROOM *room, long *size)
+{
+    ROOM_FILE_WRITER writer = {NULL, 0, 0};
+
+    for (int i = 0; i < 4; i++) {
+        write_u8(&writer, ROOM_FILE_MAGIC[i]);
+    }
+    write_u16(&writer, ROOM_FILE_VERSION);
+    int flags = 0;
+    if (room->music[0] != '\0') {
+        flags |= ROOM_FILE_FLAG_MUSIC;
+    }
+    if (room->num_imports > 0) {
+        flags |= ROOM_FILE_FLAG_IMPORTS;
+    }
+    write_u16(&writer, flags);
+
+    write_string(&writer, room->title);
+
+    if (flags & ROOM_FILE_FLAG_MUSIC) {
+        write_string(&writer, room->music);
+    }
+
+    if (flags & ROOM_FILE_FLAG_IMPORTS) {
+        write_u8(&writer, room->num_imports);
+        for (int i = 0; i < room->num_imports; i++) {
+            write_string(&writer, get_name(room->imports[i]));
+        }
+    }
+
+    write_i16(&writer, room->rows);
+    write_i16(&writer, room->cols);
+    write_i32(&writer, room->start_x);
+    write_i32(&writer, room->start_y);
+    write_u8(&writer, room->direction);
+    write_u8(&writer, room->facing);
+
+    write_u16(&writer, room->num_tiles);
+    for (int i = 0; i < room->num_tiles; i++) {
+        write_texture_def(&writer, &room->tile_defs[i]);
+    }
+
+    write_u16(&writer, room->num_texture_defs);
+    for (int i = 0; i < room->num_texture_defs; i++) {
+        write_texture_def(&writer, &room->texture_defs[i]);
+    }
+
+    int map_size = room->rows * room->cols;
+
+    write_layer(&writer, room->farground_map, map_size);
+    write_layer(&writer, room->background_map, map_size);
+    write_layer(&writer, room->foreground_map, map_size);
+    write_layer(&writer, room->collision_map, map_size);
+    write_layer(&writer, room->block_map_orig, map_size);
+
+    int num_enemies = 0;
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        if (room->enemy_definitions[i].is_active) {
+            num_enemies++;
+        }
+    }
+
+    write_u8(&writer, num_enemies);
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        ENEMY_DEFINITION *definition = &room->enemy_definitions[i];
+        if (definition->is_active) {
+            write_u8(&writer, i);
+            write_u8(&writer, definition->type);
+            write_i16(&writer, definition->row);
+            write_i16(&writer, definition->col);
+            write_i16(&writer, definition->speed);
+            write_i16(&writer, definition->dist);
+        }
+    }
+
+    int num_exits = 0;
+    for (int i = 0; i < MAX_EXITS; i++) {
+        if (room->exits[i].active) {
+            num_exits++;
+        }
+    }
+
+    write_u8(&writer, num_exits);
+    for (int i = 0; i < MAX_EXITS; i++) {
+        EXIT *exit = &room->exits[i];
+        if (exit->active) {
+            write_u8(&writer, i);
+            write_u8(&writer, exit->direction);
+            write_i16(&writer, exit->row);
+            write_i16(&writer, exit->col);
+        }
+    }
+
+    *size = writer.size;
+
+    return writer.data;
+}
+
+void free_compiled_room(unsigned char *data)
+{
+    drc_free_memory("ROOM_FILE", data);
+}
+
+bool write_room_file(const char *filename, ROOM *room)
+{
+    FILE *file = fopen(filename, "wb");
+
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open \"%s\" to save the compiled room.\n", filename);
+        return false;
+    }
+
+    long size = 0;
+    unsigned char *data = compile_room(room, &size);
+
+    bool success = (long)fwrite(data, 1, size, file) == size;
+
+    free_compiled_room(data);
+
+    if (fclose(file) != 0) {
+        success = false;
+    }
+
+    return success;
+}
+
+void get_room_file_name(const char *filename, char *room_filename, int size)
+{
+    int len = strlen(filename);
+
+    /* Replace the ".dat" at the end, if it's there */
+    if (len >= 4 && strcmp(filename + len - 4, ".dat") == 0) {
+        len -= 4;
+    }
+
+    snprintf(room_filename, size, "%.*s.room", len, filename);
+}
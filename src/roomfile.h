@@ -0,0 +1,95 @@
+#pragma once
+
+#include "gamedata.h"
+
+/**
+ * A compiled room is a room data file that has already been
+ * read and saved in a binary form, so it can be loaded
+ * without reading any text.
+ *
+ * The layout of a compiled room (all numbers are little endian):
+ *
+ *   "CWCR"                                  Magic
+ *   u16 version, u16 flags                  See ROOM_FILE_VERSION
+ *   string title
+ *   string music                            Only with ROOM_FILE_FLAG_MUSIC
+ *   u8 num_imports, strings                 Only with ROOM_FILE_FLAG_IMPORTS
+ *   i16 rows, i16 cols
+ *   i32 start_x, i32 start_y
+ *   i8 direction, i8 facing
+ *   u16 num_tiles, tile definitions         See below
+ *   u16 num_textures, texture definitions   See below
+ *   layers                                  Farground, background,
+ *                                           foreground, collision and
+ *                                           blocks, in that order
+ *   u8 num_enemies, enemy records
+ *   u8 num_exits, exit records
+ *
+ * A string is a u16 length followed by that many characters.
+ *
+ * A tile or texture definition is a u8 number of frames, an
+ * i16 speed, a u8 loop flag and then a string for each frame.
+ *
+ * A layer is "runs" of the same number, read from the top left
+ * to the bottom right, until rows * cols numbers have been read.
+ * Each run is a u8 length and then the i16 number.
+ *
+ * An enemy record is the u8 enemy number, u8 type and the
+ * i16 row, col, speed and dist.
+ *
+ * An exit record is the u8 exit number, i8 direction and the
+ * i16 row and col.
+ */
+
+/**
+ * Change this whenever the layout of a compiled room changes,
+ * so that older compiled rooms are rejected and made again.
+ *
+ *   1 - The first version
+ *   2 - The music, with ROOM_FILE_FLAG_MUSIC
+ *   3 - The files the room imports, with ROOM_FILE_FLAG_IMPORTS
+ */
+#define ROOM_FILE_VERSION (3)
+
+/**
+ * Flags for the parts of a compiled room that most rooms
+ * don't have, so those rooms are the same as they always were.
+ */
+#define ROOM_FILE_FLAG_MUSIC (1 << 0)
+#define ROOM_FILE_FLAG_IMPORTS (1 << 1)
+#define ROOM_FILE_FLAGS (ROOM_FILE_FLAG_MUSIC | ROOM_FILE_FLAG_IMPORTS)
+
+/**
+ * The name of the compiled version of a room data file,
+ * such as "room-story-001.room" for "room-story-001.dat".
+ */
+void get_room_file_name(const char *filename, char *room_filename, int size);
+
+/**
+ * Save a room that was read with "read_room_from_datafile_with_filename"
+ * (and NOT finished loading) to a compiled room file.
+ * Returns true on success.
+ */
+bool write_room_file(const char *filename, ROOM *room);
+
+/**
+ * Read a compiled room, taking into account datafile paths.
+ * Like a room read from a text data file, the room isn't ready
+ * to be used until it's finished with "finish_loading_room".
+ * Returns false if the room couldn't be read or it's from an
+ * old version of the game.
+ */
+bool read_room_file(const char *filename, ROOM *room);
+
+/**
+ * The same as "write_room_file", but the compiled room is kept
+ * in memory instead of being saved. Sets "size" to the number
+ * of bytes. Free it with "free_compiled_room".
+ */
+unsigned char *compile_room(ROOM *room, long *size);
+void free_compiled_room(unsigned char *data);
+
+/**
+ * The same as "read_room_file", from a compiled room in memory.
+ */
+bool read_compiled_room(const unsigned char *data, long size, ROOM *room);
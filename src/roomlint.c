@@ -0,0 +1,398 @@
+/**
+ * The room checker.
+ *
+ * Reads every room in a room list, a few at a time on different
+ * threads, and makes sure each one can be played all the way
+ * through. Starting from the START of the room, a block can be
+ * hit if the spot in front of it (where it's shot from, the same
+ * as in the game) can be reached. Hitting blocks opens up more
+ * of the room, until no more can be hit.
+ *
+ *   roomlint data/levels/list-story.dat
+ *   roomlint -j 8 data/levels/list-story.dat
+ *
+ * Every problem is printed on its own line, with tabs between:
+ *
+ *   ROOM  PROBLEM  ROW  COL  DETAILS
+ *
+ * PROBLEM is one of:
+ *
+ *   unreadable-room    The room couldn't be read
+ *   start-out-of-room  The hero starts outside of the room
+ *   start-in-wall      The hero starts inside of a wall or block
+ *   unreachable-block  The block can never be hit
+ *   exit-out-of-room   The exit is outside of the room
+ *   unreachable-exit   The exit can't be reached, even with every block gone
+ *   enemy-out-of-room  The enemy starts outside of the room
+ *   overlapping-enemy  The enemy starts in the same spot as another enemy
+ *
+ * The ROW and COL are -1 if the problem isn't at one spot.
+ * It exits with 1 if any room has a problem ("make lint-rooms").
+ */
+
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datafile.h"
+#include "drc_memory.h"
+#include "drc_path_cache.h"
+#include "drc_sprite.h"
+#include "path.h"
+
+/* More threads than this won't help, there aren't that many rooms */
+#define MAX_LINT_THREADS (16)
+#define DEFAULT_LINT_THREADS (4)
+
+#define LINT_PROBLEMS_START_SIZE (8)
+
+typedef struct
+{
+    const char *problem;
+    int row;
+    int col;
+    char details[MAX_STRING_SIZE];
+} LINT_PROBLEM;
+
+/* Everything wrong with one room */
+typedef struct
+{
+    LINT_PROBLEM *problems;
+    int num_problems;
+    int size;
+} LINT_RESULT;
+
+/**
+ * The rooms still waiting to be checked.
+ * Each thread takes the next room until there are none left.
+ */
+typedef struct
+{
+    ROOM_LIST *room_list;
+    LINT_RESULT *results;
+    int next_room;
+    ALLEGRO_MUTEX *mutex;
+} LINT_JOB;
+
+static void add_problem(LINT_RESULT *result, const char *problem, int row, int col, const char *details)
+{
+    if (result->num_problems >= result->size) {
+
+        int size = result->size > 0 ? result->size * 2 : LINT_PROBLEMS_START_SIZE;
+
+        LINT_PROBLEM *problems = drc_calloc_memory("LINT_PROBLEMS", size, sizeof(LINT_PROBLEM));
+        assert(problems != NULL);
+
+        if (result->problems != NULL) {
+            memcpy(problems, result->problems, result->num_problems * sizeof(LINT_PROBLEM));
+            drc_free_memory("LINT_PROBLEMS", result->problems);
+        }
+
+        result->problems = problems;
+        result->size = size;
+    }
+
+    LINT_PROBLEM *p = &result->problems[result->num_problems];
+
+    p->problem = problem;
+    p->row = row;
+    p->col = col;
+    snprintf(p->details, MAX_STRING_SIZE, "%s", details);
+
+    result->num_problems++;
+}
+
+static bool is_in_room(ROOM *room, int row, int col)
+{
+    return row >= 0 && row < room->rows && col >= 0 && col < room->cols;
+}
+
+/**
+ * Hit every block that can be hit, over and over, until there are
+ * none left that can be. The blocks that are left in "block_map"
+ * can never be hit, and "reachable" is everywhere the hero can go.
+ */
+static void clear_reachable_blocks(ROOM *room, int start_row, int start_col, bool *reachable, int *points)
+{
+    int v_offset = directions[room->direction].v_offset;
+    int h_offset = directions[room->direction].h_offset;
+
+    memcpy(room->block_map, room->block_map_orig, sizeof(room->block_map));
+
+    bool cleared_any = true;
+
+    while (cleared_any) {
+
+        cleared_any = false;
+
+        find_reachable_points(room, start_row, start_col, reachable, points);
+
+        for (int r = 0; r < room->rows; r++) {
+            for (int c = 0; c < room->cols; c++) {
+
+                if (room->block_map[(r * room->cols) + c] == NO_BLOCK) {
+                    continue;
+                }
+
+                /* Blocks are shot from the spot in front of them */
+                int row = r - v_offset;
+                int col = c - h_offset;
+
+                if (is_in_room(room, row, col) && reachable[(row * room->cols) + col]) {
+                    room->block_map[(r * room->cols) + c] = NO_BLOCK;
+                    cleared_any = true;
+                }
+            }
+        }
+    }
+}
+
+static void lint_room(ROOM *room, LINT_RESULT *result)
+{
+    char details[MAX_STRING_SIZE];
+    bool reachable[MAX_ROOM_SIZE];
+    int points[MAX_ROOM_SIZE];
+
+    int start_row = room->start_y / TILE_SIZE;
+    int start_col = room->start_x / TILE_SIZE;
+
+    if (!is_in_room(room, start_row, start_col)) {
+        add_problem(result, "start-out-of-room", start_row, start_col, "The hero starts outside of the room");
+    } else if (room->collision_map[(start_row * room->cols) + start_col] == COLLISION ||
+            room->block_map_orig[(start_row * room->cols) + start_col] != NO_BLOCK) {
+        add_problem(result, "start-in-wall", start_row, start_col, "The hero starts inside of a wall or block");
+    }
+
+    clear_reachable_blocks(room, start_row, start_col, reachable, points);
+
+    for (int r = 0; r < room->rows; r++) {
+        for (int c = 0; c < room->cols; c++) {
+            int block = room->block_map[(r * room->cols) + c];
+            if (block != NO_BLOCK) {
+                snprintf(details, MAX_STRING_SIZE, "Block with texture %d can never be hit", block);
+                add_problem(result, "unreachable-block", r, c, details);
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_EXITS; i++) {
+        EXIT *exit = &room->exits[i];
+        if (!exit->active) {
+            continue;
+        }
+        snprintf(details, MAX_STRING_SIZE, "Exit %d", i + 1);
+        if (!is_in_room(room, exit->row, exit->col)) {
+            add_problem(result, "exit-out-of-room", exit->row, exit->col, details);
+        } else if (!reachable[(exit->row * room->cols) + exit->col]) {
+            add_problem(result, "unreachable-exit", exit->row, exit->col, details);
+        }
+    }
+
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+
+        ENEMY_DEFINITION *definition = &room->enemy_definitions[i];
+
+        if (!definition->is_active) {
+            continue;
+        }
+
+        if (!is_in_room(room, definition->row, definition->col)) {
+            snprintf(details, MAX_STRING_SIZE, "Enemy %d", i + 1);
+            add_problem(result, "enemy-out-of-room", definition->row, definition->col, details);
+            continue;
+        }
+
+        /* Only report it once, for the second of the two */
+        for (int j = 0; j < i; j++) {
+            ENEMY_DEFINITION *other = &room->enemy_definitions[j];
+            if (other->is_active && other->row == definition->row && other->col == definition->col) {
+                snprintf(details, MAX_STRING_SIZE, "Enemy %d starts in the same spot as enemy %d", i + 1, j + 1);
+                add_problem(result, "overlapping-enemy", definition->row, definition->col, details);
+                break;
+            }
+        }
+    }
+}
+
+static void *lint_rooms_thread(ALLEGRO_THREAD *thread, void *arg)
+{
+    LINT_JOB *job = arg;
+
+    (void)thread;
+
+    /* Much too big to go on the stack */
+    ROOM *room = drc_calloc_memory("LINT_ROOM", 1, sizeof(ROOM));
+    assert(room != NULL);
+
+    while (true) {
+
+        al_lock_mutex(job->mutex);
+        int room_num = job->next_room;
+        job->next_room++;
+        al_unlock_mutex(job->mutex);
+
+        if (room_num >= job->room_list->size) {
+            break;
+        }
+
+        init_room(room);
+
+        /* Check the room as it's written, not an old compiled room */
+        if (read_room_from_datafile_with_filename(job->room_list->filenames[room_num], room)) {
+            lint_room(room, &job->results[room_num]);
+        } else {
+            add_problem(&job->results[room_num], "unreadable-room", -1, -1, "The room couldn't be read");
+        }
+    }
+
+    free_room(room);
+    drc_free_memory("LINT_ROOM", room);
+
+    return NULL;
+}
+
+static void lint_room_list(ROOM_LIST *room_list, LINT_RESULT *results, int num_threads)
+{
+    share_import_cache_between_threads();
+    share_names_between_threads();
+    drc_share_path_cache_between_threads();
+    drc_share_animations_between_threads();
+
+    LINT_JOB job = {room_list, results, 0, al_create_mutex()};
+    assert(job.mutex != NULL);
+
+    ALLEGRO_THREAD *threads[MAX_LINT_THREADS];
+    int num_started = 0;
+
+    for (int i = 0; i < num_threads; i++) {
+        threads[num_started] = al_create_thread(lint_rooms_thread, &job);
+        if (threads[num_started] != NULL) {
+            al_start_thread(threads[num_started]);
+            num_started++;
+        }
+    }
+
+    /* If no threads could be started, just do it here */
+    if (num_started == 0) {
+        lint_rooms_thread(NULL, &job);
+    }
+
+    for (int i = 0; i < num_started; i++) {
+        al_join_thread(threads[i], NULL);
+        al_destroy_thread(threads[i]);
+    }
+
+    al_destroy_mutex(job.mutex);
+}
+
+/**
+ * Look for the rooms in the list next to it.
+ * Returns the name of the list file without the directory.
+ */
+static const char *add_list_directory(const char *input)
+{
+    static char dir[MAX_FILENAME_LEN * 4];
+    const char *name = strrchr(input, '/');
+
+    if (name != NULL) {
+        name++;
+        snprintf(dir, sizeof(dir), "%.*s", (int)(name - input), input);
+    } else {
+        name = input;
+        dir[0] = '\0';
+    }
+
+    add_datafile_path(dir);
+
+    return name;
+}
+
+int main(int argc, char **argv)
+{
+    int num_threads = DEFAULT_LINT_THREADS;
+    int arg = 1;
+
+    if (argc == 4 && strcmp(argv[1], "-j") == 0) {
+        num_threads = atoi(argv[2]);
+        arg = 3;
+    }
+
+    if (arg != argc - 1) {
+        fprintf(stderr, "Usage: %s [-j THREADS] LIST.dat\n", argv[0]);
+        return 1;
+    }
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    } else if (num_threads > MAX_LINT_THREADS) {
+        num_threads = MAX_LINT_THREADS;
+    }
+
+    if (!al_init()) {
+        fprintf(stderr, "Failed to initialize Allegro.\n");
+        return 1;
+    }
+
+    const char *name = add_list_directory(argv[arg]);
+
+    /* Rooms drawn in Tiled can be somewhere else, the same as in the game */
+    const char *tiled_path = getenv("COLORWANDCASTLE_TILED_PATH");
+    if (tiled_path != NULL) {
+        add_datafile_path(tiled_path);
+    }
+
+    ROOM_LIST room_list;
+    init_room_list(&room_list);
+
+    if (!load_room_list_from_datafile_with_filename(name, &room_list)) {
+        return 1;
+    }
+
+    LINT_RESULT *results = NULL;
+
+    if (room_list.size > 0) {
+        results = drc_calloc_memory("LINT_RESULTS", room_list.size, sizeof(LINT_RESULT));
+        assert(results != NULL);
+    }
+
+    double start = al_get_time();
+
+    lint_room_list(&room_list, results, num_threads);
+
+    double time = al_get_time() - start;
+
+    /* Printed in the same order as the list, no matter which thread was first */
+    int num_problem_rooms = 0;
+
+    for (int i = 0; i < room_list.size; i++) {
+
+        for (int j = 0; j < results[i].num_problems; j++) {
+            LINT_PROBLEM *p = &results[i].problems[j];
+            printf("%s\t%s\t%d\t%d\t%s\n", room_list.filenames[i], p->problem, p->row, p->col, p->details);
+        }
+
+        if (results[i].num_problems > 0) {
+            num_problem_rooms++;
+        }
+
+        if (results[i].problems != NULL) {
+            drc_free_memory("LINT_PROBLEMS", results[i].problems);
+        }
+    }
+
+    fprintf(stderr, "Checked %d rooms on %d threads in %.2f ms, %d have problems.\n",
+        room_list.size, num_threads, time * 1000.0, num_problem_rooms);
+
+    if (results != NULL) {
+        drc_free_memory("LINT_RESULTS", results);
+    }
+
+    free_room_list(&room_list);
+    free_import_cache();
+    free_names();
+    drc_free_path_cache();
+    drc_free_animations();
+    drc_free_arenas();
+
+    return num_problem_rooms > 0 ? 1 : 0;
+}
@@ -1,13 +1,51 @@
 #include <stdio.h>
+#include <string.h>
+#include "drc_memory.h"
 #include "roomlist.h"
 
+/* Enough for most room lists, it doubles whenever it runs out */
+#define ROOM_LIST_START_SIZE (64)
+
 void init_room_list(ROOM_LIST *list)
 {
     assert(list != NULL);
 
-    for (int i = 0; i < MAX_ROOMS; i++) {
-        list->filenames[i][0] = '\0';
+    list->filenames = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+void free_room_list(ROOM_LIST *list)
+{
+    assert(list != NULL);
+
+    if (list->filenames != NULL) {
+        drc_free_memory("ROOM_LIST", list->filenames);
     }
 
-    list->size = 0;
+    init_room_list(list);
+}
+
+void add_room_to_room_list(ROOM_LIST *list, const char *filename)
+{
+    assert(list != NULL);
+
+    if (list->size == list->capacity) {
+
+        int capacity = list->capacity > 0 ? list->capacity * 2 : ROOM_LIST_START_SIZE;
+        char (*filenames)[MAX_FILENAME_LEN] = drc_calloc_memory("ROOM_LIST", capacity, MAX_FILENAME_LEN);
+        assert(filenames != NULL);
+
+        if (list->filenames != NULL) {
+            memcpy(filenames, list->filenames, list->size * MAX_FILENAME_LEN);
+            drc_free_memory("ROOM_LIST", list->filenames);
+        }
+
+        list->filenames = filenames;
+        list->capacity = capacity;
+    }
+
+    strncpy(list->filenames[list->size], filename, MAX_FILENAME_LEN - 1);
+    list->filenames[list->size][MAX_FILENAME_LEN - 1] = '\0';
+    list->size++;
 }
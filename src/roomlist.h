@@ -3,10 +3,21 @@
 #include <stdio.h>
 #include "gamedata.h"
 
+/**
+ * The data file for each room, in order.
+ * The list grows as rooms are added, there's no limit.
+ */
 typedef struct
 {
-    char filenames[MAX_ROOMS][MAX_FILENAME_LEN];
+    char (*filenames)[MAX_FILENAME_LEN];
     int size;
+    int capacity;
 } ROOM_LIST;
 
 void init_room_list(ROOM_LIST *room_list);
+void free_room_list(ROOM_LIST *room_list);
+
+/**
+ * Add a room to the end of the list.
+ */
+void add_room_to_room_list(ROOM_LIST *room_list, const char *filename);
@@ -0,0 +1,492 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "drc_memory.h"
+#include "tmxfile.h"
+#include "tokenizer.h"
+
+/* The top bits of a number in a layer say if the tile is flipped or rotated */
+#define TMX_FLIP_FLAGS (0xF0000000u)
+
+#define MAX_TMX_NAME_LEN (32)
+
+typedef struct
+{
+    int firstgid;
+    int tile_width;
+    int tile_height;
+    int tilecount;
+    int columns;
+} TMX_TILESET;
+
+void get_tmx_file_name(const char *filename, char *tmx_filename, int size)
+{
+    int len = strlen(filename);
+
+    /* Replace the ".dat" at the end, if it's there */
+    if (len >= 4 && strcmp(filename + len - 4, ".dat") == 0) {
+        len -= 4;
+    }
+
+    snprintf(tmx_filename, size, "%.*s.tmx", len, filename);
+}
+
+/**
+ * The XML is read with a tokenizer, just to have the whole
+ * file in memory and errors with line numbers. It's not split
+ * into tokens, it's searched for tags instead.
+ */
+static void move_xml(TOKENIZER *xml, const char *pos)
+{
+    for (const char *c = xml->pos; c < pos; c++) {
+        if (*c == '\n') {
+            xml->line++;
+            xml->line_start = c + 1;
+        }
+    }
+
+    xml->pos = pos;
+}
+
+/**
+ * Move past the next tag and get its name. End tags, comments
+ * and the "<?xml" line are skipped. Returns the start of the
+ * tag, to get its attributes, or NULL at the end of the file.
+ */
+static const char *next_tag(TOKENIZER *xml, char *name, int size)
+{
+    const char *tag = xml->pos;
+
+    while ((tag = strchr(tag, '<')) != NULL) {
+
+        tag++;
+
+        if (*tag == '/' || *tag == '?' || *tag == '!') {
+            continue;
+        }
+
+        int len = strcspn(tag, " \t\r\n/>");
+        snprintf(name, size, "%.*s", len, tag);
+
+        const char *end = strchr(tag, '>');
+        move_xml(xml, end != NULL ? end + 1 : tag + len);
+
+        return tag;
+    }
+
+    move_xml(xml, xml->data + xml->size);
+
+    return NULL;
+}
+
+/**
+ * Copy the value of an attribute of a tag.
+ * Returns false if the tag doesn't have it.
+ */
+static bool get_attribute(const char *tag, const char *name, char *value, int size)
+{
+    int len = strlen(name);
+
+    for (const char *pos = tag + 1; *pos != '\0' && *pos != '>'; pos++) {
+
+        if (strchr(" \t\r\n", pos[-1]) == NULL || strncmp(pos, name, len) != 0 ||
+                pos[len] != '=' || (pos[len + 1] != '"' && pos[len + 1] != '\'')) {
+            continue;
+        }
+
+        const char *start = pos + len + 2;
+        const char *end = strchr(start, pos[len + 1]);
+
+        if (end == NULL) {
+            return false;
+        }
+
+        snprintf(value, size, "%.*s", (int)(end - start), start);
+
+        return true;
+    }
+
+    return false;
+}
+
+static int get_int_attribute(const char *tag, const char *name, int default_value)
+{
+    char value[MAX_TMX_NAME_LEN];
+
+    if (!get_attribute(tag, name, value, MAX_TMX_NAME_LEN)) {
+        return default_value;
+    }
+
+    return atoi(value);
+}
+
+static void read_tileset_attributes(const char *tag, TMX_TILESET *tileset)
+{
+    tileset->tile_width = get_int_attribute(tag, "tilewidth", TILE_SIZE);
+    tileset->tile_height = get_int_attribute(tag, "tileheight", TILE_SIZE);
+    tileset->tilecount = get_int_attribute(tag, "tilecount", 0);
+    tileset->columns = get_int_attribute(tag, "columns", 1);
+
+    if (tileset->columns < 1) {
+        tileset->columns = 1;
+    }
+}
+
+/**
+ * Make a tile for each tile in the tileset, using a section of
+ * the tileset image (see "drc_resources.h" for tilemap names).
+ */
+static void add_tileset_tiles(TOKENIZER *xml, TMX_TILESET *tileset, const char *source, ROOM *room)
+{
+    /* Images are found in the resource paths, so only the name is needed */
+    const char *image = strrchr(source, '/');
+    image = image != NULL ? image + 1 : source;
+
+    for (int i = 0; i < tileset->tilecount; i++) {
+
+        int tile = tileset->firstgid - 1 + i;
+
+        if (tile < 0 || tile >= MAX_TILES) {
+            tokenizer_error(xml, NULL, "Failed to add tile %d from \"%s\", max number reached.", tile + 1, image);
+            return;
+        }
+
+        /* Tilesets don't have to be next to each other */
+        while (room->num_tiles <= tile) {
+            init_texture_def(&room->tile_defs[room->num_tiles], 0);
+            room->num_tiles++;
+        }
+
+        char frame[MAX_FILENAME_LEN];
+        snprintf(frame, MAX_FILENAME_LEN, "%s:%dx%d:%d,%d", image, tileset->tile_width, tileset->tile_height,
+            i / tileset->columns, i % tileset->columns);
+
+        room->tile_defs[tile].frames[0] = intern_name(frame);
+        room->tile_defs[tile].len = 1;
+    }
+}
+
+/* A tileset saved in its own file */
+static void read_tsx_file(const char *filename, int firstgid, ROOM *room)
+{
+    TOKENIZER tsx;
+
+    if (!open_tokenizer(&tsx, filename)) {
+        fprintf(stderr, "Failed to open tileset \"%s\".\n", filename);
+        return;
+    }
+
+    TMX_TILESET tileset = {firstgid, TILE_SIZE, TILE_SIZE, 0, 1};
+    char name[MAX_TMX_NAME_LEN];
+    const char *tag;
+
+    while ((tag = next_tag(&tsx, name, MAX_TMX_NAME_LEN)) != NULL) {
+        if (strcmp(name, "tileset") == 0) {
+            read_tileset_attributes(tag, &tileset);
+        } else if (strcmp(name, "image") == 0) {
+            char source[MAX_FILENAME_LEN * 4];
+            if (get_attribute(tag, "source", source, sizeof(source))) {
+                add_tileset_tiles(&tsx, &tileset, source, room);
+            }
+            break;
+        }
+    }
+
+    close_tokenizer(&tsx);
+}
+
+static int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    } else if (c == '+') {
+        return 62;
+    } else if (c == '/') {
+        return 63;
+    }
+
+    return -1;
+}
+
+/**
+ * Decode base64 text into bytes, skipping spaces.
+ * Returns the number of bytes.
+ */
+static long decode_base64(const char *text, long len, unsigned char *bytes)
+{
+    long size = 0;
+    int bits = 0;
+    uint32_t buffer = 0;
+
+    for (long i = 0; i < len; i++) {
+
+        int value = base64_value(text[i]);
+
+        if (value < 0) {
+            continue;
+        }
+
+        buffer = (buffer << 6) | value;
+        bits += 6;
+
+        if (bits >= 8) {
+            bits -= 8;
+            bytes[size] = (buffer >> bits) & 0xFF;
+            size++;
+        }
+    }
+
+    return size;
+}
+
+/* Works for both zlib and gzip */
+static bool inflate_bytes(const unsigned char *in, long in_size, unsigned char *out, long out_size)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    /* 32 tells zlib to figure out if it's zlib or gzip */
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return false;
+    }
+
+    stream.next_in = (unsigned char *)in;
+    stream.avail_in = in_size;
+    stream.next_out = out;
+    stream.avail_out = out_size;
+
+    int result = inflate(&stream, Z_FINISH);
+
+    inflateEnd(&stream);
+
+    return result == Z_STREAM_END && stream.total_out == (unsigned long)out_size;
+}
+
+/**
+ * Read the numbers of a layer from the text after a "data" tag.
+ * Returns false if there aren't exactly "num" numbers.
+ */
+static bool read_layer_data(TOKENIZER *xml, const char *tag, uint32_t *gids, int num)
+{
+    char encoding[MAX_TMX_NAME_LEN] = "";
+    char compression[MAX_TMX_NAME_LEN] = "";
+
+    get_attribute(tag, "encoding", encoding, MAX_TMX_NAME_LEN);
+    get_attribute(tag, "compression", compression, MAX_TMX_NAME_LEN);
+
+    const char *text = xml->pos;
+    long len = strcspn(text, "<");
+
+    if (strcmp(encoding, "csv") == 0) {
+
+        const char *pos = text;
+        int count = 0;
+
+        while (pos < text + len) {
+            char *end;
+            unsigned long gid = strtoul(pos, &end, 10);
+            if (end == pos) {
+                pos++;
+                continue;
+            }
+            if (count < num) {
+                gids[count] = gid;
+            }
+            count++;
+            pos = end;
+        }
+
+        return count == num;
+    }
+
+    if (strcmp(encoding, "base64") != 0) {
+        tokenizer_error(xml, NULL, "Failed to read layer, save it as CSV or base64 in Tiled.");
+        return false;
+    }
+
+    unsigned char *bytes = drc_alloc_memory("TMX_LAYER", (len * 3) / 4 + 4);
+    assert(bytes != NULL);
+
+    long size = decode_base64(text, len, bytes);
+    long expected_size = (long)num * 4;
+    bool success = false;
+
+    if (compression[0] == '\0') {
+        success = size == expected_size;
+        if (success) {
+            memcpy(gids, bytes, expected_size);
+        }
+    } else if (strcmp(compression, "zlib") == 0 || strcmp(compression, "gzip") == 0) {
+        success = inflate_bytes(bytes, size, (unsigned char *)gids, expected_size);
+    } else {
+        tokenizer_error(xml, NULL, "Failed to read layer, \"%s\" compression isn't supported.", compression);
+        drc_free_memory("TMX_LAYER", bytes);
+        return false;
+    }
+
+    drc_free_memory("TMX_LAYER", bytes);
+
+    /* Numbers are saved little endian */
+    for (int i = 0; i < num && success; i++) {
+        unsigned char *b = (unsigned char *)&gids[i];
+        gids[i] = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    }
+
+    return success;
+}
+
+static ROOM_CELL *get_layer_map(ROOM *room, const char *name)
+{
+    if (strcmp(name, "FARGROUND") == 0) {
+        return room->farground_map;
+    } else if (strcmp(name, "BACKGROUND") == 0) {
+        return room->background_map;
+    } else if (strcmp(name, "FOREGROUND") == 0) {
+        return room->foreground_map;
+    } else if (strcmp(name, "COLLISION") == 0) {
+        return room->collision_map;
+    } else if (strcmp(name, "BLOCKS") == 0) {
+        return room->block_map_orig;
+    }
+
+    return NULL;
+}
+
+static void read_layer(TOKENIZER *xml, const char *tag, ROOM_CELL *map, ROOM *room)
+{
+    int num = room->rows * room->cols;
+    uint32_t gids[MAX_ROOM_SIZE];
+
+    if (!read_layer_data(xml, tag, gids, num)) {
+        tokenizer_error(xml, NULL, "Failed to read layer, it should have %d numbers.", num);
+        return;
+    }
+
+    for (int i = 0; i < num; i++) {
+
+        /* Just like a data file, 0 is nothing and 1 is the first tile */
+        uint32_t gid = gids[i] & ~TMX_FLIP_FLAGS;
+
+        if (gid > INT8_MAX + 1) {
+            tokenizer_error(xml, NULL, "Number %u in layer is too big, using 0 instead.", (unsigned)gid);
+            gid = 0;
+        }
+
+        map[i] = (int)gid - 1;
+    }
+}
+
+bool read_tmx_file(const char *filename, ROOM *room)
+{
+    TOKENIZER xml;
+
+    if (!open_tokenizer(&xml, filename)) {
+        fprintf(stderr, "Failed to open Tiled map \"%s\".\n", filename);
+        return false;
+    }
+
+    /* The data file gets to pick the tiles, if it has any */
+    bool make_tiles = room->num_tiles == 0;
+
+    TMX_TILESET tileset = {0};
+    bool in_tileset = false;
+
+    ROOM_CELL *map = NULL;
+    bool foreground_map_used = false;
+    bool collision_map_used = false;
+
+    char name[MAX_TMX_NAME_LEN];
+    char value[MAX_FILENAME_LEN * 4];
+    const char *tag;
+
+    while ((tag = next_tag(&xml, name, MAX_TMX_NAME_LEN)) != NULL) {
+
+        if (strcmp(name, "map") == 0) {
+
+            int rows = get_int_attribute(tag, "height", room->rows);
+            int cols = get_int_attribute(tag, "width", room->cols);
+
+            if (get_int_attribute(tag, "infinite", 0) != 0) {
+                tokenizer_error(&xml, NULL, "Failed to read map, it can't be infinite.");
+                close_tokenizer(&xml);
+                return false;
+            }
+
+            if (rows < 0 || rows > MAX_ROOM_ROWS || cols < 0 || cols > MAX_ROOM_COLS) {
+                tokenizer_error(&xml, NULL, "Failed to set map size, %d %d is too big.", rows, cols);
+            } else {
+                room->rows = rows;
+                room->cols = cols;
+            }
+
+        } else if (strcmp(name, "tileset") == 0) {
+
+            in_tileset = false;
+
+            if (!make_tiles) {
+                continue;
+            }
+
+            tileset.firstgid = get_int_attribute(tag, "firstgid", 1);
+
+            if (get_attribute(tag, "source", value, sizeof(value))) {
+                read_tsx_file(value, tileset.firstgid, room);
+            } else {
+                read_tileset_attributes(tag, &tileset);
+                in_tileset = true;
+            }
+
+        } else if (strcmp(name, "image") == 0 && in_tileset) {
+
+            if (get_attribute(tag, "source", value, sizeof(value))) {
+                add_tileset_tiles(&xml, &tileset, value, room);
+            }
+            in_tileset = false;
+
+        } else if (strcmp(name, "layer") == 0) {
+
+            in_tileset = false;
+            map = NULL;
+
+            if (!get_attribute(tag, "name", value, sizeof(value))) {
+                continue;
+            }
+
+            map = get_layer_map(room, value);
+
+            if (map == NULL) {
+                tokenizer_error(&xml, NULL, "Failed to recognize layer %s", value);
+            } else if (get_int_attribute(tag, "width", room->cols) != room->cols ||
+                    get_int_attribute(tag, "height", room->rows) != room->rows) {
+                tokenizer_error(&xml, NULL, "Failed to read layer %s, it's not the same size as the map.", value);
+                map = NULL;
+            } else if (map == room->foreground_map) {
+                foreground_map_used = true;
+            } else if (map == room->collision_map) {
+                collision_map_used = true;
+            }
+
+        } else if (strcmp(name, "data") == 0 && map != NULL) {
+
+            read_layer(&xml, tag, map, room);
+            map = NULL;
+        }
+    }
+
+    close_tokenizer(&xml);
+
+    /* If there's no collision map, just create one based on the foreground map */
+    if (foreground_map_used && !collision_map_used) {
+        for (int i = 0; i < room->rows * room->cols; i++) {
+            room->collision_map[i] = room->foreground_map[i] == -1 ? NO_COLLISION : COLLISION;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "gamedata.h"
+
+/**
+ * Rooms can be drawn in the Tiled map editor (see "dev/tiled").
+ *
+ * A Tiled map ("room-story-001.tmx") has the maps of a room, one
+ * layer for each, named after the data file keyword:
+ *
+ *   FARGROUND, BACKGROUND, FOREGROUND, COLLISION, BLOCKS
+ *
+ * Everything else (the start, enemies, exits and the tiles and
+ * textures that are IMPORTed) still comes from the room data file
+ * with the same name ("room-story-001.dat"). When a room is read,
+ * the Tiled map is put on top of the data file, if it can be found
+ * in the datafile paths, so the Tiled map can be saved and played
+ * right away without converting it.
+ *
+ * Layers can be saved as CSV or as base64, either uncompressed or
+ * compressed with zlib or gzip. A number in a layer is the same as
+ * in a data file, 0 for nothing and 1 for the first tile, so only
+ * maps with one tileset (with "firstgid" 1) line up with the tiles
+ * in the data file. Flipped or rotated tiles are drawn as-is.
+ *
+ * If the room doesn't have any tiles, one is made for each tile in
+ * the tilesets of the map (including ".tsx" tilesets, which are
+ * found in the datafile paths), using the image of the tileset.
+ */
+
+/**
+ * The name of the Tiled map for a room data file, such as
+ * "room-story-001.tmx" for "room-story-001.dat".
+ */
+void get_tmx_file_name(const char *filename, char *tmx_filename, int size);
+
+/**
+ * Read the layers of a Tiled map, taking into account datafile
+ * paths, on top of a room that was already read from a data file.
+ * Returns false if the map couldn't be read.
+ */
+bool read_tmx_file(const char *filename, ROOM *room);
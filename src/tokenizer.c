@@ -0,0 +1,208 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "datafile.h"
+#include "drc_memory.h"
+#include "tokenizer.h"
+
+bool open_tokenizer(TOKENIZER *tokenizer, const char *filename)
+{
+    snprintf(tokenizer->filename, sizeof(tokenizer->filename), "%s", filename);
+    tokenizer->data = NULL;
+    tokenizer->size = 0;
+    tokenizer->pos = NULL;
+    tokenizer->line = 1;
+    tokenizer->line_start = NULL;
+
+    FILE *file = open_data_file_with_mode(filename, "rb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    /* Read the whole file at once */
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < 0) {
+        close_data_file(file);
+        return false;
+    }
+
+    tokenizer->data = drc_alloc_memory("TOKENIZER", size + 1);
+    assert(tokenizer->data != NULL);
+
+    tokenizer->size = fread(tokenizer->data, 1, size, file);
+    tokenizer->data[tokenizer->size] = '\0';
+
+    close_data_file(file);
+
+    tokenizer->pos = tokenizer->data;
+    tokenizer->line_start = tokenizer->data;
+
+    return true;
+}
+
+void close_tokenizer(TOKENIZER *tokenizer)
+{
+    if (tokenizer->data != NULL) {
+        tokenizer->data = drc_free_memory("TOKENIZER", tokenizer->data);
+    }
+
+    tokenizer->pos = NULL;
+    tokenizer->line_start = NULL;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* Move past the end of the line, the next character is on a new line */
+static void skip_line(TOKENIZER *tokenizer)
+{
+    const char *pos = tokenizer->pos;
+
+    while (*pos != '\0' && *pos != '\n') {
+        pos++;
+    }
+
+    if (*pos == '\n') {
+        pos++;
+        tokenizer->line++;
+        tokenizer->line_start = pos;
+    }
+
+    tokenizer->pos = pos;
+}
+
+bool next_token(TOKENIZER *tokenizer, TOKEN *token)
+{
+    const char *pos = tokenizer->pos;
+
+    while (true) {
+
+        /* Skip spaces, counting lines */
+        while (is_space(*pos)) {
+            if (*pos == '\n') {
+                tokenizer->line++;
+                tokenizer->line_start = pos + 1;
+            }
+            pos++;
+        }
+
+        /* Ignore comments (words that begin with a hash) */
+        if (*pos == '#') {
+            tokenizer->pos = pos;
+            skip_line(tokenizer);
+            pos = tokenizer->pos;
+            continue;
+        }
+
+        break;
+    }
+
+    token->start = pos;
+    token->line = tokenizer->line;
+    token->col = (pos - tokenizer->line_start) + 1;
+
+    while (*pos != '\0' && !is_space(*pos)) {
+        pos++;
+    }
+
+    token->len = pos - token->start;
+    tokenizer->pos = pos;
+
+    return token->len > 0;
+}
+
+void read_rest_of_line(TOKENIZER *tokenizer, char *string, int size)
+{
+    const char *start = tokenizer->pos;
+
+    skip_line(tokenizer);
+
+    int len = tokenizer->pos - start;
+
+    /* Leave off the end of the line */
+    while (len > 0 && (start[len - 1] == '\n' || start[len - 1] == '\r')) {
+        len--;
+    }
+
+    if (len > size - 1) {
+        len = size - 1;
+    }
+
+    memcpy(string, start, len);
+    string[len] = '\0';
+}
+
+bool token_equals(TOKEN *token, const char *string)
+{
+    return strncmp(token->start, string, token->len) == 0 && string[token->len] == '\0';
+}
+
+bool token_to_int(TOKEN *token, int *num)
+{
+    const char *c = token->start;
+    const char *end = token->start + token->len;
+    bool negative = false;
+
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+
+    /* There needs to be at least one digit */
+    if (c == end) {
+        return false;
+    }
+
+    /* A negative number can go one further than a positive one */
+    long long limit = negative ? -(long long)INT_MIN : INT_MAX;
+    long long value = 0;
+
+    for (; c < end; c++) {
+        if (*c < '0' || *c > '9') {
+            return false;
+        }
+        value = (value * 10) + (*c - '0');
+        if (value > limit) {
+            return false;
+        }
+    }
+
+    *num = (int)(negative ? -value : value);
+
+    return true;
+}
+
+void token_to_string(TOKEN *token, char *string, int size)
+{
+    int len = token->len < size - 1 ? token->len : size - 1;
+
+    memcpy(string, token->start, len);
+    string[len] = '\0';
+}
+
+void tokenizer_error(TOKENIZER *tokenizer, TOKEN *token, const char *format, ...)
+{
+    int line = tokenizer->line;
+    int col = (tokenizer->pos - tokenizer->line_start) + 1;
+
+    if (token != NULL) {
+        line = token->line;
+        col = token->col;
+    }
+
+    fprintf(stderr, "%s:%d:%d: ", tokenizer->filename, line, col);
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    fprintf(stderr, "\n");
+}
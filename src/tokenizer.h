@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * Splits a text data file into words ("tokens").
+ *
+ * The whole file is read into memory when it's opened, and
+ * each token just points into it, so nothing is copied until
+ * it's needed. Tokens are separated by spaces, and a token
+ * that starts with a hash ("#") is a comment, which is
+ * skipped along with the rest of the line.
+ */
+
+typedef struct
+{
+    /* NOT null-terminated! Use "len" */
+    const char *start;
+    int len;
+
+    /* Where the token is in the file, for error messages */
+    int line;
+    int col;
+} TOKEN;
+
+typedef struct
+{
+    char filename[256];
+
+    /* The whole file, with a null at the end */
+    char *data;
+    long size;
+
+    const char *pos;
+    int line;
+    const char *line_start;
+} TOKENIZER;
+
+/**
+ * Read a data file (taking into account datafile paths)
+ * to get it ready to be split into tokens.
+ * Returns false if the file can't be read.
+ */
+bool open_tokenizer(TOKENIZER *tokenizer, const char *filename);
+void close_tokenizer(TOKENIZER *tokenizer);
+
+/**
+ * Find the next token, skipping comments.
+ * Returns false at the end of the file.
+ */
+bool next_token(TOKENIZER *tokenizer, TOKEN *token);
+
+/**
+ * Everything from the current position to the end of the line,
+ * for values that can have spaces in them (such as a title).
+ */
+void read_rest_of_line(TOKENIZER *tokenizer, char *string, int size);
+
+bool token_equals(TOKEN *token, const char *string);
+
+/**
+ * Read a whole number, with an optional sign.
+ * Returns false if the token isn't a number, or if
+ * it's too big or too small to fit in an int.
+ */
+bool token_to_int(TOKEN *token, int *num);
+
+/**
+ * Copy the token into a null-terminated string,
+ * cutting it off if it doesn't fit.
+ */
+void token_to_string(TOKEN *token, char *string, int size);
+
+/**
+ * Print an error message, starting with the filename and the
+ * line and column of the token (or the current position in the
+ * file if the token is NULL), like a compiler does.
+ */
+void tokenizer_error(TOKENIZER *tokenizer, TOKEN *token, const char *format, ...);